@@ -0,0 +1,178 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <arpa/inet.h>
+#include <zlib.h>
+
+#define COMPRESSION_MIN_SIZE 32     /** Textos menores não compensam a compressão (com o dicionário, um STATUS de ~50 bytes cai à metade) */
+#define COMPRESSION_LEVEL 6         /** Nível do deflate */
+#define COMPRESSION_MAX_SIZE 65536  /** Maior texto aceito após descompressão */
+
+/**
+ * @brief Compressão de textos com dicionário compartilhado.
+ *
+ * Usa deflate (zlib) com um dicionário pré-definido, conhecido por cliente e
+ *     servidor, montado a partir das strings que mais se repetem no tráfego:
+ *     listas de clientes (`ID:usuario\n`), mensagens de status e palavras
+ *     frequentes nos tweets. O dicionário dá ao compressor contexto mesmo para
+ *     textos curtos, onde o deflate sozinho quase não ganha nada.
+ *
+ * O texto comprimido é prefixado com o tamanho original (4 bytes, ordem de
+ *     rede), o que limita a memória usada na descompressão.
+ *
+ * Os fluxos do zlib são mantidos por thread e reiniciados a cada uso, evitando
+ *     alocar o estado do compressor a cada mensagem.
+ */
+class Compression
+{
+public:
+    /**
+     * @brief Comprime um texto
+     *
+     * @param text Texto original
+     * @param size Tamanho do texto
+     * @param out Recebe o texto comprimido (com prefixo de tamanho)
+     *
+     * @retval `true` Se o resultado é menor que o original
+     * @retval `false` Se não compensa comprimir (ou houve erro)
+     */
+    static bool compress(const char *text, size_t size, std::string &out)
+    {
+        if (size < COMPRESSION_MIN_SIZE || size > COMPRESSION_MAX_SIZE)
+            return false;
+
+        Deflater &deflater = deflaterInstance();
+        if (!deflater.ready)
+            return false;
+
+        out.resize(4 + deflateBound(&deflater.stream, size));
+        uint32_t original = htonl(static_cast<uint32_t>(size));
+        memcpy(&out[0], &original, 4);
+
+        deflateReset(&deflater.stream);
+        deflateSetDictionary(&deflater.stream, dictionary(), dictionarySize());
+
+        deflater.stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text));
+        deflater.stream.avail_in = size;
+        deflater.stream.next_out = reinterpret_cast<Bytef*>(&out[4]);
+        deflater.stream.avail_out = out.size() - 4;
+
+        if (deflate(&deflater.stream, Z_FINISH) != Z_STREAM_END)
+            return false;
+
+        out.resize(4 + deflater.stream.total_out);
+        return out.size() < size;
+    }
+
+    /**
+     * @brief Descomprime um texto
+     *
+     * @param data Texto comprimido (com prefixo de tamanho)
+     * @param size Tamanho do texto comprimido
+     * @param out Recebe o texto original
+     *
+     * @retval `true` Se a descompressão foi bem sucedida
+     * @retval `false` Se os dados são inválidos
+     */
+    static bool decompress(const char *data, size_t size, std::string &out)
+    {
+        if (size < 4)
+            return false;
+
+        uint32_t original;
+        memcpy(&original, data, 4);
+        original = ntohl(original);
+
+        if (original > COMPRESSION_MAX_SIZE)
+            return false;
+
+        Inflater &inflater = inflaterInstance();
+        if (!inflater.ready)
+            return false;
+
+        out.resize(original);
+        inflateReset(&inflater.stream);
+
+        inflater.stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data + 4));
+        inflater.stream.avail_in = size - 4;
+        inflater.stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+        inflater.stream.avail_out = original;
+
+        int status = inflate(&inflater.stream, Z_FINISH);
+        if (status == Z_NEED_DICT)
+        {
+            inflateSetDictionary(&inflater.stream, dictionary(), dictionarySize());
+            status = inflate(&inflater.stream, Z_FINISH);
+        }
+
+        return status == Z_STREAM_END && inflater.stream.total_out == original;
+    }
+
+private:
+    /**
+     * @brief Estado do compressor de uma thread
+     */
+    struct Deflater {
+        z_stream stream;
+        bool ready;
+
+        Deflater()
+        {
+            memset(&stream, 0, sizeof(stream));
+            ready = deflateInit(&stream, COMPRESSION_LEVEL) == Z_OK;
+        }
+
+        ~Deflater() { deflateEnd(&stream); }
+    };
+
+    /**
+     * @brief Estado do descompressor de uma thread
+     */
+    struct Inflater {
+        z_stream stream;
+        bool ready;
+
+        Inflater()
+        {
+            memset(&stream, 0, sizeof(stream));
+            ready = inflateInit(&stream) == Z_OK;
+        }
+
+        ~Inflater() { inflateEnd(&stream); }
+    };
+
+    static Deflater& deflaterInstance()
+    {
+        thread_local Deflater deflater;
+        return deflater;
+    }
+
+    static Inflater& inflaterInstance()
+    {
+        thread_local Inflater inflater;
+        return inflater;
+    }
+
+    /**
+     * @brief Dicionário compartilhado
+     *
+     * As strings mais prováveis ficam no final, onde o deflate as alcança com
+     *     distâncias menores. Alterar o dicionário quebra a compatibilidade
+     *     entre versões diferentes de cliente e servidor.
+     */
+    static constexpr char DICTIONARY[] =
+        "http://https://www. .com .br #hashtag @ rt kkkk haha obrigado parabéns "
+        "você não está para com uma que por mais como mas foi ele ela isso "
+        "hoje amanhã agora aqui muito bem bom dia boa noite tarde pessoal "
+        "Privado Usuário não encontrado! Você não está registrado no sistema! "
+        "STATUS: UDP_SERVER | Clientes: 0 | Tempo: 00:00:00 "
+        "0123456789:user\n1:\n2:\n3:\n4:\n5:\n6:\n7:\n8:\n9:\n10:\n11:\n12:\n";
+
+    static const Bytef* dictionary() { return reinterpret_cast<const Bytef*>(DICTIONARY); }
+    static uInt dictionarySize() { return sizeof(DICTIONARY) - 1; }
+};
+
+#endif
@@ -0,0 +1,275 @@
+#ifndef FRAGMENT_H
+#define FRAGMENT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <atomic>
+#include <vector>
+#include <arpa/inet.h>
+#include "secure_channel.h"
+
+#define MAX_DATAGRAM_SIZE 1400      /** Maior datagrama enviado (abaixo do MTU do caminho) */
+#define MAX_MESSAGE_SIZE 65536      /** Maior mensagem lógica aceita após remontagem */
+#define FRAGMENT_TYPE 5             /** Valor do campo de tipo em um fragmento (`Message::FRAG`) */
+#define FRAGMENT_HEADER_SIZE 16     /** Tamanho do cabeçalho de fragmento */
+#define FRAGMENT_PAYLOAD_SIZE (MAX_DATAGRAM_SIZE - FRAGMENT_HEADER_SIZE)
+#define MAX_FRAGMENTS 64            /** Limite de fragmentos por mensagem (bitmap de 64 bits) */
+#define REASSEMBLY_SLOTS 16         /** Mensagens remontadas simultaneamente */
+#define REASSEMBLY_SLOTS_PER_SOURCE 4   /** Entradas que um mesmo remetente pode ocupar */
+#define REASSEMBLY_TIMEOUT_MS 2000  /** Tempo máximo para receber todos os fragmentos */
+
+/**
+ * @brief Divisão de mensagens grandes em vários datagramas.
+ *
+ * Cada fragmento começa com um cabeçalho fixo, em ordem de bytes de rede:
+ *     tipo (`FRAGMENT_TYPE`), ID da mensagem, índice, total de fragmentos e
+ *     tamanho total da mensagem codificada.
+ */
+class Fragmenter
+{
+public:
+    /**
+     * @brief Envia uma mensagem codificada dividida em fragmentos
+     *
+     * @param sockfd Descritor de socket para envio
+     * @param addr Endereço do destinatário
+     * @param data Mensagem codificada
+     * @param size Tamanho da mensagem codificada
+     * @param channel Cifra cada fragmento com o canal da sessão (opcional)
+     *
+     * @retval `true` Se todos os fragmentos foram enviados
+     * @retval `false` Se a mensagem excede `MAX_MESSAGE_SIZE` ou o envio falhou
+     */
+    static bool send(int sockfd, const struct sockaddr_in &addr, const char *data, size_t size,
+                     SecureChannel *channel = nullptr)
+    {
+        size_t count = (size + FRAGMENT_PAYLOAD_SIZE - 1) / FRAGMENT_PAYLOAD_SIZE;
+
+        if (size > MAX_MESSAGE_SIZE || count > MAX_FRAGMENTS)
+            return false;
+
+        uint32_t messageID = _nextID.fetch_add(1, std::memory_order_relaxed);
+        char datagram[MAX_DATAGRAM_SIZE];
+
+        for (size_t index = 0; index < count; index++)
+        {
+            size_t offset = index * FRAGMENT_PAYLOAD_SIZE;
+            size_t chunk = std::min<size_t>(FRAGMENT_PAYLOAD_SIZE, size - offset);
+
+            writeHeader(datagram, messageID, index, count, size);
+            memcpy(datagram + FRAGMENT_HEADER_SIZE, data + offset, chunk);
+
+            if (sendDatagram(sockfd, addr, datagram, FRAGMENT_HEADER_SIZE + chunk, channel) < 0)
+                return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Lê o cabeçalho de um fragmento
+     *
+     * @retval `true` Se o cabeçalho é consistente com o tamanho do datagrama
+     */
+    static bool readHeader(const char *datagram, size_t n, uint32_t &messageID,
+                           uint16_t &index, uint16_t &count, uint32_t &totalSize)
+    {
+        if (n <= FRAGMENT_HEADER_SIZE)
+            return false;
+
+        uint32_t type;
+        memcpy(&type, datagram, 4);
+        memcpy(&messageID, datagram + 4, 4);
+        memcpy(&index, datagram + 8, 2);
+        memcpy(&count, datagram + 10, 2);
+        memcpy(&totalSize, datagram + 12, 4);
+
+        messageID = ntohl(messageID);
+        index = ntohs(index);
+        count = ntohs(count);
+        totalSize = ntohl(totalSize);
+
+        if (ntohl(type) != FRAGMENT_TYPE || count == 0 || count > MAX_FRAGMENTS ||
+            index >= count || totalSize > MAX_MESSAGE_SIZE)
+            return false;
+
+        if (count != (totalSize + FRAGMENT_PAYLOAD_SIZE - 1) / FRAGMENT_PAYLOAD_SIZE)
+            return false;
+
+        size_t expected = index + 1 < count ? FRAGMENT_PAYLOAD_SIZE
+                                            : totalSize - index * FRAGMENT_PAYLOAD_SIZE;
+        return n - FRAGMENT_HEADER_SIZE == expected;
+    }
+
+private:
+    static inline std::atomic<uint32_t> _nextID{1}; /** Próximo ID de mensagem fragmentada */
+
+    static void writeHeader(char *datagram, uint32_t messageID, size_t index,
+                            size_t count, size_t size)
+    {
+        uint32_t type = htonl(FRAGMENT_TYPE);
+        uint32_t id = htonl(messageID);
+        uint16_t idx = htons(static_cast<uint16_t>(index));
+        uint16_t cnt = htons(static_cast<uint16_t>(count));
+        uint32_t total = htonl(static_cast<uint32_t>(size));
+
+        memcpy(datagram, &type, 4);
+        memcpy(datagram + 4, &id, 4);
+        memcpy(datagram + 8, &idx, 2);
+        memcpy(datagram + 10, &cnt, 2);
+        memcpy(datagram + 12, &total, 4);
+    }
+};
+
+/**
+ * @brief Remontagem de mensagens fragmentadas.
+ *
+ * Usa uma tabela de tamanho fixo (`REASSEMBLY_SLOTS`), com buffers alocados
+ *     uma única vez, de modo que a memória usada é limitada independente do
+ *     tráfego. Mensagens incompletas expiram após `REASSEMBLY_TIMEOUT_MS`.
+ *     Cada remetente ocupa no máximo `REASSEMBLY_SLOTS_PER_SOURCE` entradas:
+ *     acima disso, descarta a própria mensagem mais antiga, e só com a tabela
+ *     cheia a mais antiga de todas é descartada. Quem recebe deve filtrar os
+ *     remetentes antes (`DatagramFilter`), pois endereços forjados ainda
+ *     disputam a tabela.
+ *
+ * Não é thread-safe: deve ser usada apenas pela thread que recebe do socket.
+ */
+class Reassembler
+{
+public:
+    Reassembler() : _slots(REASSEMBLY_SLOTS)
+    {
+        for (auto &slot : _slots)
+            slot.buffer.resize(MAX_MESSAGE_SIZE);
+    }
+
+    /**
+     * @brief Adiciona um fragmento recebido
+     *
+     * @param datagram Datagrama recebido
+     * @param n Tamanho do datagrama
+     * @param addr Endereço do remetente
+     * @param data Recebe o ponteiro para a mensagem completa
+     * @param size Recebe o tamanho da mensagem completa
+     *
+     * @retval `true` Se a mensagem foi completada por este fragmento. Os dados
+     *     permanecem válidos até a próxima chamada.
+     * @retval `false` Se ainda faltam fragmentos ou o fragmento é inválido.
+     */
+    bool add(const char *datagram, size_t n, const struct sockaddr_in &addr,
+             const char **data, size_t *size)
+    {
+        uint32_t messageID, totalSize;
+        uint16_t index, count;
+
+        if (!Fragmenter::readHeader(datagram, n, messageID, index, count, totalSize))
+            return false;
+
+        auto now = std::chrono::steady_clock::now();
+        uint64_t source = (static_cast<uint64_t>(addr.sin_addr.s_addr) << 16) | addr.sin_port;
+        Slot *slot = findSlot(source, messageID, now);
+
+        if (!slot->used)
+        {
+            slot->used = true;
+            slot->source = source;
+            slot->messageID = messageID;
+            slot->count = count;
+            slot->totalSize = totalSize;
+            slot->received = 0;
+            slot->started = now;
+        }
+        else if (slot->count != count || slot->totalSize != totalSize)
+        {
+            return false;
+        }
+
+        uint64_t bit = 1ULL << index;
+        if (slot->received & bit)
+            return false;
+
+        memcpy(slot->buffer.data() + index * FRAGMENT_PAYLOAD_SIZE,
+               datagram + FRAGMENT_HEADER_SIZE, n - FRAGMENT_HEADER_SIZE);
+        slot->received |= bit;
+
+        if (slot->received != (count == 64 ? ~0ULL : (1ULL << count) - 1))
+            return false;
+
+        slot->used = false;
+        *data = slot->buffer.data();
+        *size = slot->totalSize;
+
+        return true;
+    }
+
+private:
+    /**
+     * @brief Entrada da tabela de remontagem
+     */
+    struct Slot {
+        bool used = false;
+        uint64_t source = 0;        /** Chave (IP, porta) do remetente */
+        uint32_t messageID = 0;     /** ID da mensagem fragmentada */
+        uint16_t count = 0;         /** Total de fragmentos */
+        uint32_t totalSize = 0;     /** Tamanho da mensagem completa */
+        uint64_t received = 0;      /** Bitmap dos fragmentos recebidos */
+        std::chrono::steady_clock::time_point started;
+        std::vector<char> buffer;   /** Buffer de tamanho `MAX_MESSAGE_SIZE` */
+    };
+
+    std::vector<Slot> _slots; /** Tabela de remontagem */
+
+    /**
+     * @brief Encontra a entrada de uma mensagem, ou libera uma para ela
+     *
+     * Expira entradas antigas e, se necessário, reaproveita a mais antiga do
+     *     remetente (se ele esgotou a cota) ou a mais antiga da tabela.
+     */
+    Slot* findSlot(uint64_t source, uint32_t messageID,
+                   std::chrono::steady_clock::time_point now)
+    {
+        Slot *free = nullptr;
+        Slot *oldest = &_slots[0];
+        Slot *oldestOwn = nullptr;
+        size_t own = 0;
+
+        for (auto &slot : _slots)
+        {
+            if (slot.used && now - slot.started > std::chrono::milliseconds(REASSEMBLY_TIMEOUT_MS))
+                slot.used = false;
+
+            if (slot.used && slot.source == source)
+            {
+                if (slot.messageID == messageID)
+                    return &slot;
+
+                own++;
+                if (!oldestOwn || slot.started < oldestOwn->started)
+                    oldestOwn = &slot;
+            }
+
+            if (!slot.used && !free)
+                free = &slot;
+
+            if (slot.started < oldest->started)
+                oldest = &slot;
+        }
+
+        if (own >= REASSEMBLY_SLOTS_PER_SOURCE)
+        {
+            oldestOwn->used = false;
+            return oldestOwn;
+        }
+
+        if (free)
+            return free;
+
+        oldest->used = false;
+        return oldest;
+    }
+};
+
+#endif
@@ -2,17 +2,153 @@
 #define MESSAGE_H
 
 #include <string>
+#include <string_view>
 #include <cstring>
+#include <cstddef>
+#include <cstdint>
 #include <arpa/inet.h>
+#include <sys/socket.h>
+#include "fragment.h"
+#include "compression.h"
+
+#define MAX_TEXT_SIZE 140           /** Limite de caracteres de um tweet */
+#define MAX_USERNAME_SIZE 20        /** Limite de caracteres do nome de usuário */
+#define MESSAGE_HEADER_SIZE 42      /** Cabeçalho codificado: 5 inteiros + flags + nome de usuário */
+#define CACHE_LINE_SIZE 64          /** Alinhamento dos cabeçalhos em memória */
+
+/**
+ * @brief Cabeçalho da mensagem no formato do fio.
+ *
+ * Os inteiros são big-endian e guardados como bytes, de modo que o registro
+ *     não tem preenchimento nem exigência de alinhamento e pode ser lido
+ *     diretamente sobre o buffer recebido. O layout é verificado em tempo de
+ *     compilação logo abaixo.
+ */
+struct WireHeader {
+    uint8_t type[4];                            /** Tipo da mensagem */
+    uint8_t origin[4];                          /** ID de origem */
+    uint8_t destination[4];                     /** ID de destino */
+    uint8_t textSize[4];                        /** Tamanho do texto que segue o cabeçalho */
+    uint8_t sequence[4];                        /** Número de sequência */
+    uint8_t flags;                              /** Flags (`Message::MessageFlag`) */
+    char username[MAX_USERNAME_SIZE + 1];       /** Nome de usuário (terminado em '\0') */
+
+    /**
+     * @brief Lê um inteiro big-endian.
+     */
+    static constexpr int32_t load(const uint8_t (&field)[4])
+    {
+        return static_cast<int32_t>(static_cast<uint32_t>(field[0]) << 24 | static_cast<uint32_t>(field[1]) << 16 |
+                                    static_cast<uint32_t>(field[2]) << 8 | static_cast<uint32_t>(field[3]));
+    }
+
+    /**
+     * @brief Escreve um inteiro big-endian.
+     */
+    static constexpr void store(uint8_t (&field)[4], int32_t value)
+    {
+        uint32_t bits = static_cast<uint32_t>(value);
+        field[0] = static_cast<uint8_t>(bits >> 24);
+        field[1] = static_cast<uint8_t>(bits >> 16);
+        field[2] = static_cast<uint8_t>(bits >> 8);
+        field[3] = static_cast<uint8_t>(bits);
+    }
+
+    /**
+     * @brief Vê um buffer recebido como cabeçalho (exige `MESSAGE_HEADER_SIZE` bytes).
+     */
+    static const WireHeader* at(const char *data) { return reinterpret_cast<const WireHeader*>(data); }
+    static WireHeader* at(char *data) { return reinterpret_cast<WireHeader*>(data); }
+};
+
+static_assert(sizeof(WireHeader) == MESSAGE_HEADER_SIZE, "WireHeader deve ter exatamente o tamanho do fio");
+static_assert(alignof(WireHeader) == 1, "WireHeader não pode exigir alinhamento");
+static_assert(offsetof(WireHeader, origin) == 4 && offsetof(WireHeader, destination) == 8 &&
+              offsetof(WireHeader, textSize) == 12 && offsetof(WireHeader, sequence) == 16 &&
+              offsetof(WireHeader, flags) == 20 && offsetof(WireHeader, username) == 21,
+              "Campos do WireHeader fora das posições do protocolo");
+
+// Codificação e decodificação verificadas em tempo de compilação
+static_assert([] {
+    WireHeader header{};
+    WireHeader::store(header.sequence, 0x01020304);
+    return header.sequence[0] == 0x01 && header.sequence[3] == 0x04;
+}(), "Inteiros do WireHeader devem ser big-endian");
+static_assert([] {
+    WireHeader header{};
+    WireHeader::store(header.origin, -2);
+    WireHeader::store(header.textSize, MAX_MESSAGE_SIZE);
+    return WireHeader::load(header.origin) == -2 && WireHeader::load(header.textSize) == MAX_MESSAGE_SIZE;
+}(), "WireHeader deve preservar os valores na ida e volta");
+
+/**
+ * @brief Janela deslizante de números de sequência já vistos.
+ * 
+ * Guarda o maior número de sequência recebido e um bitmap dos 64 anteriores,
+ *     permitindo detectar datagramas duplicados em O(1) e sem alocação.
+ */
+struct SequenceWindow {
+    uint32_t highest = 0;   /** Maior número de sequência aceito */
+    uint64_t bitmap = 0;    /** Bit `i` indica que `highest - i` já foi visto */
+
+    /**
+     * @brief Registra um número de sequência na janela.
+     * 
+     * @param sequence Número de sequência atribuído pelo cliente (0 = sem sequência)
+     * 
+     * @retval `true` Se é a primeira vez que o número é visto.
+     * @retval `false` Se é duplicado ou antigo demais para a janela.
+     */
+    bool accept(uint32_t sequence)
+    {
+        if (sequence == 0)
+            return true;
+
+        if (sequence > highest)
+        {
+            uint32_t shift = sequence - highest;
+            bitmap = shift >= 64 ? 0 : bitmap << shift;
+            bitmap |= 1;
+            highest = sequence;
+            return true;
+        }
+
+        uint32_t offset = highest - sequence;
+        if (offset >= 64)
+            return false;
+
+        uint64_t mask = 1ULL << offset;
+        if (bitmap & mask)
+            return false;
+
+        bitmap |= mask;
+        return true;
+    }
+};
 
 /**
  * @brief Estrutura auxiliar para armazenar informações de um cliente.
  * 
- * Armazena o endereço do cliente e o nome de usuário.
+ * Armazena o endereço do cliente e o nome de usuário. É um registro de
+ *     tamanho fixo, sem alocação, usado para copiar sessões entre a tabela do
+ *     servidor, a replicação e o snapshot.
  */
 struct ClientInfo {
-    sockaddr_in address;
-    std::string username;
+    sockaddr_in address = {};                   /** Endereço do cliente */
+    char username[MAX_USERNAME_SIZE + 1] = {};  /** Nome de usuário (terminado em '\0') */
+    bool compression = false;                   /** Cliente aceita mensagens comprimidas (negociado no OI) */
+    bool encrypted = false;                     /** Sessão cifrada (só o segredo de retomada é copiado: restaurada, refaz a troca) */
+    bool resumable = false;                     /** `resume` é conhecido (sem ele, a sessão cifrada não é restaurada) */
+    unsigned char resume[SEAL_KEY_SIZE] = {};   /** Segredo de retomada da sessão cifrada */
+
+    void setUsername(std::string_view name)
+    {
+        size_t size = std::min(name.size(), sizeof(username) - 1);
+        memcpy(username, name.data(), size);
+        username[size] = '\0';
+    }
+
+    std::string_view getUsername() const { return std::string_view(username); }
 };
 
 /**
@@ -21,8 +157,18 @@ struct ClientInfo {
  * A classe `Message` representa uma mensagem trocada entre cliente e servidor
  *     no sistema de comunicação UDP. Ela inclui funcionalidades para enviar, 
  *     receber e manipular mensagens de diferentes tipos.
+ * 
+ * No fio, a mensagem é um cabeçalho fixo (`WireHeader`) seguido apenas dos
+ *     bytes do texto. Mensagens que não cabem em um datagrama
+ *     (`MAX_DATAGRAM_SIZE`) são fragmentadas e remontadas pelo receptor, até
+ *     `MAX_MESSAGE_SIZE` bytes.
+ *
+ * Em memória, os campos do cabeçalho ficam no início de um objeto alinhado à
+ *     linha de cache, e os métodos de envio são `const`: uma mesma mensagem
+ *     pode ser enviada várias vezes e lida por várias threads. Para o mesmo
+ *     conteúdo ir a muitos destinatários, veja `EncodedMessage`.
  */
-class Message
+class alignas(CACHE_LINE_SIZE) Message
 {
 public:
     /**
@@ -37,7 +183,66 @@ public:
         TCHAU = 1,  /** Mensagem de desconexão */
         MSG = 2,    /** Mensagem de texto */
         ERRO = 3,   /** Mensagem de erro */
-        LIST = 4    /** Mensagem solicitando lista de clientes */
+        LIST = 4,   /** Mensagem solicitando lista de clientes */
+        FRAG = FRAGMENT_TYPE, /** Fragmento de uma mensagem maior que um datagrama */
+        NODE = 6,   /** Gossip de membros entre nós do cluster */
+        RELAY = 7,  /** Lote de mensagens repassadas entre nós do cluster */
+        REPL = 8,   /** Lote do log de replicação (primário -> standby) */
+        REPL_ACK = 9, /** Confirmação do log de replicação (standby -> primário) */
+        SEARCH = 10, /** Busca nos tweets recentes (destino = página) e resposta */
+        HISTORY = 11, /** Pedido dos tweets após uma posição da linha do tempo e resposta */
+        SCHEDULE = 12, /** Agendamento de um tweet ("<ms desde 1970> <texto>") e confirmação ("<ticket> <ms>") */
+        UNSCHEDULE = 13, /** Cancelamento de um agendamento ("<ticket>") e confirmação */
+        GROUP_CREATE = 14, /** Criação de um grupo ("<nome>") e confirmação ("<ID do grupo> <nome>") */
+        GROUP_JOIN = 15, /** Entrada em um grupo ("<nome>") e confirmação ("<ID do grupo> <nome>") */
+        GROUP_LEAVE = 16, /** Saída de um grupo ("<nome>") e confirmação ("<ID do grupo> <nome>") */
+        GROUP_MSG = 17, /** Mensagem a um grupo (destino = ID do grupo) */
+        MULTICAST = 18, /** Adesão ao grupo multicast; a sequência é a etapa (`MulticastStep`) */
+        SEALED = SEALED_TYPE, /** Datagrama cifrado de uma sessão (`SecureChannel`) */
+        PRESENCE = 20 /** Estado do cliente (sequência = `PresenceState`) e lotes de mudanças ("<id>:<estado>:<usuario>" por linha) */
+    };
+
+    /**
+     * @brief Flags do cabeçalho da mensagem
+     */
+    enum MessageFlag
+    {
+        COMPRESSED = 0x01,          /** Texto comprimido com o dicionário compartilhado */
+        ACCEPTS_COMPRESSION = 0x02, /** No OI: remetente aceita mensagens comprimidas */
+        TRACED = 0x04,              /** Mensagem amostrada para o trace de latência */
+        ACCEPTS_MULTICAST = 0x08,   /** No OI: remetente pode receber os broadcasts por multicast */
+        ACCEPTS_ENCRYPTION = 0x10   /** No OI: texto é a chave pública do remetente, para cifrar a sessão */
+    };
+
+    /**
+     * @brief Etapas da adesão ao multicast (sequência de `MULTICAST`)
+     *
+     * O cliente que recebeu o grupo no OI entra nele e pede a adesão; o
+     *     servidor responde pelo próprio grupo, o que prova que o multicast
+     *     chega ao cliente, e só então deixa de enviar os broadcasts a ele por
+     *     unicast.
+     */
+    enum MulticastStep
+    {
+        MULTICAST_JOIN = 0,     /** Cliente -> servidor: entrou no grupo */
+        MULTICAST_PROBE = 1,    /** Servidor -> grupo: teste (destino = ID do cliente) */
+        MULTICAST_CONFIRM = 2,  /** Cliente -> servidor: recebeu o teste */
+        MULTICAST_ACTIVE = 3    /** Servidor -> cliente: broadcasts passam a vir pelo grupo */
+    };
+
+    /**
+     * @brief Estados de presença de um cliente (sequência de `PRESENCE`)
+     *
+     * O cliente informa só as mudanças; o servidor junta as de todos os
+     *     clientes e as publica em lotes periódicos. `PRESENCE_OFFLINE` só
+     *     aparece nos lotes (a desconexão é o `TCHAU`).
+     */
+    enum PresenceState
+    {
+        PRESENCE_OFFLINE = 0,   /** Desconectado */
+        PRESENCE_ONLINE = 1,    /** Conectado */
+        PRESENCE_AWAY = 2,      /** Ausente */
+        PRESENCE_TYPING = 3     /** Digitando (expira sem renovação) */
     };
 
     /**
@@ -45,7 +250,7 @@ public:
      * 
      * Inicializa uma mensagem com todos os campos zerados.
      */
-    Message() : _type(0), _originID(0), _destinationID(0), _textSize(0)
+    Message() : _type(0), _originID(0), _destinationID(0), _textSize(0), _sequence(0), _flags(0)
     {
         memset(_username, 0, sizeof(_username));
         memset(_text, 0, sizeof(_text));
@@ -60,56 +265,237 @@ public:
      * @param username Nome de usuário que está enviando a mensagem
      * @param text Texto da mensagem
      */
-    Message(int type, int origin, int destination, const std::string &username, const std::string &text)
-        : _type(type), _originID(origin), _destinationID(destination)
+    Message(int type, int origin, int destination, std::string_view username, std::string_view text)
+        : _type(type), _originID(origin), _destinationID(destination), _sequence(0), _flags(0)
     {
         setUsername(username);
-        setText(text);
+        setText(text.data(), text.size());
     }
 
     /**
      * @brief Envia a mensagem por meio de um socket
      * 
+     * Mensagens maiores que um datagrama são enviadas em fragmentos.
+     * 
+     * @param sockfd Descritor de socket para envio
+     * @param addr Endereço do destinatário
+     * @param compress Comprime o texto se o destinatário aceitar e se o
+     *     resultado for menor (Padrão false)
+     * @param channel Canal cifrado da sessão do destinatário (Padrão nenhum)
+     */
+    inline void send(int sockfd, struct sockaddr_in addr, bool compress = false,
+                     SecureChannel *channel = nullptr) const
+    {
+        std::string compressed;
+        const char *payload = text();
+        size_t payloadSize = _textSize;
+        uint8_t flags = _flags;
+
+        if (compress && Compression::compress(text(), _textSize, compressed))
+        {
+            payload = compressed.data();
+            payloadSize = compressed.size();
+            flags |= COMPRESSED;
+        }
+
+        if (MESSAGE_HEADER_SIZE + payloadSize <= MAX_DATAGRAM_SIZE)
+        {
+            alignas(CACHE_LINE_SIZE) char buffer[MAX_DATAGRAM_SIZE];
+            size_t size = encode(buffer, payload, payloadSize, flags);
+            sendEncoded(sockfd, addr, buffer, size, channel);
+        }
+        else
+        {
+            std::string buffer(MESSAGE_HEADER_SIZE + payloadSize, '\0');
+            encode(&buffer[0], payload, payloadSize, flags);
+            sendEncoded(sockfd, addr, buffer.data(), buffer.size(), channel);
+        }
+    }
+
+    /**
+     * @brief Envia bytes já codificados, fragmentando se necessário
+     * 
      * @param sockfd Descritor de socket para envio
      * @param addr Endereço do destinatário
+     * @param data Mensagem codificada
+     * @param size Tamanho da mensagem codificada
+     * @param channel Canal cifrado da sessão do destinatário (opcional)
      */
-    inline void send(int sockfd, struct sockaddr_in addr)
+    static void sendEncoded(int sockfd, const struct sockaddr_in &addr, const char *data, size_t size,
+                            SecureChannel *channel = nullptr)
     {
-        this->networkByteOrder();
-        sendto(sockfd, this->data(), this->size(), 0, (struct sockaddr*)&addr, sizeof(addr));
+        if (size <= MAX_DATAGRAM_SIZE)
+            sendDatagram(sockfd, addr, data, size, channel);
+        else
+            Fragmenter::send(sockfd, addr, data, size, channel);
     }
 
     /**
      * @brief Recebe uma mensagem de um socket
      * 
+     * Lê um datagrama para um buffer na pilha e o decodifica em `msg`. Se o
+     *     datagrama for um fragmento e houver `reassembler`, ele é guardado até
+     *     a mensagem estar completa. O `filter`, se houver, vê o datagrama antes
+     *     de tudo (abre os cifrados e recusa os que não são aceitos).
+     * 
      * @param sockfd Descritor de socket de onde a mensagem será recebida
      * @param addr Endereço do remetente da mensagem
-     * @param buffer_size Tamanho do buffer para receber a mensagem
+     * @param msg Mensagem de destino
+     * @param buffer_size Tamanho do buffer para receber o datagrama
+     * @param reassembler Tabela de remontagem de fragmentos (opcional)
+     * @param overflow Recebe o contador de descartes do kernel (`SO_RXQ_OVFL`),
+     *     quando o socket o envia (opcional; mantido se ausente)
+     * @param filter Filtro de datagramas (opcional)
+     * 
+     * @retval >0 Mensagem completa e válida recebida
+     * @retval 0 Datagrama descartado (malformado, truncado ou recusado pelo
+     *     filtro) ou fragmento de mensagem incompleta
+     * @retval <0 Erro no `recvmsg` (veja `errno`)
+     */
+    static int receive(int sockfd, struct sockaddr_in &addr, Message &msg, int buffer_size,
+                       Reassembler *reassembler = nullptr, uint32_t *overflow = nullptr,
+                       DatagramFilter *filter = nullptr)
+    {
+        // Alinhado para que o cabeçalho ocupe uma única linha de cache
+        alignas(CACHE_LINE_SIZE) char buffer[buffer_size];
+        alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(uint32_t))];
+        struct iovec payload = {buffer, static_cast<size_t>(buffer_size)};
+
+        struct msghdr header;
+        memset(&header, 0, sizeof(header));
+        header.msg_name = &addr;
+        header.msg_namelen = sizeof(addr);
+        header.msg_iov = &payload;
+        header.msg_iovlen = 1;
+
+        if (overflow)
+        {
+            header.msg_control = control;
+            header.msg_controllen = sizeof(control);
+        }
+
+        int n = recvmsg(sockfd, &header, 0);
+
+        if (n < 0)
+            return -1;
+
+        // Maior que o buffer: o kernel entregou só o começo
+        if (header.msg_flags & MSG_TRUNC)
+            return 0;
+
+        for (struct cmsghdr *cmsg = overflow ? CMSG_FIRSTHDR(&header) : nullptr; cmsg;
+             cmsg = CMSG_NXTHDR(&header, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+                memcpy(overflow, CMSG_DATA(cmsg), sizeof(uint32_t));
+        }
+
+        if (filter && (n = static_cast<int>(filter->filter(addr, buffer, n))) == 0)
+            return 0;
+
+        if (n >= 4 && WireHeader::load(WireHeader::at(buffer)->type) == FRAG)
+        {
+            const char *data;
+            size_t size;
+
+            if (!reassembler || !reassembler->add(buffer, n, addr, &data, &size))
+                return 0;
+
+            return decode(data, size, msg) ? static_cast<int>(size) : 0;
+        }
+
+        return decode(buffer, n, msg) ? n : 0;
+    }
+
+    /**
+     * @brief Codifica a mensagem no formato do fio
+     * 
+     * @param buffer Destino com pelo menos `encodedSize()` bytes
+     * 
+     * @return size_t Quantidade de bytes escritos
+     */
+    size_t encode(char *buffer) const
+    {
+        return encode(buffer, text(), _textSize, _flags);
+    }
+
+    /**
+     * @brief Decodifica uma mensagem no formato do fio
      * 
-     * @return Message* Ponteiro para a mensagem recebida
+     * @param data Bytes recebidos
+     * @param n Quantidade de bytes recebidos
+     * @param msg Mensagem de destino
+     * 
+     * @retval `true` Se os dados formam uma mensagem válida
+     * @retval `false` Se estão truncados, inconsistentes ou maiores que
+     *     `MAX_MESSAGE_SIZE` (antes ou depois da descompressão)
      */
-    static Message* receive(int sockfd, struct sockaddr_in &addr, int buffer_size)
+    static bool decode(const char *data, size_t n, Message &msg)
     {
-        char buffer[buffer_size];
-        socklen_t addrLen = sizeof(addr);
+        if (n < MESSAGE_HEADER_SIZE)
+            return false;
+
+        const WireHeader *header = WireHeader::at(data);
+        int textSize = WireHeader::load(header->textSize);
+        if (textSize < 0 || static_cast<size_t>(textSize) != n - MESSAGE_HEADER_SIZE ||
+            textSize > MAX_MESSAGE_SIZE - MESSAGE_HEADER_SIZE)
+            return false;
 
-        int n = recvfrom(sockfd, buffer, buffer_size, 0,(struct sockaddr *)&addr, &addrLen);
+        msg._type = WireHeader::load(header->type);
+        msg._originID = WireHeader::load(header->origin);
+        msg._destinationID = WireHeader::load(header->destination);
+        msg._sequence = WireHeader::load(header->sequence);
+        msg._flags = header->flags;
+        memcpy(msg._username, header->username, sizeof(msg._username));
+        msg._username[sizeof(msg._username) - 1] = '\0';
 
-        if (n > 0)
+        if (msg._flags & COMPRESSED)
         {
-            buffer[n] = '\0';
-            Message* msg = new Message();
-            memcpy(msg, buffer, sizeof(Message));
-            msg->hostByteOrder();
+            std::string text;
+            if (!Compression::decompress(data + MESSAGE_HEADER_SIZE, textSize, text) ||
+                text.size() > MAX_MESSAGE_SIZE - MESSAGE_HEADER_SIZE)
+                return false;
 
-            return msg;
+            msg._flags &= ~COMPRESSED;
+            msg.setText(text.data(), text.size());
         }
         else
         {
-            return nullptr;
+            msg.setText(data + MESSAGE_HEADER_SIZE, textSize);
         }
+
+        return true;
     }
 
+    /**
+     * @brief Obtém o tamanho da mensagem codificada que começa em `data`
+     * 
+     * Permite percorrer várias mensagens codificadas em sequência.
+     * 
+     * @param data Bytes codificados
+     * @param n Quantidade de bytes disponíveis
+     * 
+     * @return size_t Tamanho da mensagem, ou 0 se os dados estão incompletos
+     */
+    static size_t frameSize(const char *data, size_t n)
+    {
+        if (n < MESSAGE_HEADER_SIZE)
+            return 0;
+
+        int textSize = WireHeader::load(WireHeader::at(data)->textSize);
+        if (textSize < 0 || static_cast<size_t>(textSize) > n - MESSAGE_HEADER_SIZE)
+            return 0;
+
+        return MESSAGE_HEADER_SIZE + textSize;
+    }
+
+    /**
+     * @brief Obtém o tamanho da mensagem codificada em bytes
+     * 
+     * @return size_t Tamanho do cabeçalho mais o texto
+     */
+    size_t encodedSize() const { return MESSAGE_HEADER_SIZE + _textSize; }
+
     /*
     * Getters
     */
@@ -118,27 +504,89 @@ public:
     int getOriginID() const { return _originID; }
     int getDestinationID() const { return _destinationID; }
     int getTextSize() const { return _textSize; }
+    int getSequence() const { return _sequence; }
+    bool hasFlag(MessageFlag flag) const { return _flags & flag; }
     std::string getUsername() const { return std::string(_username); }
-    std::string getText() const { return std::string(_text); }
+    std::string getText() const { return std::string(text(), _textSize); }
+
+    /// Acesso sem cópia; válido enquanto a mensagem existir e não for alterada
+    std::string_view getUsernameView() const { return std::string_view(_username); }
+    std::string_view getTextView() const { return std::string_view(text(), _textSize); }
+
+    void setSequence(int sequence) { _sequence = sequence; }
+    void setFlag(MessageFlag flag) { _flags |= flag; }
 
 private:
+    friend class EncodedMessage;
+
+    // Campos do cabeçalho: os primeiros 42 bytes do objeto, em uma linha de cache
     int _type;             /** Tipo da mensagem */
     int _originID;         /** ID de origem da mensagem */
     int _destinationID;    /** ID de destino da mensagem */
     int _textSize;         /** Tamanho do texto da mensagem */
-    char _username[21];    /** Nome de usuário (limite de 20 caracteres) */
-    char _text[141];       /** Texto da mensagem (limite de 140 caracteres) */
+    int _sequence;         /** Número de sequência atribuído pelo remetente (0 = nenhum) */
+    uint8_t _flags;        /** Flags do cabeçalho (`MessageFlag`) */
+    char _username[MAX_USERNAME_SIZE + 1]; /** Nome de usuário (limite de 20 caracteres) */
+    char _text[MAX_TEXT_SIZE + 1];         /** Texto da mensagem (até 140 caracteres) */
+    std::string _bulkText; /** Texto de mensagens maiores que 140 caracteres (listas, históricos) */
+
+    /**
+     * @brief Obtém o texto armazenado, curto ou longo
+     * 
+     * @return const char* Ponteiro para o texto
+     */
+    const char *text() const { return _textSize > MAX_TEXT_SIZE ? _bulkText.data() : _text; }
+
+    /**
+     * @brief Codifica o cabeçalho e um texto já preparado (original ou comprimido)
+     * 
+     * @param buffer Destino com pelo menos `MESSAGE_HEADER_SIZE + payloadSize` bytes
+     * @param payload Texto a ser escrito após o cabeçalho
+     * @param payloadSize Tamanho do texto
+     * @param flags Flags do cabeçalho
+     * 
+     * @return size_t Quantidade de bytes escritos
+     */
+    size_t encode(char *buffer, const char *payload, size_t payloadSize, uint8_t flags) const
+    {
+        WireHeader *header = WireHeader::at(buffer);
+        WireHeader::store(header->type, _type);
+        WireHeader::store(header->origin, _originID);
+        WireHeader::store(header->destination, _destinationID);
+        WireHeader::store(header->textSize, static_cast<int>(payloadSize));
+        WireHeader::store(header->sequence, _sequence);
+        header->flags = flags;
+        memcpy(header->username, _username, sizeof(_username));
+        memcpy(buffer + MESSAGE_HEADER_SIZE, payload, payloadSize);
+
+        return MESSAGE_HEADER_SIZE + payloadSize;
+    }
 
     /**
      * @brief Define o texto da mensagem
      * 
+     * Textos de até 140 caracteres ficam no buffer interno, sem alocação.
+     *     Textos maiores são truncados em `MAX_MESSAGE_SIZE`.
+     * 
      * @param msg Texto da mensagem
+     * @param size Tamanho do texto
      */
-    inline void setText(const std::string &msg)
+    inline void setText(const char *msg, size_t size)
     {
-        _textSize = msg.size();
-        strncpy(_text, msg.c_str(), sizeof(_text) - 1);
-        _text[_textSize] = '\0';
+        size = std::min<size_t>(size, MAX_MESSAGE_SIZE - MESSAGE_HEADER_SIZE);
+        _textSize = static_cast<int>(size);
+
+        if (size <= MAX_TEXT_SIZE)
+        {
+            memcpy(_text, msg, size);
+            _text[size] = '\0';
+            _bulkText.clear();
+        }
+        else
+        {
+            _text[0] = '\0';
+            _bulkText.assign(msg, size);
+        }
     }
 
     /**
@@ -146,53 +594,73 @@ private:
      * 
      * @param name Nome de usuário
      */
-    inline void setUsername(const std::string &name)
+    inline void setUsername(std::string_view name)
     {
-        stpncpy(_username, name.c_str(), sizeof(_username) - 1);
-        _username[sizeof(_username) - 1] = '\0';
+        memset(_username, 0, sizeof(_username));
+        memcpy(_username, name.data(), std::min(name.size(), sizeof(_username) - 1));
     }
+};
+
+static_assert(alignof(Message) == CACHE_LINE_SIZE, "Message deve começar em uma linha de cache");
 
+/**
+ * @brief Mensagem codificada uma única vez para muitos destinatários.
+ *
+ * Guarda os bytes do fio em claro e, quando pedido e vantajoso, comprimidos.
+ *     Depois de construída não muda: cada envio é só um `sendto` dos mesmos
+ *     bytes, e a mesma instância pode ser compartilhada entre threads (por
+ *     exemplo, via `std::shared_ptr<const EncodedMessage>`).
+ */
+class EncodedMessage
+{
+public:
     /**
-     * @brief Converte os valores internos para ordem de bytes de rede
-     * 
-     * Converte os campos inteiros da mensagem para a ordem de bytes usada
-     * em redes (big-endian).
+     * @brief Codifica uma mensagem.
+     *
+     * @param message Mensagem a ser codificada
+     * @param compress Prepara também a versão comprimida (se ficar menor)
      */
-    inline void networkByteOrder()
+    EncodedMessage(const Message &message, bool compress)
     {
-        _type = htonl(_type);
-        _originID = htonl(_originID);
-        _destinationID = htonl(_destinationID);
-        _textSize = htonl(_textSize);
+        _plain.resize(message.encodedSize());
+        message.encode(&_plain[0]);
+
+        std::string compressed;
+        if (compress && Compression::compress(message.text(), message._textSize, compressed))
+        {
+            _compressed.resize(MESSAGE_HEADER_SIZE + compressed.size());
+            message.encode(&_compressed[0], compressed.data(), compressed.size(),
+                           message._flags | Message::COMPRESSED);
+        }
     }
 
     /**
-     * @brief Converte os valores internos para ordem de bytes do host
-     * 
-     * Converte os campos inteiros da mensagem para a ordem de bytes usada
-     * pela máquina local (host).
+     * @brief Envia a mensagem a um destinatário
+     *
+     * @param sockfd Descritor de socket para envio
+     * @param addr Endereço do destinatário
+     * @param compress Destinatário aceita mensagens comprimidas
+     * @param channel Canal cifrado da sessão do destinatário (opcional)
      */
-    inline void hostByteOrder()
+    void send(int sockfd, const struct sockaddr_in &addr, bool compress, SecureChannel *channel = nullptr) const
     {
-        _type = ntohl(_type);
-        _originID = ntohl(_originID);
-        _destinationID = ntohl(_destinationID);
-        _textSize = ntohl(_textSize);
+        std::string_view encoded = bytes(compress);
+        Message::sendEncoded(sockfd, addr, encoded.data(), encoded.size(), channel);
     }
 
     /**
-     * @brief Obtém um ponteiro para os dados da mensagem
-     * 
-     * @return const char* Ponteiro para os dados da mensagem
+     * @brief Bytes do fio enviados a um destinatário
+     *
+     * @param compress Destinatário aceita mensagens comprimidas
      */
-    const char *data() const { return reinterpret_cast<const char *>(this); }
+    std::string_view bytes(bool compress) const
+    {
+        return compress && !_compressed.empty() ? _compressed : _plain;
+    }
 
-    /**
-     * @brief Obtém o tamanho da mensagem em bytes
-     * 
-     * @return size_t Tamanho da mensagem
-     */
-    size_t size() const { return sizeof(Message); }
+private:
+    std::string _plain;         /** Bytes do fio com o texto original */
+    std::string _compressed;    /** Bytes do fio com o texto comprimido (vazio se não compensa) */
 };
 
-#endif
\ No newline at end of file
+#endif
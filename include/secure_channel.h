@@ -0,0 +1,503 @@
+#ifndef SECURE_CHANNEL_H
+#define SECURE_CHANNEL_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/kdf.h>
+
+#define SEALED_TYPE 19              /** Valor do campo de tipo em um datagrama cifrado (`Message::SEALED`) */
+#define SEAL_HEADER_SIZE 16         /** Tipo, sessão e contador (dados autenticados, em claro) */
+#define SEAL_TAG_SIZE 16            /** Tag do Poly1305 */
+#define SEAL_OVERHEAD (SEAL_HEADER_SIZE + SEAL_TAG_SIZE)
+#define SEAL_KEY_SIZE 32            /** Chaves X25519 e ChaCha20 */
+#define SEAL_REPLAY_WINDOW 64       /** Contadores fora de ordem aceitos (bitmap) */
+
+/**
+ * @brief Filtro aplicado a cada datagrama recebido, antes da remontagem.
+ *
+ * Abre os datagramas cifrados e decide quais datagramas em claro são aceitos.
+ */
+class DatagramFilter
+{
+public:
+    virtual ~DatagramFilter() = default;
+
+    /**
+     * @brief Filtra um datagrama.
+     *
+     * @param from Remetente
+     * @param datagram Datagrama; o conteúdo aberto é escrito no início
+     * @param size Tamanho do datagrama
+     *
+     * @return size_t Tamanho do datagrama aceito, ou 0 para descartá-lo
+     */
+    virtual size_t filter(const sockaddr_in &from, char *datagram, size_t size) = 0;
+};
+
+/**
+ * @brief Canal cifrado e autenticado entre um cliente e o servidor.
+ *
+ * A troca de chaves acontece no OI: cada lado gera um par X25519 efêmero e
+ *     envia a chave pública em hexadecimal. Do segredo comum, o HKDF-SHA256
+ *     (sal = chave do cliente + chave do servidor) deriva uma chave por
+ *     direção. Cada datagrama, já fragmentado, vira:
+ *
+ *     tipo (`SEALED_TYPE`) | sessão (ID do cliente) | contador (64 bits) |
+ *     datagrama cifrado com ChaCha20-Poly1305 | tag
+ *
+ *     em ordem de bytes de rede. O cabeçalho é autenticado junto; o nonce é o
+ *     contador da direção, que nunca se repete, e o receptor aceita cada
+ *     contador uma única vez dentro de uma janela de `SEAL_REPLAY_WINDOW`.
+ *
+ * O HKDF deriva também um segredo de retomada, que não cifra nada: com ele,
+ *     cliente e servidor provam um ao outro, por HMAC-SHA256 sobre um desafio
+ *     do servidor e as chaves novas, que uma nova troca de chaves feita em
+ *     claro (depois de o servidor reiniciar) vem da mesma sessão. O segredo é
+ *     o da primeira troca e passa de um canal para o seguinte.
+ *
+ * Os contextos do OpenSSL são criados com a chave uma única vez por direção;
+ *     cada datagrama só troca o nonce. Os envios podem vir de várias threads
+ *     (fan-out) e disputam um mutex por canal; a recepção tem o seu.
+ *
+ * A troca não autentica o servidor: protege contra escuta passiva e contra
+ *     datagramas forjados em nome de uma sessão, não contra um intermediário
+ *     ativo durante o OI.
+ */
+class SecureChannel
+{
+public:
+    /**
+     * @brief Par de chaves X25519.
+     */
+    struct KeyPair {
+        unsigned char privateKey[SEAL_KEY_SIZE];    /** Chave privada */
+        unsigned char publicKey[SEAL_KEY_SIZE];     /** Chave pública (enviada no OI) */
+    };
+
+    /// Destrutor
+    ~SecureChannel()
+    {
+        EVP_CIPHER_CTX_free(_sealer);
+        EVP_CIPHER_CTX_free(_opener);
+        OPENSSL_cleanse(_resume, sizeof(_resume));
+    }
+
+    SecureChannel(const SecureChannel&) = delete;
+    SecureChannel &operator=(const SecureChannel&) = delete;
+
+    /**
+     * @brief Gera um par de chaves efêmero.
+     *
+     * @retval `true` Se o par foi gerado
+     */
+    static bool generate(KeyPair &pair)
+    {
+        EVP_PKEY_CTX *context = EVP_PKEY_CTX_new_id(EVP_PKEY_X25519, nullptr);
+        EVP_PKEY *key = nullptr;
+        size_t privateSize = SEAL_KEY_SIZE, publicSize = SEAL_KEY_SIZE;
+
+        bool ok = context && EVP_PKEY_keygen_init(context) > 0 && EVP_PKEY_keygen(context, &key) > 0 &&
+                  EVP_PKEY_get_raw_private_key(key, pair.privateKey, &privateSize) > 0 &&
+                  EVP_PKEY_get_raw_public_key(key, pair.publicKey, &publicSize) > 0;
+
+        EVP_PKEY_free(key);
+        EVP_PKEY_CTX_free(context);
+        return ok;
+    }
+
+    /**
+     * @brief Cria o canal a partir do par local e da chave pública do outro lado.
+     *
+     * @param own Par de chaves local
+     * @param peer Chave pública recebida no OI
+     * @param client Este lado é o cliente (define a chave de cada direção)
+     * @param session ID do cliente, levado em cada datagrama
+     *
+     * @return std::unique_ptr<SecureChannel> Canal, ou nulo se a chave é inválida
+     */
+    static std::unique_ptr<SecureChannel> establish(const KeyPair &own, const unsigned char *peer, bool client,
+                                                    uint32_t session)
+    {
+        unsigned char secret[SEAL_KEY_SIZE];
+        unsigned char keys[3 * SEAL_KEY_SIZE];
+        unsigned char salt[2 * SEAL_KEY_SIZE];
+        static const char info[] = "mini-twitter sessao v1";
+
+        if (!agree(own.privateKey, peer, secret))
+            return nullptr;
+
+        memcpy(salt, client ? own.publicKey : peer, SEAL_KEY_SIZE);
+        memcpy(salt + SEAL_KEY_SIZE, client ? peer : own.publicKey, SEAL_KEY_SIZE);
+
+        EVP_PKEY_CTX *context = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
+        size_t size = sizeof(keys);
+
+        bool ok = context && EVP_PKEY_derive_init(context) > 0 &&
+                  EVP_PKEY_CTX_set_hkdf_md(context, EVP_sha256()) > 0 &&
+                  EVP_PKEY_CTX_set1_hkdf_salt(context, salt, sizeof(salt)) > 0 &&
+                  EVP_PKEY_CTX_set1_hkdf_key(context, secret, sizeof(secret)) > 0 &&
+                  EVP_PKEY_CTX_add1_hkdf_info(context, reinterpret_cast<const unsigned char*>(info),
+                                              sizeof(info) - 1) > 0 &&
+                  EVP_PKEY_derive(context, keys, &size) > 0;
+
+        EVP_PKEY_CTX_free(context);
+
+        if (!ok)
+            return nullptr;
+
+        // Primeira chave: cliente -> servidor; segunda: servidor -> cliente; terceira: retomada
+        std::unique_ptr<SecureChannel> channel(new SecureChannel(session, own.publicKey, peer));
+        memcpy(channel->_resume, keys + 2 * SEAL_KEY_SIZE, SEAL_KEY_SIZE);
+        const unsigned char *sendKey = client ? keys : keys + SEAL_KEY_SIZE;
+        const unsigned char *receiveKey = client ? keys + SEAL_KEY_SIZE : keys;
+
+        if (!channel->_sealer || !channel->_opener ||
+            EVP_EncryptInit_ex(channel->_sealer, EVP_chacha20_poly1305(), nullptr, sendKey, nullptr) <= 0 ||
+            EVP_DecryptInit_ex(channel->_opener, EVP_chacha20_poly1305(), nullptr, receiveKey, nullptr) <= 0)
+            return nullptr;
+
+        OPENSSL_cleanse(secret, sizeof(secret));
+        OPENSSL_cleanse(keys, sizeof(keys));
+        return channel;
+    }
+
+    /**
+     * @brief Cifra um datagrama.
+     *
+     * @param data Datagrama em claro (mensagem ou fragmento)
+     * @param size Tamanho do datagrama
+     * @param out Destino com pelo menos `size + SEAL_OVERHEAD` bytes
+     *
+     * @return size_t Tamanho do datagrama cifrado, ou 0 em caso de erro
+     */
+    size_t seal(const char *data, size_t size, char *out)
+    {
+        uint64_t counter = _sent.fetch_add(1, std::memory_order_relaxed);
+        unsigned char *header = reinterpret_cast<unsigned char*>(out);
+        unsigned char nonce[12];
+        int length;
+
+        writeHeader(header, counter);
+        makeNonce(nonce, counter);
+
+        std::lock_guard<std::mutex> lock(_sealMutex);
+
+        if (EVP_EncryptInit_ex(_sealer, nullptr, nullptr, nullptr, nonce) <= 0 ||
+            EVP_EncryptUpdate(_sealer, nullptr, &length, header, SEAL_HEADER_SIZE) <= 0 ||
+            EVP_EncryptUpdate(_sealer, header + SEAL_HEADER_SIZE, &length,
+                              reinterpret_cast<const unsigned char*>(data), static_cast<int>(size)) <= 0 ||
+            EVP_EncryptFinal_ex(_sealer, header + SEAL_HEADER_SIZE + length, &length) <= 0 ||
+            EVP_CIPHER_CTX_ctrl(_sealer, EVP_CTRL_AEAD_GET_TAG, SEAL_TAG_SIZE,
+                                header + SEAL_HEADER_SIZE + size) <= 0)
+            return 0;
+
+        return size + SEAL_OVERHEAD;
+    }
+
+    /**
+     * @brief Autentica e decifra um datagrama, no próprio buffer.
+     *
+     * @param datagram Datagrama cifrado; recebe o datagrama em claro no início
+     * @param size Tamanho do datagrama cifrado
+     *
+     * @return size_t Tamanho do datagrama em claro, ou 0 se for inválido,
+     *     forjado ou repetido
+     */
+    size_t open(char *datagram, size_t size)
+    {
+        if (size <= SEAL_OVERHEAD || sessionOf(datagram, size) != _session)
+            return 0;
+
+        unsigned char *header = reinterpret_cast<unsigned char*>(datagram);
+        unsigned char *payload = header + SEAL_HEADER_SIZE;
+        int textSize = static_cast<int>(size - SEAL_OVERHEAD);
+        unsigned char nonce[12];
+        uint64_t counter = 0;
+        int length;
+
+        for (int i = 0; i < 8; i++)
+            counter = (counter << 8) | header[8 + i];
+
+        std::lock_guard<std::mutex> lock(_openMutex);
+
+        if (!fresh(counter))
+            return 0;
+
+        makeNonce(nonce, counter);
+
+        if (EVP_DecryptInit_ex(_opener, nullptr, nullptr, nullptr, nonce) <= 0 ||
+            EVP_CIPHER_CTX_ctrl(_opener, EVP_CTRL_AEAD_SET_TAG, SEAL_TAG_SIZE, payload + textSize) <= 0 ||
+            EVP_DecryptUpdate(_opener, nullptr, &length, header, SEAL_HEADER_SIZE) <= 0 ||
+            EVP_DecryptUpdate(_opener, payload, &length, payload, textSize) <= 0 ||
+            EVP_DecryptFinal_ex(_opener, payload + length, &length) <= 0)
+            return 0;
+
+        // Só um datagrama autêntico avança a janela
+        accept(counter);
+        memmove(datagram, payload, textSize);
+        return static_cast<size_t>(textSize);
+    }
+
+    /**
+     * @brief Sessão do canal (ID do cliente).
+     */
+    uint32_t session() const { return _session; }
+
+    /**
+     * @brief Chave pública local (enviada de novo a um OI repetido).
+     */
+    const unsigned char *localKey() const { return _localKey; }
+
+    /**
+     * @brief Chave pública do outro lado (um OI repetido deve trazer a mesma).
+     */
+    const unsigned char *peerKey() const { return _peerKey; }
+
+    /**
+     * @brief Segredo de retomada da sessão (persistido pelo servidor).
+     */
+    const unsigned char *resumeKey() const { return _resume; }
+
+    /**
+     * @brief Mantém o segredo de retomada do canal anterior da sessão.
+     */
+    void adoptResume(const unsigned char *resume) { memcpy(_resume, resume, SEAL_KEY_SIZE); }
+
+    /**
+     * @brief Prova, com o segredo de retomada, uma etapa da nova troca de chaves.
+     *
+     * @param resume Segredo de retomada da sessão
+     * @param step Etapa (`pedido`, `troca` ou `resposta`)
+     * @param session ID do cliente
+     * @param challenge Desafio do pedido do servidor
+     * @param first Chave pública do cliente (nula no pedido)
+     * @param second Chave pública do servidor (só na resposta)
+     *
+     * @return std::string HMAC-SHA256 em hexadecimal
+     */
+    static std::string prove(const unsigned char *resume, std::string_view step, uint32_t session,
+                             uint64_t challenge, const unsigned char *first = nullptr,
+                             const unsigned char *second = nullptr)
+    {
+        std::string data(step);
+        data.push_back('\0');
+
+        for (int i = 24; i >= 0; i -= 8)
+            data.push_back(static_cast<char>(session >> i));
+
+        for (int i = 56; i >= 0; i -= 8)
+            data.push_back(static_cast<char>(challenge >> i));
+
+        if (first)
+            data.append(reinterpret_cast<const char*>(first), SEAL_KEY_SIZE);
+
+        if (second)
+            data.append(reinterpret_cast<const char*>(second), SEAL_KEY_SIZE);
+
+        unsigned char digest[EVP_MAX_MD_SIZE];
+        unsigned int size = 0;
+        HMAC(EVP_sha256(), resume, SEAL_KEY_SIZE, reinterpret_cast<const unsigned char*>(data.data()),
+             data.size(), digest, &size);
+
+        return toHex(digest);
+    }
+
+    /**
+     * @brief Confere uma prova recebida (comparação em tempo constante).
+     *
+     * @param expected Prova calculada com `prove`
+     * @param received Texto recebido, que deve começar com a prova
+     */
+    static bool matches(const std::string &expected, std::string_view received)
+    {
+        return received.size() >= expected.size() &&
+               CRYPTO_memcmp(expected.data(), received.data(), expected.size()) == 0;
+    }
+
+    /**
+     * @brief Verifica se um datagrama está cifrado.
+     */
+    static bool isSealed(const char *datagram, size_t size)
+    {
+        uint32_t type;
+
+        if (size < 4)
+            return false;
+
+        memcpy(&type, datagram, 4);
+        return ntohl(type) == SEALED_TYPE;
+    }
+
+    /**
+     * @brief Sessão de um datagrama cifrado.
+     */
+    static uint32_t sessionOf(const char *datagram, size_t size)
+    {
+        uint32_t session;
+
+        if (size < SEAL_HEADER_SIZE)
+            return 0;
+
+        memcpy(&session, datagram + 4, 4);
+        return ntohl(session);
+    }
+
+    /**
+     * @brief Codifica uma chave em hexadecimal (para o texto do OI).
+     */
+    static std::string toHex(const unsigned char *key)
+    {
+        static const char digits[] = "0123456789abcdef";
+        std::string text(2 * SEAL_KEY_SIZE, '0');
+
+        for (int i = 0; i < SEAL_KEY_SIZE; i++)
+        {
+            text[2 * i] = digits[key[i] >> 4];
+            text[2 * i + 1] = digits[key[i] & 0x0f];
+        }
+
+        return text;
+    }
+
+    /**
+     * @brief Lê uma chave em hexadecimal do início de um texto.
+     *
+     * @retval `true` Se o texto começa com `2 * SEAL_KEY_SIZE` dígitos
+     */
+    static bool fromHex(std::string_view text, unsigned char *key)
+    {
+        if (text.size() < 2 * SEAL_KEY_SIZE)
+            return false;
+
+        for (int i = 0; i < 2 * SEAL_KEY_SIZE; i++)
+        {
+            char c = text[i];
+            int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+
+            if (digit < 0)
+                return false;
+
+            key[i / 2] = static_cast<unsigned char>(i % 2 ? (key[i / 2] | digit) : digit << 4);
+        }
+
+        return true;
+    }
+
+private:
+    uint32_t _session;                          /** ID do cliente */
+    unsigned char _localKey[SEAL_KEY_SIZE];     /** Chave pública local */
+    unsigned char _peerKey[SEAL_KEY_SIZE];      /** Chave pública do outro lado */
+    unsigned char _resume[SEAL_KEY_SIZE];       /** Segredo de retomada da sessão */
+    EVP_CIPHER_CTX *_sealer;                    /** Contexto de envio, já com a chave */
+    EVP_CIPHER_CTX *_opener;                    /** Contexto de recepção, já com a chave */
+    std::mutex _sealMutex;                      /** Protege `_sealer` */
+    std::mutex _openMutex;                      /** Protege `_opener` e a janela */
+    std::atomic<uint64_t> _sent;                /** Próximo contador de envio */
+    uint64_t _highest;                          /** Maior contador recebido */
+    uint64_t _window;                           /** Bit `i`: contador `_highest - i` já recebido */
+
+    SecureChannel(uint32_t session, const unsigned char *local, const unsigned char *peer)
+        : _session(session), _sealer(EVP_CIPHER_CTX_new()), _opener(EVP_CIPHER_CTX_new()), _sent(0),
+          _highest(0), _window(0)
+    {
+        memcpy(_localKey, local, SEAL_KEY_SIZE);
+        memcpy(_peerKey, peer, SEAL_KEY_SIZE);
+    }
+
+    static bool agree(const unsigned char *privateKey, const unsigned char *peer, unsigned char *secret)
+    {
+        EVP_PKEY *own = EVP_PKEY_new_raw_private_key(EVP_PKEY_X25519, nullptr, privateKey, SEAL_KEY_SIZE);
+        EVP_PKEY *other = EVP_PKEY_new_raw_public_key(EVP_PKEY_X25519, nullptr, peer, SEAL_KEY_SIZE);
+        EVP_PKEY_CTX *context = own ? EVP_PKEY_CTX_new(own, nullptr) : nullptr;
+        size_t size = SEAL_KEY_SIZE;
+
+        // Uma chave de ordem baixa dá segredo nulo, e a derivação falha
+        bool ok = other && context && EVP_PKEY_derive_init(context) > 0 &&
+                  EVP_PKEY_derive_set_peer(context, other) > 0 && EVP_PKEY_derive(context, secret, &size) > 0;
+
+        EVP_PKEY_CTX_free(context);
+        EVP_PKEY_free(other);
+        EVP_PKEY_free(own);
+        return ok;
+    }
+
+    void writeHeader(unsigned char *header, uint64_t counter) const
+    {
+        uint32_t type = htonl(SEALED_TYPE), session = htonl(_session);
+        memcpy(header, &type, 4);
+        memcpy(header + 4, &session, 4);
+
+        for (int i = 0; i < 8; i++)
+            header[8 + i] = static_cast<unsigned char>(counter >> (56 - 8 * i));
+    }
+
+    static void makeNonce(unsigned char *nonce, uint64_t counter)
+    {
+        memset(nonce, 0, 4);
+
+        for (int i = 0; i < 8; i++)
+            nonce[4 + i] = static_cast<unsigned char>(counter >> (56 - 8 * i));
+    }
+
+    bool fresh(uint64_t counter) const
+    {
+        if (counter > _highest || (_highest == 0 && _window == 0))
+            return true;
+
+        uint64_t age = _highest - counter;
+        return age < SEAL_REPLAY_WINDOW && !(_window & (1ULL << age));
+    }
+
+    void accept(uint64_t counter)
+    {
+        if (_window == 0 || counter > _highest)
+        {
+            uint64_t shift = _window == 0 ? 0 : counter - _highest;
+            _window = shift >= SEAL_REPLAY_WINDOW ? 0 : _window << shift;
+            _window |= 1;
+            _highest = counter;
+        }
+        else
+        {
+            _window |= 1ULL << (_highest - counter);
+        }
+    }
+};
+
+/**
+ * @brief Envia um datagrama, cifrado se houver canal.
+ *
+ * @param sockfd Descritor de socket para envio
+ * @param addr Endereço do destinatário
+ * @param data Datagrama em claro (até `MAX_DATAGRAM_SIZE` bytes)
+ * @param size Tamanho do datagrama
+ * @param channel Canal da sessão do destinatário (nulo = em claro)
+ *
+ * @return ssize_t Resultado do `sendto`
+ */
+inline ssize_t sendDatagram(int sockfd, const struct sockaddr_in &addr, const char *data, size_t size,
+                            SecureChannel *channel)
+{
+    if (!channel)
+        return sendto(sockfd, data, size, 0, (const struct sockaddr*)&addr, sizeof(addr));
+
+    char sealed[size + SEAL_OVERHEAD];
+    size_t sealedSize = channel->seal(data, size, sealed);
+
+    if (sealedSize == 0)
+        return -1;
+
+    return sendto(sockfd, sealed, sealedSize, 0, (const struct sockaddr*)&addr, sizeof(addr));
+}
+
+#endif
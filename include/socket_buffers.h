@@ -0,0 +1,203 @@
+#ifndef SOCKET_BUFFERS_H
+#define SOCKET_BUFFERS_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#define SOCKET_RECEIVE_BUFFER (4 << 20)     /** Buffer de recepção inicial (bytes) */
+#define SOCKET_SEND_BUFFER (4 << 20)        /** Buffer de envio inicial (bytes) */
+#define SOCKET_RECEIVE_LIMIT (64 << 20)     /** Maior buffer de recepção do crescimento automático */
+#define SOCKET_GROW_INTERVAL_MS 1000        /** Intervalo mínimo entre dois crescimentos */
+
+/**
+ * @brief Buffers de um socket UDP e descartes do kernel.
+ *
+ * Quando o buffer de recepção enche, o kernel descarta os datagramas sem
+ *     aviso. O contador desses descartes chega de duas formas: junto com
+ *     cada datagrama recebido (`SO_RXQ_OVFL`, sem custo extra) e pela linha
+ *     do socket em `/proc/net/udp`, lida só no status. Ao ver descartes novos
+ *     na recepção, o buffer dobra, no máximo uma vez por
+ *     `SOCKET_GROW_INTERVAL_MS` e até o limite configurado.
+ *
+ * Os tamanhos são os valores do kernel, que reserva o dobro do pedido para
+ *     controle. Sem `CAP_NET_ADMIN`, o kernel limita o pedido a
+ *     `net.core.rmem_max` / `net.core.wmem_max`.
+ */
+class SocketBuffers
+{
+public:
+    /**
+     * @brief Construtor da classe SocketBuffers.
+     *
+     * @param sockfd Socket UDP
+     * @param receive Buffer de recepção (bytes)
+     * @param send Buffer de envio (bytes)
+     * @param receiveLimit Limite do crescimento do buffer de recepção (bytes)
+     */
+    SocketBuffers(int sockfd, int receive, int send, int receiveLimit)
+        : _sockfd(sockfd), _inode(0), _lastOverflow(0), _kernelDrops(0), _growths(0),
+          _capped(false), _lastGrowth()
+    {
+        struct stat info;
+        if (fstat(sockfd, &info) == 0)
+            _inode = static_cast<unsigned long>(info.st_ino);
+
+        int enable = 1;
+        setsockopt(sockfd, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable));
+
+        configure(receive, send, receiveLimit);
+    }
+
+    /**
+     * @brief Redefine os tamanhos dos buffers.
+     *
+     * Pode ser chamado com a recepção em andamento.
+     *
+     * @param receive Buffer de recepção (bytes)
+     * @param send Buffer de envio (bytes)
+     * @param receiveLimit Limite do crescimento do buffer de recepção (bytes)
+     */
+    void configure(int receive, int send, int receiveLimit)
+    {
+        _receiveLimit = std::max(receive, receiveLimit);
+        _capped = false;
+
+        apply(SO_RCVBUF, receive);
+        apply(SO_SNDBUF, send);
+    }
+
+    /**
+     * @brief Acompanha o contador de descartes recebido com um datagrama.
+     *
+     * Chamado apenas pela thread de recepção.
+     *
+     * @param overflow Contador acumulado de `SO_RXQ_OVFL`
+     *
+     * @retval `true` Se o buffer de recepção cresceu
+     * @retval `false` Caso contrário
+     */
+    bool observe(uint32_t overflow)
+    {
+        if (overflow == _lastOverflow)
+            return false;
+
+        _kernelDrops += static_cast<uint32_t>(overflow - _lastOverflow);
+        _lastOverflow = overflow;
+
+        auto now = std::chrono::steady_clock::now();
+        if (_capped || now - _lastGrowth < std::chrono::milliseconds(SOCKET_GROW_INTERVAL_MS))
+            return false;
+
+        _lastGrowth = now;
+
+        int current = size(SO_RCVBUF) / 2;
+        int limit = _receiveLimit;
+
+        if (current >= limit)
+        {
+            _capped = true;
+            return false;
+        }
+
+        apply(SO_RCVBUF, std::min(current * 2, limit));
+
+        // O kernel recusou crescer (`net.core.rmem_max`): não tenta de novo
+        if (size(SO_RCVBUF) / 2 <= current)
+        {
+            _capped = true;
+            return false;
+        }
+
+        _growths++;
+        return true;
+    }
+
+    /**
+     * @brief Descartes do kernel por buffer cheio.
+     *
+     * Usa a linha do socket em `/proc/net/udp` quando disponível, que também
+     *     conta descartes ainda não vistos pela recepção.
+     */
+    unsigned long kernelDrops() const
+    {
+        std::ifstream file("/proc/net/udp");
+        std::string line;
+
+        std::getline(file, line);
+
+        while (_inode && std::getline(file, line))
+        {
+            // sl local rem st tx:rx tr:when retrnsmt uid timeout inode ref pointer drops
+            std::istringstream fields(line);
+            std::string field[13];
+
+            for (auto &value : field)
+                fields >> value;
+
+            if (fields.fail() || std::stoul(field[9]) != _inode)
+                continue;
+
+            return std::max(std::stoul(field[12]), _kernelDrops.load());
+        }
+
+        return _kernelDrops;
+    }
+
+    /**
+     * @brief Tamanho atual do buffer de recepção (valor do kernel).
+     */
+    int receiveSize() const { return size(SO_RCVBUF); }
+
+    /**
+     * @brief Tamanho atual do buffer de envio (valor do kernel).
+     */
+    int sendSize() const { return size(SO_SNDBUF); }
+
+    /**
+     * @brief Quantas vezes o buffer de recepção cresceu.
+     */
+    unsigned long growths() const { return _growths; }
+
+    /**
+     * @brief Indica se o crescimento chegou ao limite (configurado ou do kernel).
+     */
+    bool capped() const { return _capped; }
+
+private:
+    int _sockfd;                                /** Socket UDP */
+    unsigned long _inode;                       /** Inode do socket (linha em `/proc/net/udp`) */
+    std::atomic<int> _receiveLimit;             /** Limite do buffer de recepção */
+    uint32_t _lastOverflow;                     /** Último valor de `SO_RXQ_OVFL` */
+    std::atomic<unsigned long> _kernelDrops;    /** Descartes vistos pela recepção */
+    std::atomic<unsigned long> _growths;        /** Crescimentos do buffer de recepção */
+    std::atomic<bool> _capped;                  /** Crescimento esgotado */
+    std::chrono::steady_clock::time_point _lastGrowth;  /** Último crescimento */
+
+    /**
+     * @brief Pede um tamanho de buffer, acima de `rmem_max`/`wmem_max` se permitido.
+     */
+    void apply(int option, int bytes)
+    {
+        int force = option == SO_RCVBUF ? SO_RCVBUFFORCE : SO_SNDBUFFORCE;
+
+        if (setsockopt(_sockfd, SOL_SOCKET, force, &bytes, sizeof(bytes)) < 0)
+            setsockopt(_sockfd, SOL_SOCKET, option, &bytes, sizeof(bytes));
+    }
+
+    int size(int option) const
+    {
+        int bytes = 0;
+        socklen_t length = sizeof(bytes);
+        getsockopt(_sockfd, SOL_SOCKET, option, &bytes, &length);
+        return bytes;
+    }
+};
+
+#endif
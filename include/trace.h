@@ -0,0 +1,181 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define TRACE_VERSION 1             /** Versão do formato do arquivo de trace */
+#define TRACE_BUFFER_RECORDS 4096   /** Registros acumulados antes de cada escrita */
+
+/**
+ * @brief Etapas de uma mensagem registradas no trace, em ordem.
+ */
+enum TraceStage : uint8_t
+{
+    TRACE_CLIENT_SEND = 0,      /** Cliente entregou a mensagem ao socket */
+    TRACE_SERVER_RECEIVE = 1,   /** Servidor recebeu e validou o datagrama */
+    TRACE_SERVER_DEQUEUE = 2,   /** Uma thread de processamento retirou a mensagem da fila */
+    TRACE_FANOUT_START = 3,     /** Início do envio aos destinatários */
+    TRACE_FANOUT_END = 4,       /** Fim do envio aos destinatários */
+    TRACE_RENDER = 5,           /** Destinatário exibiu a mensagem */
+    TRACE_STAGES = 6
+};
+
+/**
+ * @brief Registro do arquivo de trace.
+ *
+ * Uma mensagem é identificada pela origem e pelo número de sequência do
+ *     cliente. No broadcast, o servidor troca a sequência pela posição na
+ *     linha do tempo; os registros de fan-out guardam essa posição em `link`
+ *     para que a ferramenta de relatório ligue as duas numerações.
+ */
+struct TraceRecord {
+    uint64_t timestamp;     /** Relógio monotônico em ns (comum aos processos do mesmo host) */
+    int32_t origin;         /** ID de origem da mensagem */
+    int32_t sequence;       /** Sequência vista nesta etapa */
+    int32_t link;           /** Fan-out: sequência entregue; exibição: ID do destinatário */
+    uint8_t stage;          /** Etapa (`TraceStage`) */
+    uint8_t reserved[3];    /** Sempre zero */
+};
+
+static_assert(sizeof(TraceRecord) == 24, "TraceRecord deve ter 24 bytes");
+
+/**
+ * @brief Gravação de um trace de latência amostrado.
+ *
+ * Cada processo grava o seu próprio arquivo: um cabeçalho ("MTTR" e a
+ *     versão) seguido de `TraceRecord`s, acumulados em memória e escritos em
+ *     blocos. Só as mensagens amostradas são registradas; a amostra é decidida
+ *     por quem vê a mensagem primeiro e segue com ela pela flag `TRACED`.
+ */
+class Tracer
+{
+public:
+    /**
+     * @brief Construtor da classe Tracer.
+     *
+     * @param path Arquivo de trace (sobrescrito)
+     * @param fraction Fração das mensagens amostradas (0 a 1)
+     */
+    Tracer(const std::string &path, double fraction) : _fraction(fraction)
+    {
+        _fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+        if (_fd >= 0)
+        {
+            char header[8] = {'M', 'T', 'T', 'R'};
+            uint32_t version = TRACE_VERSION;
+            memcpy(header + 4, &version, sizeof(version));
+
+            if (::write(_fd, header, sizeof(header)) != sizeof(header))
+            {
+                close(_fd);
+                _fd = -1;
+            }
+        }
+
+        _records.reserve(TRACE_BUFFER_RECORDS);
+    }
+
+    /// Destrutor
+    ~Tracer()
+    {
+        flush();
+
+        if (_fd >= 0)
+            close(_fd);
+    }
+
+    /**
+     * @brief Indica se o arquivo foi aberto.
+     */
+    bool isOpen() const { return _fd >= 0; }
+
+    /**
+     * @brief Decide se uma mensagem nova entra na amostra.
+     */
+    bool sample()
+    {
+        thread_local std::minstd_rand generator(std::random_device{}());
+        thread_local std::uniform_real_distribution<double> distribution(0.0, 1.0);
+
+        return _fraction > 0 && distribution(generator) < _fraction;
+    }
+
+    /**
+     * @brief Registra uma etapa com o horário atual.
+     *
+     * @param stage Etapa
+     * @param origin ID de origem da mensagem
+     * @param sequence Sequência vista nesta etapa
+     * @param link Ligação da etapa (veja `TraceRecord`)
+     */
+    void record(TraceStage stage, int origin, int sequence, int link = 0)
+    {
+        TraceRecord entry = {};
+        entry.timestamp = now();
+        entry.origin = origin;
+        entry.sequence = sequence;
+        entry.link = link;
+        entry.stage = stage;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _records.push_back(entry);
+
+        if (_records.size() >= TRACE_BUFFER_RECORDS)
+            write();
+    }
+
+    /**
+     * @brief Escreve os registros acumulados.
+     */
+    void flush()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        write();
+    }
+
+    /**
+     * @brief Relógio monotônico em nanossegundos.
+     */
+    static uint64_t now()
+    {
+        struct timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return static_cast<uint64_t>(time.tv_sec) * 1000000000ULL + time.tv_nsec;
+    }
+
+private:
+    int _fd;                                /** Arquivo de trace */
+    double _fraction;                       /** Fração amostrada */
+    std::vector<TraceRecord> _records;      /** Registros ainda não escritos */
+    std::mutex _mutex;                      /** Protege os registros */
+
+    /**
+     * @brief Escreve os registros acumulados (com o mutex travado).
+     */
+    void write()
+    {
+        if (_fd >= 0 && !_records.empty())
+        {
+            size_t size = _records.size() * sizeof(TraceRecord);
+
+            if (::write(_fd, _records.data(), size) != static_cast<ssize_t>(size))
+            {
+                close(_fd);
+                _fd = -1;
+            }
+        }
+
+        _records.clear();
+    }
+};
+
+#endif
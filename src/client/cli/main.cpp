@@ -0,0 +1,473 @@
+#include "../core/client.h"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+static std::atomic<bool> stopRequested(false);
+
+static void handleSignal(int)
+{
+    stopRequested = true;
+}
+
+static void usage(const char *program)
+{
+    std::cerr << "Uso: " << program << " <Usuário> <IP> <Porta> [opções]\n"
+              << "  --tail        Continua recebendo após o fim da entrada (até SIGINT/SIGTERM)\n"
+              << "  --wait <seg>  Espera por respostas após o fim da entrada (padrão 1)\n"
+              << "  --rate <n>    Limita os envios a n por segundo (padrão sem limite)\n"
+              << "  --timeout <seg>  Espera máxima pela resposta do servidor ao conectar (padrão "
+              << TIMEOUT_TIME << ")\n"
+              << "  --trace <arquivo> <fração>  Registra a latência de uma amostra das mensagens\n"
+              << "  --no-multicast  Recebe os broadcasts por unicast mesmo que o servidor ofereça multicast\n"
+              << "  --no-encryption  Não cifra a sessão (por padrão, cifra se o servidor aceitar)\n"
+              << "\n"
+              << "Cada linha da entrada padrão é um comando:\n"
+              << "  <texto>             Tweet para todos\n"
+              << "  /dm <ID> <texto>    Mensagem privada\n"
+              << "  /list               Lista os clientes conectados\n"
+              << "  /buscar <termos>    Busca nos tweets recentes\n"
+              << "  /mais               Próxima página da busca\n"
+              << "  /grupo <criar|entrar|sair> <nome>  Cria, entra ou sai de um grupo\n"
+              << "  /g <ID do grupo> <texto>  Mensagem ao grupo\n"
+              << "  /agendar <+seg|HH:MM> [@ID] <texto>  Agenda um tweet (ou DM com @ID)\n"
+              << "  /cancelar <ticket>  Cancela um tweet agendado\n"
+              << "  /online | /ausente | /digitando  Muda o estado de presença\n"
+              << "  /sair               Desconecta\n"
+              << "\n"
+              << "A saída tem uma linha por evento, com campos separados por tabulação:\n"
+              << "  ID <id> | TWEET <id> <usuário> <texto> | DM <id> <usuário> <texto> |\n"
+              << "  LIST <id> <usuário> | BUSCA <linha> | AGENDADO <ticket> <ms desde 1970> |\n"
+              << "  CANCELADO <ticket> | GRUPO <criado|entrou|saiu> <ID do grupo> <nome> |\n"
+              << "  GMSG <ID do grupo> <id> <usuário> <texto> |\n"
+              << "  PRESENCA <id> <usuário> <online|ausente|digitando|offline> | ERRO <texto>"
+              << std::endl;
+}
+
+// Mantém uma linha por evento: quebras de linha e tabulações do texto são escapadas
+static std::string escape(std::string_view text)
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+
+    for (char c : text)
+    {
+        if (c == '\n')
+            escaped += "\\n";
+        else if (c == '\t')
+            escaped += "\\t";
+        else if (c == '\\')
+            escaped += "\\\\";
+        else
+            escaped.push_back(c);
+    }
+
+    return escaped;
+}
+
+static void printMessage(Client &client, const Message &message)
+{
+    switch (message.getType())
+    {
+    case Message::MSG:
+        // Relatórios de status vão para a saída de erro
+        if (message.getTextView().rfind("STATUS: ", 0) == 0)
+        {
+            if (message.getDestinationID() == client.getId())
+                std::cerr << message.getTextView() << std::endl;
+            break;
+        }
+
+        std::cout << (message.getDestinationID() == 0 ? "TWEET\t" : "DM\t") << message.getOriginID() << '\t'
+                  << message.getUsernameView() << '\t' << escape(message.getTextView()) << std::endl;
+        client.traceRender(message);
+        break;
+
+    case Message::LIST:
+    {
+        std::istringstream stream(message.getText());
+        std::string line;
+
+        while (std::getline(stream, line))
+        {
+            size_t colon = line.find(':');
+            if (colon != std::string::npos)
+                std::cout << "LIST\t" << line.substr(0, colon) << '\t' << line.substr(colon + 1) << '\n';
+        }
+
+        std::cout.flush();
+        break;
+    }
+
+    case Message::SEARCH:
+    {
+        std::istringstream stream(message.getText());
+        std::string line;
+
+        while (std::getline(stream, line))
+            std::cout << "BUSCA\t" << escape(line) << '\n';
+
+        std::cout.flush();
+        break;
+    }
+
+    case Message::SCHEDULE:
+    {
+        std::istringstream stream(message.getText());
+        uint32_t ticket = 0;
+        long long when = 0;
+
+        if (stream >> ticket >> when)
+            std::cout << "AGENDADO\t" << ticket << '\t' << when << std::endl;
+        break;
+    }
+
+    case Message::UNSCHEDULE:
+        std::cout << "CANCELADO\t" << message.getTextView() << std::endl;
+        break;
+
+    case Message::GROUP_CREATE:
+    case Message::GROUP_JOIN:
+    case Message::GROUP_LEAVE:
+    {
+        std::string text = message.getText();
+        size_t space = text.find(' ');
+        const char *event = message.getType() == Message::GROUP_CREATE ? "criado"
+                          : message.getType() == Message::GROUP_JOIN ? "entrou" : "saiu";
+
+        if (space != std::string::npos)
+            std::cout << "GRUPO\t" << event << '\t' << text.substr(0, space) << '\t' << text.substr(space + 1)
+                      << std::endl;
+        break;
+    }
+
+    case Message::GROUP_MSG:
+        std::cout << "GMSG\t" << message.getDestinationID() << '\t' << message.getOriginID() << '\t'
+                  << message.getUsernameView() << '\t' << escape(message.getTextView()) << std::endl;
+        break;
+
+    case Message::PRESENCE:
+        for (const Client::PresenceUpdate &update : client.applyPresence(message))
+            std::cout << "PRESENCA\t" << update.id << '\t' << update.username << '\t'
+                      << Client::presenceName(update.state) << '\n';
+
+        std::cout.flush();
+        break;
+
+    case Message::ERRO:
+        std::cout << "ERRO\t" << escape(message.getTextView()) << std::endl;
+        break;
+    }
+}
+
+// Converte "+segundos" ou "HH:MM" (próxima ocorrência, no fuso local) em ms desde 1970
+static bool parseWhen(const std::string &spec, int64_t &when)
+{
+    auto now = std::chrono::system_clock::now();
+    char *end = nullptr;
+
+    if (spec.size() > 1 && spec[0] == '+')
+    {
+        long seconds = strtol(spec.c_str() + 1, &end, 10);
+
+        if (*end != '\0' || seconds < 0)
+            return false;
+
+        when = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() + seconds * 1000LL;
+        return true;
+    }
+
+    int hour, minute;
+    char extra;
+
+    if (sscanf(spec.c_str(), "%d:%d%c", &hour, &minute, &extra) != 2 || hour < 0 || hour > 23 || minute < 0 ||
+        minute > 59)
+        return false;
+
+    std::time_t current = std::chrono::system_clock::to_time_t(now);
+    std::tm local = *std::localtime(&current);
+    local.tm_hour = hour;
+    local.tm_min = minute;
+    local.tm_sec = 0;
+    local.tm_isdst = -1;
+
+    std::time_t target = std::mktime(&local);
+
+    if (target <= current)
+    {
+        local.tm_mday++;
+        local.tm_isdst = -1;
+        target = std::mktime(&local);
+    }
+
+    when = static_cast<int64_t>(target) * 1000;
+    return true;
+}
+
+// Interpreta uma linha da entrada; retorna `false` para encerrar
+static bool runCommand(Client &client, const std::string &line, std::string &searchQuery, int &searchPage)
+{
+    if (line.empty())
+        return true;
+
+    if (line == "/sair")
+        return false;
+
+    if (line == "/list")
+    {
+        client.sendMessage("", Message::LIST);
+    }
+    else if (line == "/online" || line == "/ausente" || line == "/digitando")
+    {
+        client.setPresence(line == "/online" ? Message::PRESENCE_ONLINE
+                           : line == "/ausente" ? Message::PRESENCE_AWAY : Message::PRESENCE_TYPING);
+    }
+    else if (line.rfind("/dm ", 0) == 0)
+    {
+        std::istringstream stream(line.substr(4));
+        int destinationID = 0;
+        std::string text;
+
+        if (!(stream >> destinationID) || destinationID <= 0 || !std::getline(stream >> std::ws, text))
+        {
+            std::cerr << "Uso: /dm <ID> <texto>" << std::endl;
+            return true;
+        }
+
+        client.sendMessage(text, Message::MSG, destinationID);
+    }
+    else if (line.rfind("/grupo ", 0) == 0)
+    {
+        std::istringstream stream(line.substr(7));
+        std::string action, name;
+        stream >> action >> name;
+
+        Message::MessageType type = action == "criar" ? Message::GROUP_CREATE
+                                  : action == "entrar" ? Message::GROUP_JOIN
+                                  : action == "sair" ? Message::GROUP_LEAVE : Message::ERRO;
+
+        if (type == Message::ERRO || name.empty())
+        {
+            std::cerr << "Uso: /grupo <criar|entrar|sair> <nome>" << std::endl;
+            return true;
+        }
+
+        client.sendMessage(name, type);
+    }
+    else if (line.rfind("/g ", 0) == 0)
+    {
+        std::istringstream stream(line.substr(3));
+        int groupID = 0;
+        std::string text;
+
+        if (!(stream >> groupID) || groupID <= 0 || !std::getline(stream >> std::ws, text) ||
+            text.size() > MAX_TEXT_SIZE)
+        {
+            std::cerr << "Uso: /g <ID do grupo> <texto>" << std::endl;
+            return true;
+        }
+
+        client.sendMessage(text, Message::GROUP_MSG, groupID);
+    }
+    else if (line.rfind("/agendar ", 0) == 0)
+    {
+        std::istringstream stream(line.substr(9));
+        std::string spec, text;
+        int destinationID = 0;
+        int64_t when = 0;
+
+        stream >> spec >> std::ws;
+
+        if (stream.peek() == '@' && (!(stream.ignore() >> destinationID) || destinationID <= 0))
+            destinationID = -1;
+
+        if (!parseWhen(spec, when) || destinationID < 0 || !std::getline(stream >> std::ws, text))
+        {
+            std::cerr << "Uso: /agendar <+segundos|HH:MM> [@ID] <texto>" << std::endl;
+            return true;
+        }
+
+        client.scheduleMessage(text, when, destinationID);
+    }
+    else if (line.rfind("/cancelar ", 0) == 0)
+    {
+        char *end = nullptr;
+        unsigned long ticket = strtoul(line.c_str() + 10, &end, 10);
+
+        if (ticket == 0 || ticket > UINT32_MAX || *end != '\0')
+        {
+            std::cerr << "Uso: /cancelar <ticket>" << std::endl;
+            return true;
+        }
+
+        client.cancelScheduled(static_cast<uint32_t>(ticket));
+    }
+    else if (line.rfind("/buscar ", 0) == 0 || line == "/mais")
+    {
+        if (line != "/mais")
+        {
+            searchQuery = line.substr(8);
+            searchPage = 0;
+        }
+        else
+        {
+            searchPage++;
+        }
+
+        client.sendMessage(searchQuery, Message::SEARCH, searchPage);
+    }
+    else if (line.size() > MAX_TEXT_SIZE)
+    {
+        std::cerr << "O tweet não pode ter mais de " << MAX_TEXT_SIZE << " caracteres." << std::endl;
+    }
+    else
+    {
+        client.sendMessage(line);
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bool tail = false, multicast = true, encryption = true;
+    int wait = 1;
+    int rate = 0;
+    int timeout = TIMEOUT_TIME;
+    std::string trace;
+    double traceFraction = 0;
+
+    for (int i = 4; i < argc; i++)
+    {
+        std::string option = argv[i];
+
+        if (option == "--tail")
+        {
+            tail = true;
+        }
+        else if (option == "--no-multicast")
+        {
+            multicast = false;
+        }
+        else if (option == "--no-encryption")
+        {
+            encryption = false;
+        }
+        else if (option == "--wait" && i + 1 < argc)
+        {
+            wait = std::stoi(argv[++i]);
+        }
+        else if (option == "--rate" && i + 1 < argc)
+        {
+            rate = std::stoi(argv[++i]);
+        }
+        else if (option == "--timeout" && i + 1 < argc)
+        {
+            timeout = std::stoi(argv[++i]);
+        }
+        else if (option == "--trace" && i + 2 < argc)
+        {
+            trace = argv[++i];
+            traceFraction = std::stod(argv[++i]);
+        }
+        else
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Sem SA_RESTART: um sinal também interrompe a leitura da entrada
+    struct sigaction action = {};
+    action.sa_handler = handleSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    std::ios::sync_with_stdio(false);
+
+    Client client(argv[1], argv[2], std::stoi(argv[3]));
+    client.setMulticast(multicast);
+    client.setEncryption(encryption);
+
+    if (!client.connectToServer(timeout))
+    {
+        std::cerr << "Sem resposta do servidor" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "ID\t" << client.getId() << std::endl;
+
+    if (!trace.empty() && !client.enableTracing(trace, traceFraction))
+        std::cerr << "Não foi possível abrir o arquivo de trace" << std::endl;
+
+    // A recepção corre em paralelo: os envios não esperam pelas respostas, e
+    //     o timeout deixa a thread perceber o pedido de parada
+    std::atomic<bool> receiving(true);
+    client.setTimeout(1);
+
+    std::thread receiver([&client, &receiving]() {
+        while (receiving)
+        {
+            Message *message = client.receiveMessages();
+
+            if (message)
+            {
+                printMessage(client, *message);
+                delete message;
+            }
+        }
+    });
+
+    std::string line, searchQuery;
+    int searchPage = 0;
+    bool quit = false;
+
+    // Com `--rate`, cada envio tem um horário marcado; sem ele, os comandos são
+    //     enviados tão rápido quanto chegam
+    auto interval = std::chrono::nanoseconds(rate > 0 ? 1000000000 / rate : 0);
+    auto nextSend = std::chrono::steady_clock::now();
+
+    while (!stopRequested && std::getline(std::cin, line))
+    {
+        if (rate > 0)
+        {
+            std::this_thread::sleep_until(nextSend);
+            nextSend += interval;
+        }
+
+        if (!runCommand(client, line, searchQuery, searchPage))
+        {
+            quit = true;
+            break;
+        }
+    }
+
+    if (tail && !quit)
+    {
+        while (!stopRequested)
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    else if (!quit)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(wait);
+
+        while (!stopRequested && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    client.sendMessage("", Message::TCHAU);
+    receiving = false;
+    receiver.join();
+
+    return EXIT_SUCCESS;
+}
@@ -3,41 +3,99 @@
 #include <sstream>
 #include <thread>
 #include <unistd.h>
+#include <algorithm>
+#include <poll.h>
+#include <cerrno>
+#include <charconv>
 
 Client::Client(const std::string &username, const std::string &ip, int port)
-    : _username(username), _running(false)
+    : _id(0), _username(username), _sequence(0), _running(false), _compression(false), _timeout(0),
+      _multicastWanted(true), _multicastfd(-1), _multicastConfirmed(false), _recentCount(0),
+      _encryptionWanted(true), _rekeying(false), _rekeyChallenge(0), _presence(Message::PRESENCE_ONLINE)
 {
     if ((_sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
         error("Failed to create socket");
 
+    int receiveBuffer = CLIENT_RECEIVE_BUFFER;
+    setsockopt(_sockfd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+
     memset(&_serverAddr, 0, sizeof(_serverAddr));
     _serverAddr.sin_family = AF_INET;
     _serverAddr.sin_addr.s_addr = inet_addr(ip.c_str());
     _serverAddr.sin_port = htons(port);
+    _filter.server = _serverAddr;
 }
 
 Client::~Client()
 {
     _running = false;
     close(_sockfd);
+
+    if (_multicastfd >= 0)
+        close(_multicastfd);
 }
 
-int Client::connectToServer()
+int Client::connectToServer(int timeout)
 {
-    setTimeout(TIMEOUT_TIME);
+    setTimeout(timeout);
+
+    // Par efêmero: a chave pública vai no texto do OI
+    SecureChannel::KeyPair keys;
+    bool offerKey = _encryptionWanted && SecureChannel::generate(keys);
     
-    Message message(Message::OI, _id, 0, _username, "");
+    Message message(Message::OI, _id, 0, _username, offerKey ? SecureChannel::toHex(keys.publicKey) : "");
+    message.setFlag(Message::ACCEPTS_COMPRESSION);
+    if (_multicastWanted)
+        message.setFlag(Message::ACCEPTS_MULTICAST);
+    if (offerKey)
+        message.setFlag(Message::ACCEPTS_ENCRYPTION);
     message.send(_sockfd, _serverAddr);
 
-    Message* response = Message::receive(_sockfd, _serverAddr, BUFFER_SIZE);
+    Message* response = receiveMessages();
 
     if (response)
     {
+        if (response->getType() == Message::ERRO)
+        {
+            std::clog << response->getText() << std::endl;
+            delete response;
+            return 0;
+        }
+
         if (response->getType() == 0)
         {
             _id = response->getDestinationID();
+            _compression = response->hasFlag(Message::ACCEPTS_COMPRESSION);
+
+            unsigned char serverKey[SEAL_KEY_SIZE];
+
+            if (offerKey && response->hasFlag(Message::ACCEPTS_ENCRYPTION))
+            {
+                std::shared_ptr<SecureChannel> channel;
+
+                if (!SecureChannel::fromHex(response->getTextView(), serverKey) ||
+                    !(channel = SecureChannel::establish(keys, serverKey, true, static_cast<uint32_t>(_id))))
+                {
+                    std::clog << "Falha na troca de chaves com o servidor" << std::endl;
+                    delete response;
+                    return 0;
+                }
+
+                std::atomic_store(&_channel, channel);
+                _filter.channel = channel.get();
+            }
+            else if (offerKey)
+            {
+                std::clog << "Servidor sem suporte a cifragem; sessão em claro" << std::endl;
+            }
+
+            OPENSSL_cleanse(keys.privateKey, sizeof(keys.privateKey));
             _running = true;
-            std::cout << "Connected to server with ID: " << _id << std::endl;
+            std::clog << "Connected to server with ID: " << _id << std::endl;
+
+            if (_multicastWanted && response->hasFlag(Message::ACCEPTS_MULTICAST) &&
+                !joinMulticast(response->getText()))
+                std::clog << "Multicast indisponível; broadcasts por unicast" << std::endl;
         }
 
         delete response;
@@ -54,25 +112,396 @@ int Client::connectToServer()
 void Client::sendMessage(const std::string &msg, Message::MessageType messageType, int destinationID)
 {
     Message message(messageType, _id, destinationID, _username, msg);
-    message.send(_sockfd, _serverAddr);
+
+    if (messageType == Message::GROUP_MSG)
+        message.setSequence(++_sequence);
+
+    if (messageType == Message::MSG)
+    {
+        message.setSequence(++_sequence);
+
+        if (_tracer && _tracer->sample())
+        {
+            message.setFlag(Message::TRACED);
+            _tracer->record(TRACE_CLIENT_SEND, _id, _sequence);
+        }
+    }
+
+    transmit(message, _compression);
+}
+
+void Client::transmit(const Message &message, bool compress)
+{
+    // A recepção pode trocar o canal (nova troca de chaves) durante o envio
+    std::shared_ptr<SecureChannel> channel = std::atomic_load(&_channel);
+    message.send(_sockfd, _serverAddr, compress, channel.get());
+}
+
+size_t Client::ServerFilter::filter(const sockaddr_in &from, char *datagram, size_t size)
+{
+    // Um datagrama de outro endereço é descartado antes da remontagem e da cifra
+    if (from.sin_addr.s_addr != server.sin_addr.s_addr || from.sin_port != server.sin_port)
+        return 0;
+
+    if (SecureChannel::isSealed(datagram, size))
+        return channel ? channel->open(datagram, size) : 0;
+
+    if (!channel)
+        return size;
+
+    // Em claro numa sessão cifrada, só a nova troca de chaves (tratada em `rekey`)
+    if (size >= MESSAGE_HEADER_SIZE && (WireHeader::at(datagram)->flags & Message::ACCEPTS_ENCRYPTION))
+    {
+        int type = WireHeader::load(WireHeader::at(datagram)->type);
+        if (type == Message::ERRO || type == Message::OI)
+            return size;
+    }
+
+    return 0;
+}
+
+void Client::setPresence(Message::PresenceState state)
+{
+    auto now = std::chrono::steady_clock::now();
+
+    if (state == _presence && (state != Message::PRESENCE_TYPING ||
+                               now - _presenceSent < std::chrono::milliseconds(CLIENT_TYPING_REFRESH_MS)))
+        return;
+
+    Message message(Message::PRESENCE, _id, 0, _username, "");
+    message.setSequence(state);
+    transmit(message);
+
+    _presence = state;
+    _presenceSent = now;
+}
+
+std::vector<Client::PresenceUpdate> Client::applyPresence(const Message &message)
+{
+    std::vector<PresenceUpdate> updates;
+    std::istringstream stream(message.getText());
+    std::string line;
+
+    // "<id>:<estado>:<usuario>" por linha
+    while (std::getline(stream, line))
+    {
+        size_t first = line.find(':');
+        size_t second = first == std::string::npos ? first : line.find(':', first + 1);
+
+        if (second == std::string::npos)
+            continue;
+
+        int id = atoi(line.c_str());
+        int state = atoi(line.c_str() + first + 1);
+
+        if (id <= 0 || state < Message::PRESENCE_OFFLINE || state > Message::PRESENCE_TYPING)
+            continue;
+
+        PresenceUpdate update = {id, static_cast<Message::PresenceState>(state), line.substr(second + 1)};
+
+        if (update.state == Message::PRESENCE_OFFLINE)
+            _clientsOnline.erase(id);
+        else if (id != _id)
+            _clientsOnline[id] = update.username;
+
+        if (update.state == Message::PRESENCE_AWAY || update.state == Message::PRESENCE_TYPING)
+            _presenceStates[id] = update.state;
+        else
+            _presenceStates.erase(id);
+
+        updates.push_back(std::move(update));
+    }
+
+    return updates;
+}
+
+Message::PresenceState Client::getPresence(int id) const
+{
+    const auto found = _presenceStates.find(id);
+
+    if (found != _presenceStates.end())
+        return found->second;
+
+    return _clientsOnline.count(id) ? Message::PRESENCE_ONLINE : Message::PRESENCE_OFFLINE;
+}
+
+const char* Client::presenceName(Message::PresenceState state)
+{
+    switch (state)
+    {
+    case Message::PRESENCE_ONLINE:
+        return "online";
+    case Message::PRESENCE_AWAY:
+        return "ausente";
+    case Message::PRESENCE_TYPING:
+        return "digitando";
+    default:
+        return "offline";
+    }
+}
+
+bool Client::enableTracing(const std::string &path, double fraction)
+{
+    _tracer = std::make_unique<Tracer>(path, fraction);
+    return _tracer->isOpen();
+}
+
+void Client::traceRender(const Message &message)
+{
+    if (_tracer && message.hasFlag(Message::TRACED))
+        _tracer->record(TRACE_RENDER, message.getOriginID(), message.getSequence(), _id);
+}
+
+void Client::requestHistory(uint32_t after)
+{
+    Message message(Message::HISTORY, _id, 0, _username, "");
+    message.setSequence(static_cast<int>(after));
+    transmit(message, _compression);
+}
+
+void Client::scheduleMessage(const std::string &msg, int64_t when, int destinationID)
+{
+    Message message(Message::SCHEDULE, _id, destinationID, _username, std::to_string(when) + " " + msg);
+    message.setSequence(++_sequence);
+    transmit(message, _compression);
+}
+
+void Client::cancelScheduled(uint32_t ticket)
+{
+    Message message(Message::UNSCHEDULE, _id, 0, _username, std::to_string(ticket));
+    transmit(message, _compression);
+}
+
+bool Client::joinMulticast(const std::string &announce)
+{
+    std::istringstream stream(announce);
+    std::string ip;
+    int port = 0;
+    struct ip_mreq membership;
+    memset(&membership, 0, sizeof(membership));
+
+    if (!(stream >> ip >> port) || inet_pton(AF_INET, ip.c_str(), &membership.imr_multiaddr) <= 0)
+        return false;
+
+    // A interface é a da rota até o servidor (um `connect` UDP não envia nada)
+    struct sockaddr_in local;
+    socklen_t length = sizeof(local);
+    int probe = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (probe < 0 || connect(probe, (const struct sockaddr*)&_serverAddr, sizeof(_serverAddr)) < 0 ||
+        getsockname(probe, (struct sockaddr*)&local, &length) < 0)
+    {
+        if (probe >= 0)
+            close(probe);
+        return false;
+    }
+
+    close(probe);
+    membership.imr_interface = local.sin_addr;
+
+    // Vários clientes no mesmo host dividem a porta do grupo
+    struct sockaddr_in group;
+    memset(&group, 0, sizeof(group));
+    group.sin_family = AF_INET;
+    group.sin_addr = membership.imr_multiaddr;
+    group.sin_port = htons(port);
+
+    int reuse = 1;
+    int receiveBuffer = CLIENT_RECEIVE_BUFFER;
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0 ||
+        bind(fd, (const struct sockaddr*)&group, sizeof(group)) < 0 ||
+        setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+    _multicastfd = fd;
+
+    Message join(Message::MULTICAST, _id, 0, _username, "");
+    join.setSequence(Message::MULTICAST_JOIN);
+    transmit(join);
+
+    return true;
+}
+
+int Client::waitReadable()
+{
+    struct pollfd fds[2] = {{_sockfd, POLLIN, 0}, {_multicastfd, POLLIN, 0}};
+    int ready = poll(fds, 2, _timeout > 0 ? _timeout * 1000 : -1);
+
+    if (ready == 0)
+        errno = EAGAIN;
+
+    if (ready <= 0)
+        return -1;
+
+    return fds[0].revents ? _sockfd : _multicastfd;
+}
+
+bool Client::accept(const Message &message, bool multicast)
+{
+    if (message.getType() == Message::MULTICAST)
+    {
+        // Teste pelo grupo: o multicast chega até aqui
+        if (multicast && message.getDestinationID() == _id && message.getSequence() == Message::MULTICAST_PROBE)
+        {
+            Message confirm(Message::MULTICAST, _id, 0, _username, "");
+            confirm.setSequence(Message::MULTICAST_CONFIRM);
+            transmit(confirm);
+            _multicastConfirmed = true;
+        }
+        else if (!multicast && message.getSequence() == Message::MULTICAST_ACTIVE)
+        {
+            std::clog << "Broadcasts por multicast" << std::endl;
+        }
+
+        return false;
+    }
+
+    // Antes da confirmação, o servidor ainda envia tudo por unicast
+    if (multicast && !_multicastConfirmed)
+        return false;
+
+    // Na troca, um broadcast pode chegar pelos dois caminhos; a sequência
+    //     (posição na linha do tempo) identifica as cópias
+    if (_multicastfd >= 0 && message.getType() == Message::MSG && message.getDestinationID() == 0)
+    {
+        size_t known = std::min<size_t>(_recentCount, CLIENT_RECENT_BROADCASTS);
+
+        if (std::find(_recentBroadcasts, _recentBroadcasts + known, message.getSequence()) !=
+            _recentBroadcasts + known)
+            return false;
+
+        _recentBroadcasts[_recentCount++ % CLIENT_RECENT_BROADCASTS] = message.getSequence();
+    }
+
+    return true;
 }
 
 Message* Client::receiveMessages()
 {
-    Message* msg = Message::receive(_sockfd, _serverAddr, BUFFER_SIZE);
+    Message* msg = new Message();
+    int n;
+
+    // Fragmentos de mensagens incompletas, sinais e mensagens de controle do
+    //     multicast não encerram a espera
+    while (true)
+    {
+        struct sockaddr_in sender;
+        int fd = _multicastfd >= 0 ? waitReadable() : _sockfd;
+
+        // O grupo multicast é sempre em claro; o socket do servidor passa pelo filtro
+        n = fd < 0 ? -1 : Message::receive(fd, sender, *msg, BUFFER_SIZE, &_reassembler, nullptr,
+                                           fd == _sockfd ? &_filter : nullptr);
+
+        if (n == 0 || (n < 0 && errno == EINTR))
+            continue;
+
+        if (n > 0 && fd == _sockfd && rekey(*msg))
+            continue;
+
+        // Pelo grupo, só o que o servidor publicou
+        if (n > 0 && fd == _multicastfd &&
+            (sender.sin_addr.s_addr != _serverAddr.sin_addr.s_addr || sender.sin_port != _serverAddr.sin_port))
+            continue;
 
-    if (msg)
+        if (n > 0 && _multicastfd >= 0 && !accept(*msg, fd == _multicastfd))
+            continue;
+
+        break;
+    }
+
+    if (n > 0)
     {
         return msg;
     }
     else
     {
+        delete msg;
         return nullptr;
     }
 }
 
+bool Client::rekey(const Message &message)
+{
+    // Sem canal, o OI e os erros são os da conexão (`connectToServer`)
+    if (!_filter.channel || !message.hasFlag(Message::ACCEPTS_ENCRYPTION) ||
+        (message.getType() != Message::ERRO && message.getType() != Message::OI))
+        return false;
+
+    if (message.getDestinationID() != _id)
+        return true;
+
+    auto now = std::chrono::steady_clock::now();
+
+    const unsigned char *resume = _filter.channel->resumeKey();
+    uint32_t session = static_cast<uint32_t>(_id);
+
+    if (message.getType() == Message::ERRO)
+    {
+        // "<desafio> <prova do pedido>"
+        std::string_view text = message.getTextView();
+        size_t space = text.find(' ');
+        uint64_t challenge = 0;
+
+        if (space == std::string_view::npos ||
+            std::from_chars(text.data(), text.data() + space, challenge).ptr != text.data() + space ||
+            !SecureChannel::matches(SecureChannel::prove(resume, "pedido", session, challenge),
+                                    text.substr(space + 1)))
+            return true;
+
+        if (_rekeying && challenge == _rekeyChallenge &&
+            now - _rekeySent < std::chrono::milliseconds(CLIENT_REKEY_INTERVAL_MS))
+            return true;
+
+        if (!SecureChannel::generate(_rekeyKeys))
+            return true;
+
+        Message hello(Message::OI, _id, 0, _username,
+                      SecureChannel::toHex(_rekeyKeys.publicKey) +
+                      SecureChannel::prove(resume, "troca", session, challenge, _rekeyKeys.publicKey));
+        hello.setFlag(Message::ACCEPTS_COMPRESSION);
+        hello.setFlag(Message::ACCEPTS_ENCRYPTION);
+        hello.send(_sockfd, _serverAddr);
+
+        _rekeying = true;
+        _rekeyChallenge = challenge;
+        _rekeySent = now;
+        std::clog << "Servidor pediu nova troca de chaves" << std::endl;
+        return true;
+    }
+
+    // A resposta prova a chave do servidor junto com a nossa
+    unsigned char serverKey[SEAL_KEY_SIZE];
+    std::shared_ptr<SecureChannel> channel;
+
+    if (!_rekeying || !SecureChannel::fromHex(message.getTextView(), serverKey) ||
+        !SecureChannel::matches(SecureChannel::prove(resume, "resposta", session, _rekeyChallenge,
+                                                     _rekeyKeys.publicKey, serverKey),
+                                message.getTextView().substr(2 * SEAL_KEY_SIZE)) ||
+        !(channel = SecureChannel::establish(_rekeyKeys, serverKey, true, session)))
+        return true;
+
+    // O segredo de retomada é o da primeira troca
+    channel->adoptResume(resume);
+    std::atomic_store(&_channel, channel);
+    _filter.channel = channel.get();
+    _rekeying = false;
+    OPENSSL_cleanse(_rekeyKeys.privateKey, sizeof(_rekeyKeys.privateKey));
+
+    std::clog << "Sessão cifrada renovada" << std::endl;
+    return true;
+}
+
 void Client::setTimeout(int timeout)
 {
+    _timeout = timeout;
+
     struct timeval tv;
     tv.tv_sec = timeout;
     tv.tv_usec = 0;
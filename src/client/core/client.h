@@ -2,10 +2,18 @@
 #define CLIENT_H
 
 #include "../include/message.h"
+#include "../include/trace.h"
+#include <chrono>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
-#define BUFFER_SIZE 1024
+#define BUFFER_SIZE 2048
 #define TIMEOUT_TIME 10
+#define CLIENT_RECEIVE_BUFFER (1 << 20)    /** Buffer de recepção do socket (rajadas de broadcasts e de `HISTORY`) */
+#define CLIENT_RECENT_BROADCASTS 64         /** Broadcasts lembrados para descartar cópias (troca para multicast) */
+#define CLIENT_TYPING_REFRESH_MS 3000       /** Renovação do "digitando" enquanto o usuário digita */
+#define CLIENT_REKEY_INTERVAL_MS 1000       /** Intervalo mínimo entre novas trocas de chaves pedidas pelo servidor */
 
 /**
  * @brief Implementação UDP do cliente.
@@ -14,6 +22,15 @@
 class Client
 {
 public:
+    /**
+     * @brief Mudança de presença recebida do servidor
+     */
+    struct PresenceUpdate {
+        int id;                         /** ID do cliente */
+        Message::PresenceState state;   /** Novo estado */
+        std::string username;           /** Nome do cliente */
+    };
+
     /// Contrutor Padrão
     Client() {};
 
@@ -39,16 +56,19 @@ public:
      *     determinado tempo. O servidor retorna um identificador único para
      *     cliente.
      * 
+     * @param timeout Espera máxima pela resposta, em segundos.
+     * 
      * @retval 0 - Erro
      * @retval 1 - Sucesso
      */
-    int connectToServer();
+    int connectToServer(int = TIMEOUT_TIME);
 
     /**
      * @brief Envia uma mensagem para o destino
      * 
      * Faz o envio de `Message MSG` ao servidor, escolhendo o destino para onde
-     *     será enviado.
+     *     será enviado. Também envia os pedidos sem resposta imediata (`LIST`,
+     *     `TCHAU`, grupos); `MSG` e `GROUP_MSG` recebem um número de sequência.
      * 
      * @param message Conteúdo da mensagem a ser enviada
      * @param messagetType Tipo da mensagem (Padrão MSG)
@@ -57,6 +77,91 @@ public:
      */
     void sendMessage(const std::string&, Message::MessageType = Message::MSG, int = 0);
 
+    /**
+     * @brief Pede ao servidor os tweets após uma posição da linha do tempo
+     * 
+     * A resposta chega como `Message HISTORY`, com os tweets codificados em
+     *     sequência no texto.
+     * 
+     * @param after Última posição conhecida (0 = nenhuma)
+     */
+    void requestHistory(uint32_t);
+
+    /**
+     * @brief Agenda um tweet para publicação futura
+     * 
+     * O servidor confirma com `Message SCHEDULE` ("<ticket> <ms>", com a
+     *     sequência do pedido) ou responde com `Message ERRO`.
+     * 
+     * @param message Conteúdo do tweet
+     * @param when Horário de publicação, em ms desde 1970
+     * @param destinationID ID do destino (Padrão 0 = todos)
+     */
+    void scheduleMessage(const std::string&, int64_t, int = 0);
+
+    /**
+     * @brief Cancela um tweet agendado
+     * 
+     * O servidor confirma com `Message UNSCHEDULE` ("<ticket>").
+     * 
+     * @param ticket Ticket recebido na confirmação do agendamento
+     */
+    void cancelScheduled(uint32_t);
+
+    /**
+     * @brief Informa ao servidor o estado de presença do usuário
+     * 
+     * Só as mudanças são enviadas: repetir o estado atual não gera tráfego,
+     *     exceto o "digitando", renovado a cada `CLIENT_TYPING_REFRESH_MS`
+     *     para não expirar no servidor.
+     * 
+     * @param state Novo estado (conectado, ausente ou digitando)
+     */
+    void setPresence(Message::PresenceState);
+
+    /**
+     * @brief Aplica um lote de presença recebido à lista de clientes online
+     * 
+     * Os conectados entram na lista e os desconectados saem dela.
+     * 
+     * @param message `Message PRESENCE` do servidor
+     * 
+     * @return std::vector<PresenceUpdate> Mudanças do lote, na ordem recebida
+     */
+    std::vector<PresenceUpdate> applyPresence(const Message&);
+
+    /**
+     * @brief Estado de presença conhecido de um cliente
+     * 
+     * @param id ID do cliente
+     */
+    Message::PresenceState getPresence(int) const;
+
+    /**
+     * @brief Nome de um estado de presença, para exibição
+     */
+    static const char* presenceName(Message::PresenceState);
+
+    /**
+     * @brief Ativa o trace de latência
+     * 
+     * Uma fração das mensagens enviadas é marcada com `TRACED`; o envio e a
+     *     exibição das mensagens marcadas são registrados no arquivo.
+     * 
+     * @param path Arquivo de trace
+     * @param fraction Fração das mensagens enviadas que são amostradas
+     * 
+     * @retval `true` Se o arquivo foi aberto
+     */
+    bool enableTracing(const std::string&, double);
+
+    /**
+     * @brief Registra a exibição de uma mensagem recebida, se amostrada
+     * 
+     * @param message Mensagem exibida
+     */
+    void traceRender(const Message&);
+
     /**
      * @brief Recebe mensagens do servidor
      * 
@@ -70,26 +175,150 @@ public:
    
     int getId() const { return _id; }
     std::string getUsername() const { return _username; }
+    const sockaddr_in& getServerAddress() const { return _serverAddr; }
     std::unordered_map<int, std::string> getClientsOnline() const { return _clientsOnline; }
     bool getRunning() const { return _running; }
 
     void setClientsOnline(std::unordered_map<int, std::string> clients) { this->_clientsOnline = std::move(clients); }
 
+    /**
+     * @brief Define se o cliente aceita receber os broadcasts por multicast
+     * 
+     * Deve ser chamado antes de `connectToServer` (padrão: aceita). Se o
+     *     servidor anunciar um grupo no OI, o cliente entra nele e, após o
+     *     servidor confirmar que o multicast chega, os broadcasts passam a vir
+     *     pelo grupo. Se a adesão falhar, continuam por unicast.
+     * 
+     * @param enabled Aceita multicast
+     */
+    void setMulticast(bool enabled) { _multicastWanted = enabled; }
+
+    /**
+     * @brief Define se o cliente cifra a sessão
+     * 
+     * Deve ser chamado antes de `connectToServer` (padrão: cifra). O OI leva
+     *     uma chave pública efêmera e, se o servidor responder com a dele,
+     *     todos os datagramas da sessão passam a ser cifrados e autenticados
+     *     (`SecureChannel`). Sessões cifradas não usam multicast. Se o
+     *     servidor reiniciar ou for substituído pelo standby, ele pede uma
+     *     nova troca de chaves e o cliente a refaz sozinho, mantendo o ID.
+     * 
+     * @param enabled Cifra a sessão
+     */
+    void setEncryption(bool enabled) { _encryptionWanted = enabled; }
+
+    /**
+     * @brief Verifica se a sessão com o servidor é cifrada
+     */
+    bool isEncrypted() const { return std::atomic_load(&_channel) != nullptr; }
+
+    /**
+     * @brief Define o tempo de timeout para o socket
+     * 
+     * Com timeout, `receiveMessages` retorna `nullptr` quando nada chega no
+     *     intervalo, permitindo encerrar a thread de recepção.
+     * 
+     * @param timeout Tempo de timeout em segundos (Padrão 0 = sem timeout)
+     */
+    void setTimeout(int = 0);
+
 private:
+    /**
+     * @brief Filtro dos datagramas do servidor
+     * 
+     * Só aceita datagramas vindos do endereço do servidor. Com o canal
+     *     estabelecido, só os cifrados são aceitos (e abertos), além do pedido
+     *     e da resposta de uma nova troca de chaves (`ERRO` e `OI` com
+     *     `ACCEPTS_ENCRYPTION`); antes dele, só os em claro.
+     */
+    struct ServerFilter : DatagramFilter {
+        sockaddr_in server = {};          /** Endereço configurado do servidor */
+        SecureChannel *channel = nullptr; /** Canal da sessão (nulo = em claro) */
+
+        size_t filter(const sockaddr_in&, char*, size_t) override;
+    };
+
     int _id; /** Identificador do cliente */
     std::string _username; /** Nome de usuário */    
+    int _sequence; /** Último número de sequência usado em `Message MSG` */
     std::unordered_map<int, std::string> _clientsOnline; /** Lista de clientes online */
 
     int _sockfd;  /** Descritor de socket UDP */
     struct sockaddr_in _serverAddr; /** Endereço do servidor */
     bool _running; /** Estado de execução do cliente */
+    bool _compression; /** Servidor aceita mensagens comprimidas (negociado no OI) */
+    Reassembler _reassembler; /** Remontagem de mensagens fragmentadas */
+    std::unique_ptr<Tracer> _tracer; /** Trace de latência (nulo se desativado) */
+    int _timeout; /** Timeout da recepção em segundos (0 = sem timeout) */
+    bool _multicastWanted; /** Aceita multicast (anunciado no OI) */
+    int _multicastfd; /** Socket do grupo multicast (-1 se não aderiu) */
+    bool _multicastConfirmed; /** Respondeu ao teste do servidor: broadcasts podem vir pelo grupo */
+    int _recentBroadcasts[CLIENT_RECENT_BROADCASTS]; /** Sequências dos últimos broadcasts recebidos */
+    size_t _recentCount; /** Broadcasts registrados em `_recentBroadcasts` */
+    bool _encryptionWanted; /** Oferece a chave pública no OI */
+    std::shared_ptr<SecureChannel> _channel; /** Canal cifrado com o servidor (nulo = em claro); trocado com `std::atomic_store` */
+    SecureChannel::KeyPair _rekeyKeys; /** Par efêmero da nova troca de chaves em andamento */
+    bool _rekeying; /** Enviou um OI de nova troca e espera a resposta */
+    uint64_t _rekeyChallenge; /** Desafio do pedido que a nova troca responde */
+    std::chrono::steady_clock::time_point _rekeySent; /** Envio do último OI de nova troca */
+    ServerFilter _filter; /** Filtro dos datagramas do servidor */
+    Message::PresenceState _presence; /** Último estado de presença enviado */
+    std::chrono::steady_clock::time_point _presenceSent; /** Envio do último estado */
+    std::unordered_map<int, Message::PresenceState> _presenceStates; /** Clientes ausentes ou digitando */
 
     /**
-     * @brief Define o tempo de timeout para o socket
+     * @brief Envia uma mensagem ao servidor, pelo canal cifrado se houver
      * 
-     * @param timeout Tempo de timeout (Padrão 0)
+     * @param message Mensagem a ser enviada
+     * @param compress Comprime se o servidor aceitar (Padrão false)
      */
-    void setTimeout(int = 0);
+    void transmit(const Message&, bool = false);
+
+    /**
+     * @brief Entra no grupo multicast anunciado no OI e pede a adesão
+     * 
+     * @param announce Texto do OI ("<IP> <porta>")
+     * 
+     * @retval `true` Se entrou no grupo
+     */
+    bool joinMulticast(const std::string&);
+
+    /**
+     * @brief Espera um dos sockets ficar legível, respeitando o timeout
+     * 
+     * @return int Socket legível, ou -1 (timeout ou sinal, veja `errno`)
+     */
+    int waitReadable();
+
+    /**
+     * @brief Decide se uma mensagem recebida é entregue a quem chamou
+     * 
+     * Trata as etapas da adesão ao multicast e descarta as cópias de um
+     *     broadcast que chegou pelos dois caminhos durante a troca.
+     * 
+     * @param message Mensagem recebida
+     * @param multicast Chegou pelo grupo
+     * 
+     * @retval `true` Se a mensagem deve ser entregue
+     */
+    bool accept(const Message&, bool);
+
+    /**
+     * @brief Trata o pedido e a resposta de uma nova troca de chaves
+     * 
+     * Um servidor que perdeu a chave da sessão (reinício ou failover) pede a
+     *     troca com um `ERRO` em claro; o cliente responde com um OI com chave
+     *     nova e, na resposta, passa a usar o novo canal. Pedido, OI e resposta
+     *     levam uma prova com o segredo de retomada da sessão sobre o desafio
+     *     do servidor e as chaves novas: um pedido ou uma resposta forjados
+     *     são ignorados, e o canal antigo continua valendo até a resposta
+     *     provada.
+     * 
+     * @param message Mensagem recebida do socket do servidor
+     * 
+     * @retval `true` Se a mensagem faz parte da troca (não é entregue)
+     */
+    bool rekey(const Message&);
 
     /**
      * @brief Imrpime mensagem de erro no console
@@ -0,0 +1,221 @@
+#include "timeline_cache.h"
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char CACHE_MAGIC[4] = {'M', 'T', 'W', 'T'};
+static const size_t CACHE_HEADER_SIZE = 8;  // magic + versão
+static const size_t RECORD_HEADER_SIZE = 5; // tipo + tamanho
+
+TimelineCache::TimelineCache(const std::string &path)
+    : _path(path), _fd(-1), _size(0), _incarnation(0), _lastSequence(0)
+{
+}
+
+TimelineCache::~TimelineCache()
+{
+    if (_fd >= 0)
+        close(_fd);
+}
+
+std::string TimelineCache::defaultPath(const std::string &username, const sockaddr_in &server)
+{
+    const char *home = getenv("HOME");
+    std::string directory = home ? std::string(home) + "/" : "";
+
+    return directory + ".mini_twitter_" + username + "_" + inet_ntoa(server.sin_addr) + "_" +
+           std::to_string(ntohs(server.sin_port)) + ".cache";
+}
+
+bool TimelineCache::load()
+{
+    bool found = false;
+    int fd = open(_path.c_str(), O_RDONLY);
+
+    if (fd >= 0)
+    {
+        struct stat info;
+
+        if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= CACHE_HEADER_SIZE)
+        {
+            size_t size = info.st_size;
+            void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (map != MAP_FAILED)
+            {
+                const char *data = static_cast<const char*>(map);
+                uint32_t version;
+                memcpy(&version, data + 4, sizeof(version));
+
+                if (memcmp(data, CACHE_MAGIC, 4) == 0 && version == TIMELINE_CACHE_VERSION)
+                {
+                    size_t offset = CACHE_HEADER_SIZE;
+
+                    // Um registro incompleto no fim (escrita interrompida) é descartado
+                    while (offset + RECORD_HEADER_SIZE <= size)
+                    {
+                        uint32_t length;
+                        memcpy(&length, data + offset + 1, sizeof(length));
+
+                        if (length > size - offset - RECORD_HEADER_SIZE)
+                            break;
+
+                        apply(static_cast<uint8_t>(data[offset]), data + offset + RECORD_HEADER_SIZE, length);
+                        offset += RECORD_HEADER_SIZE + length;
+                    }
+
+                    found = offset > CACHE_HEADER_SIZE;
+                }
+
+                munmap(map, size);
+            }
+        }
+
+        close(fd);
+    }
+
+    // Reescreve sempre: descarta registros inválidos e começa um arquivo compacto
+    compact();
+    return found;
+}
+
+void TimelineCache::apply(uint8_t kind, const char *data, size_t size)
+{
+    if (kind == TWEET)
+    {
+        Message tweet;
+        if (!Message::decode(data, size, tweet))
+            return;
+
+        if (tweet.getDestinationID() == 0 && static_cast<uint32_t>(tweet.getSequence()) > _lastSequence)
+            _lastSequence = static_cast<uint32_t>(tweet.getSequence());
+
+        _tweets.push_back(std::move(tweet));
+
+        if (_tweets.size() > TIMELINE_CACHE_KEEP)
+            _tweets.pop_front();
+    }
+    else if (kind == ROSTER)
+    {
+        _roster.assign(data, size);
+    }
+    else if (kind == INCARNATION && size == sizeof(int32_t))
+    {
+        int32_t incarnation;
+        memcpy(&incarnation, data, sizeof(incarnation));
+
+        if (incarnation != _incarnation)
+            _lastSequence = 0;
+
+        _incarnation = incarnation;
+    }
+}
+
+void TimelineCache::append(const Message &tweet)
+{
+    char buffer[MAX_DATAGRAM_SIZE];
+    std::string bulk;
+    char *encoded = buffer;
+
+    if (tweet.encodedSize() > sizeof(buffer))
+    {
+        bulk.resize(tweet.encodedSize());
+        encoded = &bulk[0];
+    }
+
+    size_t size = tweet.encode(encoded);
+    apply(TWEET, encoded, size);
+    write(TWEET, encoded, size);
+}
+
+void TimelineCache::saveRoster(const std::string &roster)
+{
+    if (roster == _roster)
+        return;
+
+    apply(ROSTER, roster.data(), roster.size());
+    write(ROSTER, roster.data(), roster.size());
+}
+
+void TimelineCache::setIncarnation(int incarnation)
+{
+    if (incarnation == _incarnation)
+        return;
+
+    int32_t value = incarnation;
+    apply(INCARNATION, reinterpret_cast<const char*>(&value), sizeof(value));
+    write(INCARNATION, reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void TimelineCache::write(uint8_t kind, const char *data, size_t size)
+{
+    if (_size + RECORD_HEADER_SIZE + size > TIMELINE_CACHE_MAX_SIZE)
+    {
+        // O estado em memória já inclui este registro
+        compact();
+        return;
+    }
+
+    if (_fd < 0)
+        return;
+
+    char header[RECORD_HEADER_SIZE];
+    uint32_t length = static_cast<uint32_t>(size);
+    header[0] = static_cast<char>(kind);
+    memcpy(header + 1, &length, sizeof(length));
+
+    if (::write(_fd, header, sizeof(header)) == sizeof(header) &&
+        ::write(_fd, data, size) == static_cast<ssize_t>(size))
+        _size += sizeof(header) + size;
+}
+
+void TimelineCache::compact()
+{
+    std::string contents(CACHE_HEADER_SIZE, '\0');
+    uint32_t version = TIMELINE_CACHE_VERSION;
+    memcpy(&contents[0], CACHE_MAGIC, 4);
+    memcpy(&contents[4], &version, sizeof(version));
+
+    auto record = [&contents](uint8_t kind, const char *data, size_t size) {
+        uint32_t length = static_cast<uint32_t>(size);
+        contents.push_back(static_cast<char>(kind));
+        contents.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        contents.append(data, size);
+    };
+
+    int32_t incarnation = _incarnation;
+    record(INCARNATION, reinterpret_cast<const char*>(&incarnation), sizeof(incarnation));
+
+    if (!_roster.empty())
+        record(ROSTER, _roster.data(), _roster.size());
+
+    for (const auto &tweet : _tweets)
+    {
+        std::string encoded(tweet.encodedSize(), '\0');
+        tweet.encode(&encoded[0]);
+        record(TWEET, encoded.data(), encoded.size());
+    }
+
+    // Escreve em um temporário e renomeia, para nunca deixar o cache pela metade
+    std::string temporary = _path + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+    if (fd < 0 || ::write(fd, contents.data(), contents.size()) != static_cast<ssize_t>(contents.size()) ||
+        rename(temporary.c_str(), _path.c_str()) < 0)
+    {
+        if (fd >= 0)
+            close(fd);
+
+        return;
+    }
+
+    close(fd);
+
+    if (_fd >= 0)
+        close(_fd);
+
+    _fd = open(_path.c_str(), O_WRONLY | O_APPEND);
+    _size = contents.size();
+}
@@ -0,0 +1,108 @@
+#ifndef TIMELINE_CACHE_H
+#define TIMELINE_CACHE_H
+
+#include "../include/message.h"
+#include <deque>
+#include <string>
+
+#define TIMELINE_CACHE_VERSION 1            /** Versão do formato do arquivo */
+#define TIMELINE_CACHE_MAX_SIZE (1 << 20)   /** Tamanho do arquivo que dispara a compactação */
+#define TIMELINE_CACHE_KEEP 200             /** Tweets mantidos em memória e na compactação */
+
+/**
+ * @brief Cache local da linha do tempo e da lista de clientes.
+ *
+ * O arquivo é um cabeçalho seguido de registros acrescentados ao fim
+ *     (tipo, tamanho e conteúdo): tweets no formato do fio de `Message`, a
+ *     lista de clientes no formato de `LIST` e a execução do servidor de onde
+ *     vem a numeração da linha do tempo. Na abertura, o arquivo é lido com
+ *     `mmap` e os últimos tweets podem ser exibidos antes de qualquer resposta
+ *     do servidor; depois, só os tweets após `getLastSequence()` são pedidos.
+ *
+ * Quando o arquivo passa de `TIMELINE_CACHE_MAX_SIZE`, ele é reescrito só com
+ *     o estado atual. Não é thread-safe.
+ */
+class TimelineCache
+{
+public:
+    /**
+     * @brief Construtor da classe TimelineCache.
+     *
+     * @param path Caminho do arquivo
+     */
+    TimelineCache(const std::string&);
+
+    /// Destrutor
+    ~TimelineCache();
+
+    /**
+     * @brief Caminho padrão do cache de um usuário em um servidor.
+     */
+    static std::string defaultPath(const std::string&, const sockaddr_in&);
+
+    /**
+     * @brief Lê o arquivo e o prepara para novos registros.
+     *
+     * @retval `true` Se havia conteúdo salvo
+     * @retval `false` Se o arquivo não existia ou era inválido
+     */
+    bool load();
+
+    /**
+     * @brief Registra um tweet recebido.
+     */
+    void append(const Message&);
+
+    /**
+     * @brief Registra a lista de clientes (texto de uma resposta `LIST`).
+     */
+    void saveRoster(const std::string&);
+
+    /**
+     * @brief Registra a execução do servidor; se mudou, a numeração recomeça.
+     */
+    void setIncarnation(int);
+
+    /*
+    * Getters
+    */
+
+    const std::deque<Message>& getTweets() const { return _tweets; }
+    const std::string& getRoster() const { return _roster; }
+    int getIncarnation() const { return _incarnation; }
+    uint32_t getLastSequence() const { return _lastSequence; }
+
+private:
+    /// Tipos de registro
+    enum RecordKind : uint8_t
+    {
+        TWEET = 'T',        /** Mensagem codificada */
+        ROSTER = 'R',       /** Lista de clientes */
+        INCARNATION = 'I'   /** Execução do servidor (inteiro de 4 bytes) */
+    };
+
+    std::string _path;              /** Caminho do arquivo */
+    int _fd;                        /** Descritor para os novos registros */
+    size_t _size;                   /** Tamanho atual do arquivo */
+    std::deque<Message> _tweets;    /** Últimos tweets, do mais antigo ao mais novo */
+    std::string _roster;            /** Última lista de clientes */
+    int _incarnation;               /** Execução do servidor */
+    uint32_t _lastSequence;         /** Maior posição da linha do tempo recebida */
+
+    /**
+     * @brief Aplica um registro ao estado em memória.
+     */
+    void apply(uint8_t, const char*, size_t);
+
+    /**
+     * @brief Acrescenta um registro ao arquivo.
+     */
+    void write(uint8_t, const char*, size_t);
+
+    /**
+     * @brief Reescreve o arquivo só com o estado atual.
+     */
+    void compact();
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include "login_window.h"
 #include "main_window.h"
 #include "../core/client.h"
+#include <cstdlib>
 
 
 LoginWindow::LoginWindow() 
@@ -97,6 +98,14 @@ void LoginWindow::on_button_login_clicked()
     int port = std::stoi(_EntryPort.get_text());
 
     std::unique_ptr<Client> client = std::make_unique<Client>(username, ip, port);
+
+    // Trace de latência opcional: MINI_TWITTER_TRACE=<arquivo> e
+    //     MINI_TWITTER_TRACE_SAMPLE=<fração> (padrão 0.01)
+    if (const char *trace = getenv("MINI_TWITTER_TRACE"))
+    {
+        const char *sample = getenv("MINI_TWITTER_TRACE_SAMPLE");
+        client->enableTracing(trace, sample ? atof(sample) : 0.01);
+    }
     
     if (!client->connectToServer())
     {
@@ -21,15 +21,33 @@ void MainWindow::setClient(std::unique_ptr<Client> client)
 {
     _client = std::move(client);
     _labelUsername->set_label(_client->getUsername() + "#" + std::to_string(_client->getId()));
+
+    // Mostra a linha do tempo salva antes de qualquer resposta do servidor e
+    //     pede apenas o que chegou depois dela
+    _cache = std::make_unique<TimelineCache>(
+        TimelineCache::defaultPath(_client->getUsername(), _client->getServerAddress()));
+
+    if (_cache->load())
+    {
+        for (const auto &tweet : _cache->getTweets())
+            showMessage(&tweet);
+
+        if (!_cache->getRoster().empty())
+            applyClientList(_cache->getRoster());
+    }
+
+    _client->requestHistory(_cache->getLastSequence());
     
     _listenThread = std::thread([this]() { 
         on_message_received(); 
     });
 
+    // As entradas, saídas e mudanças de estado chegam em lotes `PRESENCE`; a
+    //     lista completa só é relida de vez em quando (perdas e outros nós)
     _clientsThread = std::thread([this]() {
         while (_client->getRunning()) {
             _client->sendMessage("", Message::LIST);
-            std::this_thread::sleep_for(std::chrono::seconds(30));
+            std::this_thread::sleep_for(std::chrono::seconds(LIST_REFRESH_SECONDS));
         }
     });
 }
@@ -56,6 +74,20 @@ void MainWindow::initialize_widgets()
     _imgLogo->set("assets/twitter_small.png");
 
     signal_hide().connect(sigc::mem_fun(*this, &MainWindow::on_window_hide));
+    _textTweet->get_buffer()->signal_changed().connect(sigc::mem_fun(*this, &MainWindow::on_text_changed));
+
+    // Fora da janela, o usuário aparece como ausente
+    signal_focus_in_event().connect([this](GdkEventFocus*) {
+        if (_client)
+            _client->setPresence(_textTweet->get_buffer()->size() > 0 ? Message::PRESENCE_TYPING
+                                                                      : Message::PRESENCE_ONLINE);
+        return false;
+    });
+    signal_focus_out_event().connect([this](GdkEventFocus*) {
+        if (_client)
+            _client->setPresence(Message::PRESENCE_AWAY);
+        return false;
+    });
     
 
     if (!_boxApp || !_listboxMain || !_viewportMain || !_boxMain || !_mainGrid || 
@@ -71,6 +103,24 @@ void MainWindow::on_btnTweet_clicked()
     Glib::RefPtr<Gtk::TextBuffer> buffer = _textTweet->get_buffer();
     std::string tweetText = buffer->get_text();
 
+    // "/buscar <termos>" busca nos tweets recentes; "/mais" traz a próxima página
+    if (tweetText.rfind("/buscar ", 0) == 0 || tweetText == "/mais")
+    {
+        if (tweetText != "/mais")
+        {
+            _searchQuery = tweetText.substr(8);
+            _searchPage = 0;
+        }
+        else
+        {
+            _searchPage++;
+        }
+
+        _client->sendMessage(_searchQuery, Message::SEARCH, _searchPage);
+        buffer->set_text("");
+        return;
+    }
+
     if (tweetText.length() > 140)
     {
         handleError("O tweet não pode ter mais de 140 caracteres.");
@@ -109,6 +159,14 @@ void MainWindow::on_btnTweet_clicked()
     } 
 }
 
+void MainWindow::on_text_changed()
+{
+    // O cliente só envia as mudanças (e renova o "digitando" de tempos em tempos)
+    if (_client)
+        _client->setPresence(_textTweet->get_buffer()->size() > 0 ? Message::PRESENCE_TYPING
+                                                                  : Message::PRESENCE_ONLINE);
+}
+
 void MainWindow::on_message_received()
 {
     while (_client->getRunning())
@@ -126,6 +184,15 @@ void MainWindow::on_message_received()
             if (msg->getType() == Message::LIST)
                 handleClientList(msg);
 
+            if (msg->getType() == Message::PRESENCE)
+                handlePresence(msg);
+
+            if (msg->getType() == Message::HISTORY)
+                handleHistory(msg);
+
+            if (msg->getType() == Message::SEARCH)
+                addTweet("Busca: " + _searchQuery, msg->getText());
+
             delete msg;
         }
         else
@@ -143,13 +210,31 @@ void MainWindow::on_window_hide()
 
 void MainWindow::handleMessage(Message* message)
 {
-    if (message->getText().rfind("STATUS: ", 0) == 0)
+    std::string_view text = message->getTextView();
+
+    if (text.rfind("STATUS: ", 0) == 0)
     {
         if (message->getDestinationID() == _client->getId())
-            std::cout << message->getText() << std::endl;
+            std::cout << text << std::endl;
         return;
     }
 
+    if (message->getDestinationID() == 0)
+        _liveSequences.insert(message->getSequence());
+
+    _cache->append(*message);
+    showMessage(message);
+
+    // O widget é criado no laço do GTK: a exibição é registrada logo depois dele
+    if (message->hasFlag(Message::TRACED))
+    {
+        Message rendered(*message);
+        Glib::signal_idle().connect_once([this, rendered]() { _client->traceRender(rendered); });
+    }
+}
+
+void MainWindow::showMessage(const Message* message)
+{
     if (message->getDestinationID() == 0)
     {
         if (message->getOriginID() == _client->getId())
@@ -176,10 +261,61 @@ void MainWindow::handleError(std::string message)
     dialog.close();
 }
 
+void MainWindow::handleHistory(Message* message)
+{
+    // Outra execução do servidor numera a linha do tempo do zero
+    if (message->getOriginID() != _cache->getIncarnation())
+    {
+        bool renumbered = _cache->getLastSequence() != 0;
+        _cache->setIncarnation(message->getOriginID());
+
+        if (renumbered)
+        {
+            _client->requestHistory(0);
+            return;
+        }
+    }
+
+    std::string_view batch = message->getTextView();
+    size_t offset = 0;
+
+    while (offset < batch.size())
+    {
+        size_t size = Message::frameSize(batch.data() + offset, batch.size() - offset);
+        Message tweet;
+
+        if (size == 0 || !Message::decode(batch.data() + offset, size, tweet))
+            break;
+
+        offset += size;
+
+        // Tweets que chegaram ao vivo enquanto o pedido estava pendente
+        if (_liveSequences.count(tweet.getSequence()) == 0)
+            handleMessage(&tweet);
+    }
+
+    _liveSequences.clear();
+}
+
 void MainWindow::handleClientList(Message *message)
 {
     std::string data = message->getText();
 
+    _cache->saveRoster(data);
+    applyClientList(data);
+}
+
+void MainWindow::handlePresence(Message *message)
+{
+    if (_client->applyPresence(*message).empty())
+        return;
+
+    updateComboBox(_client->getClientsOnline());
+    addClient();
+}
+
+void MainWindow::applyClientList(const std::string &data)
+{
     std::unordered_map<int, std::string> newClients;
 
     std::istringstream stream(data);
@@ -215,15 +351,26 @@ void MainWindow::addTweet(std::string username, std::string tweetText)
 
 void MainWindow::addClient()
 {
-    Glib::signal_idle().connect_once([this]() {
+    // Os rótulos são montados aqui, na thread que recebeu a lista ou o lote
+    std::vector<std::string> labels;
+
+    for (const auto &client : _client->getClientsOnline())
+    {
+        Message::PresenceState state = _client->getPresence(client.first);
+        labels.push_back(client.second + "#" + std::to_string(client.first) +
+                         (state != Message::PRESENCE_ONLINE ? std::string(" (") + Client::presenceName(state) + ")"
+                                                            : ""));
+    }
+
+    Glib::signal_idle().connect_once([this, labels]() {
         std::lock_guard<std::mutex> lock(_textMutex);
         
         for (auto child : _listboxMain->get_children())
             _listboxMain->remove(*child);
 
-        for (const auto &client : _client->getClientsOnline())
+        for (const auto &label : labels)
         {
-            Gtk::Label* pLabel = Gtk::make_managed<Gtk::Label>(client.second + "#" + std::to_string(client.first));
+            Gtk::Label* pLabel = Gtk::make_managed<Gtk::Label>(label);
             _listboxMain->prepend(*pLabel);
         }
 
@@ -2,9 +2,13 @@
 #define MAIN_WINDOW_H
 
 #include "../core/client.h"
+#include "../core/timeline_cache.h"
 #include <gtkmm.h>
 #include <thread>
 #include <mutex>
+#include <unordered_set>
+
+#define LIST_REFRESH_SECONDS 300    /** Releitura da lista completa (a presença chega pelos lotes do servidor) */
 
 class ClientColumns : public Gtk::TreeModel::ColumnRecord {
 public:
@@ -26,6 +30,10 @@ private:
     std::thread _listenThread;
     std::thread _clientsThread;
     std::mutex _textMutex;
+    std::string _searchQuery;
+    int _searchPage = 0;
+    std::unique_ptr<TimelineCache> _cache;
+    std::unordered_set<int> _liveSequences;
 
     ClientColumns columns;
 
@@ -52,8 +60,13 @@ private:
     void on_window_hide();
 
     void handleMessage(Message*);
+    void showMessage(const Message*);
+    void handleHistory(Message*);
     void handleError(std::string);
     void handleClientList(Message*);
+    void handlePresence(Message*);
+    void on_text_changed();
+    void applyClientList(const std::string&);
 
     void addTweet(std::string, std::string);
     void addClient();
@@ -0,0 +1,398 @@
+#include "cluster.h"
+#include <sstream>
+#include <ctime>
+
+Cluster::Cluster(int sockfd, int nodeID, const std::vector<sockaddr_in> &seeds)
+    : _sockfd(sockfd), _nodeID(nodeID), _running(false), _localClients(0), _seeds(seeds), _configured(seeds)
+{
+    _incarnation = static_cast<int>(std::time(nullptr));
+}
+
+Cluster::~Cluster()
+{
+    _running = false;
+
+    if (_thread.joinable())
+        _thread.join();
+}
+
+void Cluster::start(DeliverCallback deliver, PeerUpCallback peerUp)
+{
+    _deliver = std::move(deliver);
+    _peerUp = std::move(peerUp);
+    _running = true;
+
+    _thread = std::thread(&Cluster::run, this);
+}
+
+void Cluster::run()
+{
+    auto lastGossip = std::chrono::steady_clock::time_point();
+
+    while (_running)
+    {
+        auto now = std::chrono::steady_clock::now();
+
+        if (now - lastGossip >= std::chrono::milliseconds(CLUSTER_GOSSIP_MS))
+        {
+            gossip();
+            expirePeers();
+            lastGossip = now;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (auto &peer : _peers)
+                flush(peer.second);
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(CLUSTER_FLUSH_MS));
+    }
+}
+
+bool Cluster::handle(const sockaddr_in &addr, const Message &msg)
+{
+    if (msg.getType() == Message::NODE)
+        return handleGossip(addr, msg);
+
+    std::vector<Message> delivered;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        Peer *peer = findPeer(msg.getOriginID(), addr);
+
+        if (!peer)
+            peer = promoteSeed(msg.getOriginID(), addr);
+
+        if (!peer)
+            return false;
+
+        std::string_view batch = msg.getTextView();
+        size_t offset = 0;
+
+        // O lote é uma sequência de mensagens codificadas
+        while (offset < batch.size())
+        {
+            size_t size = Message::frameSize(batch.data() + offset, batch.size() - offset);
+            Message inner;
+
+            if (size == 0 || !Message::decode(batch.data() + offset, size, inner))
+                break;
+
+            offset += size;
+
+            // Só o dono de um ID pode anunciar ou falar por ele
+            if (ownerOf(inner.getOriginID()) != msg.getOriginID())
+                continue;
+
+            if (inner.getType() == Message::LIST)
+                peer->clients.clear();
+            else if (inner.getType() == Message::OI)
+                peer->clients[inner.getOriginID()] = inner.getUsername();
+            else if (inner.getType() == Message::TCHAU)
+                peer->clients.erase(inner.getOriginID());
+            else if (inner.getType() == Message::MSG)
+                delivered.push_back(std::move(inner));
+        }
+    }
+
+    // Entrega fora do lock do cluster: o servidor enfileira para as threads de processamento
+    for (const auto &inner : delivered)
+        _deliver(inner);
+
+    return true;
+}
+
+bool Cluster::knows(const sockaddr_in &addr)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (const auto &peer : _peers)
+    {
+        if (sameAddress(peer.second.address, addr))
+            return true;
+    }
+
+    return isConfiguredSeed(addr);
+}
+
+bool Cluster::handleGossip(const sockaddr_in &addr, const Message &msg)
+{
+    int nodeID = msg.getOriginID();
+
+    if (nodeID < 0 || nodeID >= CLUSTER_MAX_NODES || nodeID == _nodeID)
+        return false;
+
+    bool up = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // Aceito do endereço já conhecido do nó; de outro endereço, só se for
+        //     uma semente configurada (o nó mudou de endereço ou ainda não
+        //     tinha ID)
+        auto known = _peers.find(nodeID);
+        bool fromKnown = known != _peers.end() && sameAddress(known->second.address, addr);
+
+        if (!fromKnown && !isConfiguredSeed(addr))
+            return false;
+
+        // O remetente deixa de ser uma semente anônima
+        for (auto it = _seeds.begin(); it != _seeds.end(); it++)
+        {
+            if (sameAddress(*it, addr))
+            {
+                _seeds.erase(it);
+                break;
+            }
+        }
+
+        Peer &peer = _peers[nodeID];
+
+        // Um nó reiniciado não tem mais os clientes anunciados antes
+        if (peer.incarnation != 0 && peer.incarnation != msg.getSequence())
+            peer.clients.clear();
+
+        bool wasAlive = peer.alive;
+        peer.incarnation = msg.getSequence();
+        peer.address = addr;
+        peer.alive = true;
+        peer.lastSeen = std::chrono::steady_clock::now();
+
+        // Aprende os outros nós conhecidos pelo remetente:
+        //     "ID IP porta incarnação clientes"
+        std::istringstream stream(msg.getText());
+        int id, port, incarnation;
+        size_t clients;
+        std::string ip;
+        bool knowsUs = false;
+
+        while (stream >> id >> ip >> port >> incarnation >> clients)
+        {
+            if (id == _nodeID)
+                knowsUs = incarnation == _incarnation && clients == _localClients;
+
+            if (id < 0 || id >= CLUSTER_MAX_NODES || id == _nodeID || _peers.count(id))
+                continue;
+
+            Peer &learned = _peers[id];
+            memset(&learned.address, 0, sizeof(learned.address));
+            learned.address.sin_family = AF_INET;
+            learned.address.sin_port = htons(port);
+            inet_pton(AF_INET, ip.c_str(), &learned.address.sin_addr);
+        }
+
+        // A lista de clientes locais é enviada quando o nó passa a ser visto
+        //     como ativo (anúncios anteriores não foram para ele) e reenviada
+        //     enquanto a visão dele sobre este nó estiver desatualizada
+        //     (anúncios perdidos ou descartados)
+        up = !wasAlive || !knowsUs;
+    }
+
+    if (up)
+        _peerUp(nodeID);
+
+    return true;
+}
+
+void Cluster::gossip()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::string view;
+    char ip[INET_ADDRSTRLEN];
+
+    for (const auto &peer : _peers)
+    {
+        if (!peer.second.alive)
+            continue;
+
+        inet_ntop(AF_INET, &peer.second.address.sin_addr, ip, sizeof(ip));
+        view += std::to_string(peer.first) + " " + ip + " " +
+                std::to_string(ntohs(peer.second.address.sin_port)) + " " +
+                std::to_string(peer.second.incarnation) + " " +
+                std::to_string(peer.second.clients.size()) + "\n";
+    }
+
+    Message hello(Message::NODE, _nodeID, 0, "UDP_SERVER", view);
+    hello.setSequence(_incarnation);
+
+    for (const auto &peer : _peers)
+        hello.send(_sockfd, peer.second.address);
+
+    for (const auto &seed : _seeds)
+        hello.send(_sockfd, seed);
+}
+
+void Cluster::expirePeers()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto now = std::chrono::steady_clock::now();
+
+    for (auto &peer : _peers)
+    {
+        if (peer.second.alive &&
+            now - peer.second.lastSeen > std::chrono::milliseconds(CLUSTER_PEER_TIMEOUT_MS))
+        {
+            peer.second.alive = false;
+            peer.second.clients.clear();
+            peer.second.batch.clear();
+        }
+    }
+}
+
+void Cluster::relayBroadcast(const Message &msg)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (auto &peer : _peers)
+    {
+        if (peer.second.alive)
+            enqueue(peer.second, msg);
+    }
+}
+
+bool Cluster::relayPrivate(const Message &msg)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto peer = _peers.find(ownerOf(msg.getDestinationID()));
+    if (peer == _peers.end() || !peer->second.alive ||
+        !peer->second.clients.count(msg.getDestinationID()))
+        return false;
+
+    enqueue(peer->second, msg);
+    return true;
+}
+
+void Cluster::beginRoster(int nodeID)
+{
+    Message reset(Message::LIST, 0, 0, "UDP_SERVER", "");
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto peer = _peers.find(nodeID);
+    if (peer != _peers.end() && peer->second.alive)
+        enqueue(peer->second, reset);
+}
+
+void Cluster::announceJoin(int clientID, std::string_view username, int nodeID)
+{
+    Message join(Message::OI, clientID, 0, username, "");
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (nodeID < 0)
+        _localClients++;
+
+    for (auto &peer : _peers)
+    {
+        if (peer.second.alive && (nodeID < 0 || peer.first == nodeID))
+            enqueue(peer.second, join);
+    }
+}
+
+void Cluster::announceLeave(int clientID, std::string_view username)
+{
+    Message leave(Message::TCHAU, clientID, 0, username, "");
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _localClients--;
+
+    for (auto &peer : _peers)
+    {
+        if (peer.second.alive)
+            enqueue(peer.second, leave);
+    }
+}
+
+void Cluster::appendRemoteClients(std::string &clientList, int excludeID)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (const auto &peer : _peers)
+    {
+        if (!peer.second.alive)
+            continue;
+
+        for (const auto &client : peer.second.clients)
+        {
+            if (client.first != excludeID)
+                clientList += std::to_string(client.first) + ":" + client.second + "\n";
+        }
+    }
+}
+
+int Cluster::aliveNodes()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    int alive = 1;
+
+    for (const auto &peer : _peers)
+        alive += peer.second.alive;
+
+    return alive;
+}
+
+void Cluster::enqueue(Peer &peer, const Message &msg)
+{
+    size_t size = msg.encodedSize();
+
+    if (MESSAGE_HEADER_SIZE + peer.batch.size() + size > MAX_DATAGRAM_SIZE)
+        flush(peer);
+
+    size_t offset = peer.batch.size();
+    peer.batch.resize(offset + size);
+    msg.encode(&peer.batch[offset]);
+
+    // Mensagens maiores que um datagrama seguem sozinhas, fragmentadas
+    if (MESSAGE_HEADER_SIZE + peer.batch.size() >= MAX_DATAGRAM_SIZE)
+        flush(peer);
+}
+
+void Cluster::flush(Peer &peer)
+{
+    if (peer.batch.empty())
+        return;
+
+    Message relay(Message::RELAY, _nodeID, 0, "UDP_SERVER", peer.batch);
+    relay.send(_sockfd, peer.address);
+    peer.batch.clear();
+}
+
+Cluster::Peer* Cluster::promoteSeed(int nodeID, const sockaddr_in &addr)
+{
+    if (nodeID < 0 || nodeID >= CLUSTER_MAX_NODES || nodeID == _nodeID || _peers.count(nodeID))
+        return nullptr;
+
+    for (auto it = _seeds.begin(); it != _seeds.end(); it++)
+    {
+        if (sameAddress(*it, addr))
+        {
+            _seeds.erase(it);
+
+            Peer &peer = _peers[nodeID];
+            peer.address = addr;
+            return &peer;
+        }
+    }
+
+    return nullptr;
+}
+
+Cluster::Peer* Cluster::findPeer(int nodeID, const sockaddr_in &addr)
+{
+    auto peer = _peers.find(nodeID);
+
+    if (peer == _peers.end() || !sameAddress(peer->second.address, addr))
+        return nullptr;
+
+    return &peer->second;
+}
+
+bool Cluster::isConfiguredSeed(const sockaddr_in &addr) const
+{
+    for (const auto &seed : _configured)
+    {
+        if (sameAddress(seed, addr))
+            return true;
+    }
+
+    return false;
+}
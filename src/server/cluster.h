@@ -0,0 +1,237 @@
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include "../include/message.h"
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#define CLUSTER_MAX_NODES 64            /** Maior quantidade de nós (IDs de nó de 0 a 63) */
+#define CLUSTER_GOSSIP_MS 500           /** Intervalo entre mensagens de gossip */
+#define CLUSTER_PEER_TIMEOUT_MS 3000    /** Tempo sem notícias para considerar um nó fora */
+#define CLUSTER_FLUSH_MS 2              /** Intervalo máximo para esvaziar os lotes de relay */
+
+/**
+ * @brief Modo cluster do servidor.
+ *
+ * Vários servidores formam um cluster: cada nó descobre os outros por gossip
+ *     (`Message::NODE`), mantém a lista de clientes dos demais nós e repassa
+ *     broadcasts e mensagens privadas em lotes (`Message::RELAY`).
+ *
+ * Os IDs de cliente são particionados por nó: o nó dono de um cliente é
+ *     `ID % CLUSTER_MAX_NODES`. Assim, uma mensagem privada chega ao dono com
+ *     apenas um salto extra, sem consulta a nenhum diretório.
+ *
+ * O tráfego entre nós usa o mesmo socket do servidor; só são aceitos
+ *     datagramas de cluster vindos de endereços de nós conhecidos. Um nó
+ *     passa a ser conhecido pelo endereço configurado como semente ou pelo
+ *     endereço anunciado no gossip de um nó já conhecido; o endereço de um nó
+ *     conhecido só muda por gossip vindo de uma semente configurada.
+ */
+class Cluster
+{
+public:
+    /// Entrega de uma mensagem repassada por outro nó aos clientes locais
+    using DeliverCallback = std::function<void(const Message&)>;
+
+    /// Chamado quando um nó ainda não conhece os clientes deste nó
+    using PeerUpCallback = std::function<void(int)>;
+
+    /**
+     * @brief Construtor da classe Cluster.
+     *
+     * @param sockfd Socket do servidor, usado também entre nós
+     * @param nodeID ID deste nó (0 a `CLUSTER_MAX_NODES - 1`)
+     * @param seeds Endereços iniciais de outros nós
+     */
+    Cluster(int, int, const std::vector<sockaddr_in>&);
+
+    /// Destrutor
+    ~Cluster();
+
+    /**
+     * @brief Inicia a thread de gossip e envio dos lotes.
+     *
+     * @param deliver Entrega de mensagens repassadas
+     * @param peerUp Pedido de reenvio dos clientes locais a um nó
+     */
+    void start(DeliverCallback, PeerUpCallback);
+
+    /**
+     * @brief Verifica se um datagrama pertence ao protocolo do cluster.
+     */
+    static bool isClusterMessage(const Message &msg)
+    {
+        return msg.getType() == Message::NODE || msg.getType() == Message::RELAY;
+    }
+
+    /**
+     * @brief Trata um datagrama de outro nó.
+     *
+     * @param addr Endereço do remetente
+     * @param msg Mensagem recebida
+     *
+     * @retval `true` Se o remetente é um nó conhecido e a mensagem foi aceita
+     * @retval `false` Se foi descartada
+     */
+    bool handle(const sockaddr_in&, const Message&);
+
+    /**
+     * @brief Repassa um broadcast para todos os nós ativos.
+     */
+    void relayBroadcast(const Message&);
+
+    /**
+     * @brief Repassa uma mensagem privada para o nó dono do destino.
+     *
+     * @retval `true` Se o dono está ativo e conhece o destinatário
+     * @retval `false` Se o destinatário não existe no cluster
+     */
+    bool relayPrivate(const Message&);
+
+    /**
+     * @brief Inicia o reenvio da lista de clientes locais para um nó.
+     *
+     * O nó de destino descarta o que sabia sobre os clientes deste nó; os
+     *     `announceJoin` seguintes com o mesmo `nodeID` refazem a lista.
+     *
+     * @param nodeID Nó de destino
+     */
+    void beginRoster(int);
+
+    /**
+     * @brief Anuncia a entrada de um cliente local aos outros nós.
+     *
+     * @param nodeID Nó de destino, ou -1 para todos os nós ativos
+     */
+    void announceJoin(int, std::string_view, int = -1);
+
+    /**
+     * @brief Anuncia a saída de um cliente local aos outros nós.
+     */
+    void announceLeave(int, std::string_view);
+
+    /**
+     * @brief Acrescenta os clientes de outros nós a uma lista `ID:usuario\n`.
+     *
+     * @param clientList Lista a ser completada
+     * @param excludeID ID que não deve aparecer na lista
+     */
+    void appendRemoteClients(std::string&, int);
+
+    /**
+     * @brief Gera o próximo ID de cliente deste nó.
+     *
+     * @param counter Contador local de clientes
+     */
+    int clientID(int counter) const { return counter * CLUSTER_MAX_NODES + _nodeID; }
+
+    /**
+     * @brief Nó dono de um ID de cliente.
+     */
+    static int ownerOf(int clientID) { return clientID % CLUSTER_MAX_NODES; }
+
+    /**
+     * @brief Verifica se um endereço é de um nó conhecido ou de uma semente configurada.
+     */
+    bool knows(const sockaddr_in&);
+
+    /**
+     * @brief Quantidade de nós ativos (incluindo este).
+     */
+    int aliveNodes();
+
+    int getNodeID() const { return _nodeID; }
+
+private:
+    /**
+     * @brief Estado de outro nó do cluster.
+     */
+    struct Peer {
+        sockaddr_in address;                                  /** Endereço do nó */
+        bool alive = false;                                   /** Recebeu gossip recentemente */
+        int incarnation = 0;                                  /** Identifica cada execução do nó */
+        std::chrono::steady_clock::time_point lastSeen;       /** Último gossip recebido */
+        std::string batch;                                    /** Lote de mensagens a repassar */
+        std::unordered_map<int, std::string> clients;         /** Clientes conectados ao nó */
+    };
+
+    int _sockfd;                                  /** Socket compartilhado com o servidor */
+    int _nodeID;                                  /** ID deste nó */
+    int _incarnation;                             /** Momento de início deste nó, enviado no gossip */
+    bool _running;                                /** Flag da thread do cluster */
+    size_t _localClients;                         /** Clientes conectados a este nó */
+    std::vector<sockaddr_in> _seeds;              /** Endereços iniciais (nós com ID ainda desconhecido) */
+    std::vector<sockaddr_in> _configured;         /** Todas as sementes configuradas (endereços confiáveis) */
+    std::map<int, Peer> _peers;                   /** Nós conhecidos, por ID */
+    std::mutex _mutex;                            /** Protege `_peers` e `_seeds` */
+    std::thread _thread;                          /** Thread de gossip e envio de lotes */
+    DeliverCallback _deliver;                     /** Entrega local de mensagens repassadas */
+    PeerUpCallback _peerUp;                       /** Aviso de entrada de nó */
+
+    /**
+     * @brief Laço da thread do cluster: esvazia lotes e envia gossip.
+     */
+    void run();
+
+    /**
+     * @brief Envia a visão de membros deste nó para todos os conhecidos.
+     */
+    void gossip();
+
+    /**
+     * @brief Trata uma mensagem de gossip.
+     *
+     * @retval `true` Se o remetente é o endereço conhecido do nó ou uma semente
+     * @retval `false` Se foi descartada
+     */
+    bool handleGossip(const sockaddr_in&, const Message&);
+
+
+    /**
+     * @brief Acrescenta uma mensagem ao lote de um nó, enviando o lote se encher.
+     */
+    void enqueue(Peer&, const Message&);
+
+    /**
+     * @brief Envia o lote pendente de um nó.
+     */
+    void flush(Peer&);
+
+    /**
+     * @brief Marca como inativos os nós sem gossip recente.
+     */
+    void expirePeers();
+
+    /**
+     * @brief Transforma uma semente em nó conhecido ao receber dados dela.
+     *
+     * @return Peer* Nó criado, ou `nullptr` se o endereço não é uma semente
+     */
+    Peer* promoteSeed(int, const sockaddr_in&);
+
+    /**
+     * @brief Encontra um nó pelo ID, conferindo o endereço do remetente.
+     *
+     * @return Peer* Nó encontrado, ou `nullptr` se o ID não corresponde ao endereço
+     */
+    Peer* findPeer(int, const sockaddr_in&);
+
+    /**
+     * @brief Verifica se um endereço é uma das sementes configuradas.
+     */
+    bool isConfiguredSeed(const sockaddr_in&) const;
+
+    static bool sameAddress(const sockaddr_in &a, const sockaddr_in &b)
+    {
+        return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+    }
+};
+
+#endif
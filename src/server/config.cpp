@@ -0,0 +1,198 @@
+#include "config.h"
+#include <climits>
+#include <fstream>
+#include <sstream>
+
+/**
+ * @brief Descrição de um parâmetro da configuração.
+ */
+struct ConfigKey {
+    const char *name;               /** Nome no arquivo e em `--set` */
+    int ServerConfig::*field;       /** Campo correspondente */
+    int min;                        /** Menor valor aceito */
+    int max;                        /** Maior valor aceito */
+    bool size;                      /** Aceita os sufixos K e M */
+    const char *description;        /** Descrição para a ajuda */
+};
+
+static const ConfigKey KEYS[] = {
+    {"workers", &ServerConfig::workers, 1, 256, false, "Threads de processamento"},
+    {"queue_limit", &ServerConfig::queueLimit, 1, INT_MAX, false, "Tamanho máximo de cada fila de prioridade"},
+    {"fanout_threads", &ServerConfig::fanOutThreads, 0, FANOUT_MAX_THREADS - 1, false,
+     "Threads de envio adicionais (0 = conforme os núcleos)"},
+    {"fanout_batch", &ServerConfig::fanOutBatch, 1, FANOUT_MAX_BATCH, false, "Datagramas por sendmmsg"},
+    {"fanout_parallel_threshold", &ServerConfig::fanOutThreshold, 1, INT_MAX, false,
+     "Destinatários para dividir um broadcast entre threads"},
+    {"fanout_min_chunk", &ServerConfig::fanOutChunk, 1, INT_MAX, false, "Menor parte entregue a uma thread de envio"},
+    {"rcvbuf", &ServerConfig::receiveBuffer, 4096, INT_MAX / 2, true, "Buffer de recepção do socket"},
+    {"sndbuf", &ServerConfig::sendBuffer, 4096, INT_MAX / 2, true, "Buffer de envio do socket"},
+    {"rcvbuf_max", &ServerConfig::receiveBufferLimit, 4096, INT_MAX / 2, true,
+     "Limite do crescimento do buffer de recepção"},
+    {"rate_per_second", &ServerConfig::ratePerSecond, 1, 1000000, false, "Mensagens por segundo por cliente"},
+    {"rate_burst", &ServerConfig::rateBurst, 1, 1000000, false, "Mensagens aceitas em rajada"},
+    {"rate_mute_after", &ServerConfig::rateMuteAfter, 1, 255, false, "Estouros seguidos até o silêncio"},
+    {"rate_mute_ms", &ServerConfig::rateMuteMs, 1, INT_MAX, false, "Duração do silêncio (ms)"},
+    {"rate_disconnect_after", &ServerConfig::rateDisconnectAfter, 1, 255, false, "Silêncios até a desconexão"},
+    {"rate_forgive_ms", &ServerConfig::rateForgiveMs, 1, INT_MAX, false, "Tempo sem estouros que zera a contagem (ms)"},
+    {"status_interval", &ServerConfig::statusInterval, 1, 86400, false, "Intervalo do status periódico (s)"},
+    {"search_history", &ServerConfig::searchHistory, 1, 64 << 20, true, "Tweets mantidos para busca e histórico"},
+};
+
+// Remove espaços do início e do fim
+static std::string trim(const std::string &text)
+{
+    size_t begin = text.find_first_not_of(" \t\r");
+    size_t end = text.find_last_not_of(" \t\r");
+    return begin == std::string::npos ? "" : text.substr(begin, end - begin + 1);
+}
+
+// Mensagem de erro para um valor fora do intervalo do parâmetro
+static std::string rangeError(const ConfigKey &entry)
+{
+    return std::string(entry.name) + " deve estar entre " + std::to_string(entry.min) + " e " +
+           std::to_string(entry.max);
+}
+
+bool ServerConfig::set(const std::string &key, const std::string &value, std::string &error)
+{
+    for (const auto &entry : KEYS)
+    {
+        if (key != entry.name)
+            continue;
+
+        long long number;
+        size_t end = 0;
+
+        try
+        {
+            number = std::stoll(value, &end);
+        }
+        catch (const std::exception&)
+        {
+            error = "valor inválido para " + key + ": " + value;
+            return false;
+        }
+
+        int shift = 0;
+
+        if (entry.size && end < value.size() && (value[end] == 'K' || value[end] == 'k'))
+            shift = 10, end++;
+        else if (entry.size && end < value.size() && (value[end] == 'M' || value[end] == 'm'))
+            shift = 20, end++;
+
+        if (end != value.size())
+        {
+            error = "valor inválido para " + key + ": " + value;
+            return false;
+        }
+
+        // Confere antes de multiplicar: um valor grande com sufixo estouraria
+        if (number < 0 || number > (static_cast<long long>(entry.max) >> shift) ||
+            (number << shift) < entry.min)
+        {
+            error = rangeError(entry);
+            return false;
+        }
+
+        number <<= shift;
+
+        this->*entry.field = static_cast<int>(number);
+        return true;
+    }
+
+    error = "parâmetro desconhecido: " + key;
+    return false;
+}
+
+bool ServerConfig::load(const std::string &path, std::string &error)
+{
+    std::ifstream file(path);
+
+    if (!file)
+    {
+        error = "não foi possível abrir " + path;
+        return false;
+    }
+
+    std::string line;
+    int number = 0;
+
+    while (std::getline(file, line))
+    {
+        number++;
+        line = trim(line.substr(0, line.find('#')));
+
+        if (line.empty())
+            continue;
+
+        size_t equals = line.find('=');
+
+        if (equals == std::string::npos)
+        {
+            error = path + ":" + std::to_string(number) + ": esperado chave = valor";
+            return false;
+        }
+
+        if (!set(trim(line.substr(0, equals)), trim(line.substr(equals + 1)), error))
+        {
+            error = path + ":" + std::to_string(number) + ": " + error;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ServerConfig::validate(std::string &error) const
+{
+    for (const auto &entry : KEYS)
+    {
+        if (this->*entry.field < entry.min || this->*entry.field > entry.max)
+        {
+            error = rangeError(entry);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string ServerConfig::changes(const ServerConfig &previous) const
+{
+    std::ostringstream text;
+
+    for (const auto &entry : KEYS)
+    {
+        if (previous.*entry.field == this->*entry.field)
+            continue;
+
+        if (text.tellp() > 0)
+            text << ", ";
+
+        text << entry.name << ": " << previous.*entry.field << " -> " << this->*entry.field;
+    }
+
+    return text.str();
+}
+
+RateLimit::Policy ServerConfig::ratePolicy() const
+{
+    RateLimit::Policy policy;
+    policy.perSecond = static_cast<uint32_t>(ratePerSecond);
+    policy.burst = static_cast<uint32_t>(rateBurst);
+    policy.muteAfter = static_cast<uint8_t>(rateMuteAfter);
+    policy.muteMs = static_cast<uint32_t>(rateMuteMs);
+    policy.disconnectAfter = static_cast<uint8_t>(rateDisconnectAfter);
+    policy.forgiveMs = static_cast<uint32_t>(rateForgiveMs);
+    return policy;
+}
+
+std::vector<std::pair<std::string, std::string>> ServerConfig::keys()
+{
+    std::vector<std::pair<std::string, std::string>> keys;
+
+    for (const auto &entry : KEYS)
+        keys.emplace_back(entry.name, entry.description);
+
+    return keys;
+}
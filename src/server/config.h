@@ -0,0 +1,94 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "fanout.h"
+#include "scheduler.h"
+#include "search.h"
+#include "session_table.h"
+#include "../include/socket_buffers.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+#define STATUS_INTERVAL 60  /** Intervalo padrão do status periódico (s) */
+
+/**
+ * @brief Parâmetros ajustáveis do servidor.
+ *
+ * Os valores vêm, em ordem de precedência crescente, dos padrões de
+ *     compilação, do arquivo de configuração e das opções de linha de
+ *     comando. O arquivo tem uma `chave = valor` por linha, com `#` para
+ *     comentários; tamanhos aceitam os sufixos K e M. Todos os campos podem
+ *     ser alterados com o servidor rodando (`Server::reconfigure`).
+ */
+struct ServerConfig {
+    int workers = SCHEDULER_WORKERS;                        /** Threads de processamento */
+    int queueLimit = SCHEDULER_QUEUE_LIMIT;                 /** Tamanho máximo de cada fila de prioridade */
+    int fanOutThreads = 0;                                  /** Threads de envio adicionais (0 = conforme os núcleos) */
+    int fanOutBatch = FANOUT_BATCH;                         /** Datagramas por `sendmmsg` */
+    int fanOutThreshold = FANOUT_PARALLEL_THRESHOLD;        /** Destinatários para dividir o envio entre threads */
+    int fanOutChunk = FANOUT_MIN_CHUNK;                     /** Menor parte entregue a uma thread de envio */
+    int receiveBuffer = SOCKET_RECEIVE_BUFFER;              /** Buffer de recepção do socket */
+    int sendBuffer = SOCKET_SEND_BUFFER;                    /** Buffer de envio do socket */
+    int receiveBufferLimit = SOCKET_RECEIVE_LIMIT;          /** Limite do crescimento do buffer de recepção */
+    int ratePerSecond = RATE_LIMIT_PER_SECOND;              /** Mensagens por segundo por sessão */
+    int rateBurst = RATE_LIMIT_BURST;                       /** Mensagens aceitas em rajada */
+    int rateMuteAfter = RATE_LIMIT_MUTE_AFTER;              /** Estouros até o silêncio */
+    int rateMuteMs = RATE_LIMIT_MUTE_MS;                    /** Duração do silêncio (ms) */
+    int rateDisconnectAfter = RATE_LIMIT_DISCONNECT_AFTER;  /** Silêncios até a desconexão */
+    int rateForgiveMs = RATE_LIMIT_FORGIVE_MS;              /** Tempo sem estouros que zera a contagem (ms) */
+    int statusInterval = STATUS_INTERVAL;                   /** Intervalo do status periódico (s) */
+    int searchHistory = SEARCH_HISTORY;                     /** Tweets mantidos para busca e histórico */
+
+    /**
+     * @brief Altera um parâmetro pelo nome.
+     *
+     * @param key Nome do parâmetro (veja `keys()`)
+     * @param value Valor em texto
+     * @param error Recebe a descrição do erro
+     *
+     * @retval `true` Se o parâmetro existe e o valor é válido
+     * @retval `false` Caso contrário
+     */
+    bool set(const std::string&, const std::string&, std::string&);
+
+    /**
+     * @brief Aplica um arquivo de configuração sobre os valores atuais.
+     *
+     * @param path Caminho do arquivo
+     * @param error Recebe o erro, com o número da linha
+     *
+     * @retval `true` Se todas as linhas foram aplicadas
+     * @retval `false` Se o arquivo não abriu ou alguma linha é inválida
+     */
+    bool load(const std::string&, std::string&);
+
+    /**
+     * @brief Confere todos os parâmetros contra os seus intervalos.
+     *
+     * @param error Recebe a descrição do primeiro parâmetro inválido
+     *
+     * @retval `true` Se a configuração pode ser aplicada
+     * @retval `false` Caso contrário
+     */
+    bool validate(std::string&) const;
+
+    /**
+     * @brief Lista os parâmetros que diferem de outra configuração.
+     *
+     * @return std::string `chave: antigo -> novo`, separados por vírgula
+     */
+    std::string changes(const ServerConfig&) const;
+
+    /**
+     * @brief Política de limite de taxa correspondente.
+     */
+    RateLimit::Policy ratePolicy() const;
+
+    /**
+     * @brief Nomes e descrições de todos os parâmetros, para a ajuda.
+     */
+    static std::vector<std::pair<std::string, std::string>> keys();
+};
+
+#endif
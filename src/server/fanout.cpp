@@ -0,0 +1,206 @@
+#include "fanout.h"
+#include <algorithm>
+#include <sys/socket.h>
+
+FanOut::FanOut(int sockfd, int threads)
+    : _sockfd(sockfd), _threadTarget(0), _batch(FANOUT_BATCH), _threshold(FANOUT_PARALLEL_THRESHOLD),
+      _chunk(FANOUT_MIN_CHUNK), _running(true), _parallelSends(0)
+{
+    resize(threads);
+}
+
+void FanOut::configure(int threads, int batch, int threshold, int chunk)
+{
+    _batch = std::max(1, std::min(batch, FANOUT_MAX_BATCH));
+    _threshold = static_cast<size_t>(std::max(threshold, 1));
+    _chunk = static_cast<size_t>(std::max(chunk, 1));
+
+    resize(threads);
+}
+
+void FanOut::resize(int threads)
+{
+    // A thread que pede o envio também processa uma parte
+    if (threads <= 0)
+        threads = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+
+    size_t target = static_cast<size_t>(std::max(0, std::min(threads, FANOUT_MAX_THREADS - 1)));
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _threadTarget = target;
+    }
+
+    // As threads excedentes saem ao terminar a parte em andamento; partes
+    //     ainda na fila são pegas pelas outras ou por quem pediu o envio
+    if (target < _threads.size())
+    {
+        _ready.notify_all();
+
+        for (size_t i = target; i < _threads.size(); i++)
+            _threads[i].join();
+
+        _threads.resize(target);
+    }
+
+    while (_threads.size() < target)
+        _threads.emplace_back(&FanOut::run, this, _threads.size());
+}
+
+FanOut::~FanOut()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _running = false;
+    }
+
+    _ready.notify_all();
+
+    for (auto &thread : _threads)
+        thread.join();
+}
+
+void FanOut::send(const EncodedMessage &message, const std::vector<Recipient> &recipients)
+{
+    const Recipient *begin = recipients.data();
+    const Recipient *end = begin + recipients.size();
+    size_t parts = std::min(_threadTarget + 1, recipients.size() / _chunk);
+
+    if (recipients.size() < _threshold || parts < 2)
+    {
+        sendChunk(message, begin, end);
+        return;
+    }
+
+    // A lista e a mensagem pertencem a quem chamou: ele só retorna depois
+    //     que todas as partes terminam
+    Batch batch;
+    batch.pending = parts;
+    size_t size = (recipients.size() + parts - 1) / parts;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _parallelSends++;
+
+        for (size_t i = 1; i < parts; i++)
+            _chunks.push_back({&message, begin + i * size,
+                               begin + std::min((i + 1) * size, recipients.size()), &batch});
+    }
+
+    _ready.notify_all();
+
+    sendChunk(message, begin, begin + size);
+    finish(batch);
+
+    // Partes que nenhuma thread pegou ainda são enviadas aqui mesmo
+    while (true)
+    {
+        Chunk chunk;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto found = std::find_if(_chunks.begin(), _chunks.end(),
+                                      [&batch](const Chunk &queued) { return queued.batch == &batch; });
+
+            if (found == _chunks.end())
+                break;
+
+            chunk = *found;
+            _chunks.erase(found);
+        }
+
+        sendChunk(*chunk.message, chunk.begin, chunk.end);
+        finish(batch);
+    }
+
+    std::unique_lock<std::mutex> lock(batch.mutex);
+    batch.done.wait(lock, [&batch]() { return batch.pending == 0; });
+}
+
+void FanOut::run(size_t index)
+{
+    while (true)
+    {
+        Chunk chunk;
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _ready.wait(lock, [this, index]() {
+                return !_running || index >= _threadTarget || !_chunks.empty();
+            });
+
+            if (!_running || index >= _threadTarget)
+                return;
+
+            chunk = _chunks.front();
+            _chunks.pop_front();
+        }
+
+        sendChunk(*chunk.message, chunk.begin, chunk.end);
+        finish(*chunk.batch);
+    }
+}
+
+void FanOut::sendChunk(const EncodedMessage &message, const Recipient *begin, const Recipient *end)
+{
+    std::string_view plain = message.bytes(false);
+    std::string_view compressed = message.bytes(true);
+
+    // Mensagens fragmentadas não cabem em um datagrama por destinatário
+    if (plain.size() > MAX_DATAGRAM_SIZE || compressed.size() > MAX_DATAGRAM_SIZE)
+    {
+        for (const Recipient *recipient = begin; recipient != end; recipient++)
+            message.send(_sockfd, recipient->address, recipient->compression, recipient->channel.get());
+        return;
+    }
+
+    struct iovec payloads[2] = {
+        {const_cast<char*>(plain.data()), plain.size()},
+        {const_cast<char*>(compressed.data()), compressed.size()}
+    };
+    struct mmsghdr headers[FANOUT_MAX_BATCH];
+    struct iovec sealedPayloads[FANOUT_MAX_BATCH];
+    int batch = _batch;
+
+    // Um datagrama cifrado por posição do lote, reusado entre envios
+    thread_local std::vector<char> sealed(FANOUT_MAX_BATCH * (MAX_DATAGRAM_SIZE + SEAL_OVERHEAD));
+
+    while (begin != end)
+    {
+        unsigned int count = static_cast<unsigned int>(std::min<ptrdiff_t>(end - begin, batch));
+
+        for (unsigned int i = 0; i < count; i++)
+        {
+            msghdr &header = headers[i].msg_hdr;
+            memset(&header, 0, sizeof(header));
+            header.msg_name = const_cast<sockaddr_in*>(&begin[i].address);
+            header.msg_namelen = sizeof(sockaddr_in);
+            header.msg_iov = &payloads[begin[i].compression ? 1 : 0];
+            header.msg_iovlen = 1;
+
+            if (begin[i].channel)
+            {
+                char *slot = &sealed[i * (MAX_DATAGRAM_SIZE + SEAL_OVERHEAD)];
+                const iovec &payload = *header.msg_iov;
+                size_t size = begin[i].channel->seal(static_cast<const char*>(payload.iov_base), payload.iov_len,
+                                                     slot);
+
+                // Sem o datagrama cifrado, vai vazio (o cliente o descarta), nunca em claro
+                sealedPayloads[i] = {slot, size};
+                header.msg_iov = &sealedPayloads[i];
+            }
+        }
+
+        // Um envio recusado (ex.: destino inalcançável) é pulado, como no `sendto`
+        int sent = sendmmsg(_sockfd, headers, count, 0);
+        begin += sent > 0 ? sent : 1;
+    }
+}
+
+void FanOut::finish(Batch &batch)
+{
+    std::lock_guard<std::mutex> lock(batch.mutex);
+
+    if (--batch.pending == 0)
+        batch.done.notify_all();
+}
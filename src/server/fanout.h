@@ -0,0 +1,138 @@
+#ifndef FANOUT_H
+#define FANOUT_H
+
+#include "../include/message.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define FANOUT_PARALLEL_THRESHOLD 2048  /** Destinatários a partir dos quais o envio é dividido entre threads (padrão) */
+#define FANOUT_MIN_CHUNK 1024           /** Menor parte entregue a uma thread (padrão) */
+#define FANOUT_MAX_THREADS 8            /** Limite de threads de envio */
+#define FANOUT_BATCH 64                 /** Datagramas por chamada a `sendmmsg` (padrão) */
+#define FANOUT_MAX_BATCH 256            /** Maior lote aceito na configuração */
+
+/**
+ * @brief Envio de uma mesma mensagem a muitos destinatários.
+ *
+ * Os datagramas são enviados em lotes com `sendmmsg`, uma chamada de sistema
+ *     por lote. Abaixo do limiar de paralelismo, tudo é feito pela thread que
+ *     pediu o envio; acima, a lista é dividida em partes contíguas,
+ *     processadas em paralelo pelas threads de envio e pela própria thread
+ *     que pediu, que também pega as partes que ainda ninguém pegou e espera
+ *     o fim de todas. Todas usam o socket do servidor, para que o endereço de
+ *     origem dos datagramas não mude. Os parâmetros podem mudar com envios em
+ *     andamento (`configure`).
+ *
+ * Destinatários com sessão cifrada recebem a mensagem cifrada com o canal de
+ *     cada um: o lote inteiro é cifrado antes do `sendmmsg`, em buffers da
+ *     thread, e a mesma chamada leva datagramas cifrados e em claro.
+ */
+class FanOut
+{
+public:
+    /**
+     * @brief Destinatário de um envio.
+     */
+    struct Recipient {
+        sockaddr_in address;    /** Endereço do cliente */
+        bool compression;       /** Cliente aceita mensagens comprimidas */
+        std::shared_ptr<SecureChannel> channel; /** Canal da sessão (nulo = em claro) */
+    };
+
+    /**
+     * @brief Construtor da classe FanOut.
+     *
+     * @param sockfd Socket do servidor
+     * @param threads Threads de envio adicionais (0 = conforme os núcleos)
+     */
+    FanOut(int, int = 0);
+
+    /// Destrutor
+    ~FanOut();
+
+    /**
+     * @brief Altera os parâmetros do envio.
+     *
+     * Chamado apenas pela thread que controla o servidor.
+     *
+     * @param threads Threads de envio adicionais (0 = conforme os núcleos)
+     * @param batch Datagramas por `sendmmsg` (até `FANOUT_MAX_BATCH`)
+     * @param threshold Destinatários a partir dos quais o envio é dividido
+     * @param chunk Menor parte entregue a uma thread
+     */
+    void configure(int, int, int, int);
+
+    /**
+     * @brief Envia uma mensagem a todos os destinatários e espera terminar.
+     *
+     * @param message Mensagem codificada
+     * @param recipients Destinatários
+     */
+    void send(const EncodedMessage&, const std::vector<Recipient>&);
+
+    /**
+     * @brief Quantidade de envios divididos entre threads.
+     */
+    unsigned long parallelSends() const { return _parallelSends; }
+
+private:
+    /**
+     * @brief Envio em andamento, compartilhado pelas partes.
+     */
+    struct Batch {
+        std::mutex mutex;                   /** Protege `pending` */
+        std::condition_variable done;       /** Sinaliza o fim da última parte */
+        size_t pending = 0;                 /** Partes ainda em envio */
+    };
+
+    /**
+     * @brief Parte contígua da lista de destinatários.
+     */
+    struct Chunk {
+        const EncodedMessage *message;      /** Mensagem codificada */
+        const Recipient *begin;             /** Primeiro destinatário */
+        const Recipient *end;               /** Fim da parte */
+        Batch *batch;                       /** Envio ao qual a parte pertence */
+    };
+
+    int _sockfd;                            /** Socket do servidor */
+    std::vector<std::thread> _threads;      /** Threads de envio */
+    std::atomic<size_t> _threadTarget;      /** Threads com índice menor continuam rodando */
+    std::atomic<int> _batch;                /** Datagramas por `sendmmsg` */
+    std::atomic<size_t> _threshold;         /** Destinatários para dividir o envio */
+    std::atomic<size_t> _chunk;             /** Menor parte de uma thread */
+    std::deque<Chunk> _chunks;              /** Partes aguardando uma thread */
+    std::mutex _mutex;                      /** Protege a fila de partes */
+    std::condition_variable _ready;         /** Sinaliza partes novas */
+    bool _running;                          /** Flag das threads */
+    std::atomic<unsigned long> _parallelSends;  /** Envios divididos entre threads */
+
+    /**
+     * @brief Laço de uma thread de envio.
+     *
+     * @param index Posição da thread em `_threads`
+     */
+    void run(size_t);
+
+    /**
+     * @brief Ajusta a quantidade de threads de envio.
+     */
+    void resize(int);
+
+    /**
+     * @brief Envia uma parte em lotes de `sendmmsg`.
+     */
+    void sendChunk(const EncodedMessage&, const Recipient*, const Recipient*);
+
+    /**
+     * @brief Conclui uma parte e acorda quem espera pelo envio.
+     */
+    static void finish(Batch&);
+};
+
+#endif
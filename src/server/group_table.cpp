@@ -0,0 +1,211 @@
+#include "group_table.h"
+#include <algorithm>
+
+GroupTable::GroupTable() : _nextID(1), _memberships(0)
+{
+}
+
+GroupTable::Result GroupTable::create(std::string_view name, int clientID, const FanOut::Recipient &recipient,
+                                      int &groupID)
+{
+    if (!validName(name))
+        return INVALID;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_names.count(std::string(name)))
+        return EXISTS;
+
+    std::vector<int> &joined = _memberOf[clientID];
+
+    if (_groups.size() >= GROUP_MAX_GROUPS || joined.size() >= GROUP_MAX_PER_CLIENT)
+    {
+        if (joined.empty())
+            _memberOf.erase(clientID);
+
+        return LIMIT;
+    }
+
+    auto group = std::make_shared<Group>();
+    group->id = _nextID++;
+    group->name = std::string(name);
+
+    _groups[group->id] = group;
+    _names[group->name] = group->id;
+    joined.push_back(group->id);
+
+    std::lock_guard<std::mutex> members(group->mutex);
+    add(*group, clientID, recipient);
+
+    groupID = group->id;
+    return OK;
+}
+
+GroupTable::Result GroupTable::join(std::string_view name, int clientID, const FanOut::Recipient &recipient,
+                                    int &groupID)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto found = _names.find(std::string(name));
+
+    if (found == _names.end())
+        return NOT_FOUND;
+
+    const std::shared_ptr<Group> &group = _groups[found->second];
+    std::lock_guard<std::mutex> members(group->mutex);
+    groupID = group->id;
+
+    auto member = group->positions.find(clientID);
+
+    if (member != group->positions.end())
+    {
+        // Um novo pedido atualiza o endereço (reconexão pelo mesmo ID)
+        group->members[member->second] = recipient;
+        return ALREADY_MEMBER;
+    }
+
+    std::vector<int> &joined = _memberOf[clientID];
+
+    if (joined.size() >= GROUP_MAX_PER_CLIENT)
+        return LIMIT;
+
+    joined.push_back(group->id);
+    add(*group, clientID, recipient);
+
+    return OK;
+}
+
+GroupTable::Result GroupTable::leave(std::string_view name, int clientID, int &groupID)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto found = _names.find(std::string(name));
+
+    if (found == _names.end())
+        return NOT_FOUND;
+
+    groupID = found->second;
+
+    auto joined = _memberOf.find(clientID);
+
+    if (joined == _memberOf.end())
+        return NOT_MEMBER;
+
+    auto position = std::find(joined->second.begin(), joined->second.end(), groupID);
+
+    if (position == joined->second.end())
+        return NOT_MEMBER;
+
+    joined->second.erase(position);
+
+    if (joined->second.empty())
+        _memberOf.erase(joined);
+
+    remove(_groups[groupID], clientID);
+    return OK;
+}
+
+void GroupTable::leaveAll(int clientID)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto joined = _memberOf.find(clientID);
+
+    if (joined == _memberOf.end())
+        return;
+
+    for (int groupID : joined->second)
+        remove(_groups[groupID], clientID);
+
+    _memberOf.erase(joined);
+}
+
+GroupTable::Result GroupTable::recipients(int groupID, int sender, std::vector<FanOut::Recipient> &recipients,
+                                          bool &compression)
+{
+    std::shared_ptr<Group> group;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto found = _groups.find(groupID);
+
+        if (found == _groups.end())
+            return NOT_FOUND;
+
+        group = found->second;
+    }
+
+    // A cópia é feita só com o mutex do grupo: outros grupos e a tabela seguem livres
+    std::lock_guard<std::mutex> members(group->mutex);
+
+    if (!group->positions.count(sender))
+        return NOT_MEMBER;
+
+    recipients.assign(group->members.begin(), group->members.end());
+    compression = std::any_of(recipients.begin(), recipients.end(),
+                              [](const FanOut::Recipient &recipient) { return recipient.compression; });
+
+    return OK;
+}
+
+size_t GroupTable::size()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _groups.size();
+}
+
+size_t GroupTable::memberships()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _memberships;
+}
+
+bool GroupTable::validName(std::string_view name)
+{
+    if (name.empty() || name.size() > GROUP_NAME_SIZE)
+        return false;
+
+    return std::none_of(name.begin(), name.end(), [](char c) {
+        return static_cast<unsigned char>(c) <= ' ' || c == ':' || c == 0x7f;
+    });
+}
+
+void GroupTable::add(Group &group, int clientID, const FanOut::Recipient &recipient)
+{
+    group.positions[clientID] = static_cast<uint32_t>(group.ids.size());
+    group.ids.push_back(clientID);
+    group.members.push_back(recipient);
+    _memberships++;
+}
+
+void GroupTable::remove(std::shared_ptr<Group> group, int clientID)
+{
+    std::unique_lock<std::mutex> members(group->mutex);
+    auto member = group->positions.find(clientID);
+
+    if (member == group->positions.end())
+        return;
+
+    // O último membro ocupa a posição do que saiu
+    uint32_t position = member->second;
+    group->positions.erase(member);
+
+    if (position + 1 != group->ids.size())
+    {
+        group->ids[position] = group->ids.back();
+        group->members[position] = group->members.back();
+        group->positions[group->ids[position]] = position;
+    }
+
+    group->ids.pop_back();
+    group->members.pop_back();
+    _memberships--;
+
+    if (group->ids.empty())
+    {
+        // `group` mantém o grupo vivo até o fim; quem copia os membros já o tem
+        members.unlock();
+        _names.erase(group->name);
+        _groups.erase(group->id);
+    }
+}
@@ -0,0 +1,139 @@
+#ifndef GROUP_TABLE_H
+#define GROUP_TABLE_H
+
+#include "../include/message.h"
+#include "fanout.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#define GROUP_NAME_SIZE 20          /** Maior nome de grupo */
+#define GROUP_MAX_GROUPS 65536      /** Grupos existentes no servidor */
+#define GROUP_MAX_PER_CLIENT 32     /** Grupos de que um cliente pode participar */
+
+/**
+ * @brief Grupos de conversa do servidor.
+ *
+ * Cada grupo guarda os membros em vetores compactos (IDs e destinatários do
+ *     `FanOut`, na mesma posição) e um índice ID -> posição: verificar,
+ *     incluir e remover um membro são O(1), com a remoção trocando o membro
+ *     pelo último. Cada cliente guarda a lista dos seus grupos, para sair de
+ *     todos ao desconectar.
+ *
+ * O mutex da tabela protege os mapas de nomes, grupos e participações e é
+ *     segurado só para achar o grupo; o de cada grupo protege os membros. O
+ *     envio copia os destinatários com o mutex do grupo, sem passar pela
+ *     lista de clientes do servidor. A ordem é sempre tabela -> grupo.
+ */
+class GroupTable
+{
+public:
+    /// Resultado de uma operação
+    enum Result
+    {
+        OK,             /** Operação feita */
+        EXISTS,         /** Já existe um grupo com o nome */
+        NOT_FOUND,      /** Grupo inexistente */
+        NOT_MEMBER,     /** O cliente não participa do grupo */
+        ALREADY_MEMBER, /** O cliente já participa do grupo */
+        LIMIT,          /** Limite de grupos do servidor ou do cliente */
+        INVALID         /** Nome vazio, longo demais ou com espaços */
+    };
+
+    /// Construtor
+    GroupTable();
+
+    /**
+     * @brief Cria um grupo, com o criador como primeiro membro.
+     *
+     * @param name Nome do grupo
+     * @param clientID ID do criador
+     * @param recipient Endereço do criador
+     * @param groupID Recebe o ID do grupo
+     */
+    Result create(std::string_view, int, const FanOut::Recipient&, int&);
+
+    /**
+     * @brief Inclui um cliente em um grupo.
+     *
+     * @param name Nome do grupo
+     * @param clientID ID do cliente
+     * @param recipient Endereço do cliente
+     * @param groupID Recebe o ID do grupo
+     */
+    Result join(std::string_view, int, const FanOut::Recipient&, int&);
+
+    /**
+     * @brief Tira um cliente de um grupo; o grupo sem membros é apagado.
+     *
+     * @param name Nome do grupo
+     * @param clientID ID do cliente
+     * @param groupID Recebe o ID do grupo
+     */
+    Result leave(std::string_view, int, int&);
+
+    /**
+     * @brief Tira um cliente (desconectado) de todos os grupos.
+     */
+    void leaveAll(int);
+
+    /**
+     * @brief Copia os destinatários de uma mensagem ao grupo.
+     *
+     * @param groupID ID do grupo
+     * @param sender ID do remetente (deve ser membro)
+     * @param recipients Recebe os membros (substitui o conteúdo)
+     * @param compression Recebe se algum membro aceita compressão
+     */
+    Result recipients(int, int, std::vector<FanOut::Recipient>&, bool&);
+
+    /**
+     * @brief Quantidade de grupos.
+     */
+    size_t size();
+
+    /**
+     * @brief Soma dos membros de todos os grupos.
+     */
+    size_t memberships();
+
+    /**
+     * @brief Verifica se um nome de grupo é aceito.
+     */
+    static bool validName(std::string_view);
+
+private:
+    /**
+     * @brief Grupo e seus membros.
+     */
+    struct Group {
+        int id;                                         /** ID do grupo (destino das mensagens) */
+        std::string name;                               /** Nome do grupo */
+        std::mutex mutex;                               /** Protege os membros */
+        std::vector<int> ids;                           /** ID de cada membro */
+        std::vector<FanOut::Recipient> members;         /** Endereço de cada membro (mesma posição) */
+        std::unordered_map<int, uint32_t> positions;    /** ID -> posição nos vetores */
+    };
+
+    std::mutex _mutex;                                          /** Protege os mapas */
+    std::unordered_map<int, std::shared_ptr<Group>> _groups;    /** Grupos por ID */
+    std::unordered_map<std::string, int> _names;                /** Nome -> ID do grupo */
+    std::unordered_map<int, std::vector<int>> _memberOf;        /** Cliente -> grupos */
+    int _nextID;                                                /** Próximo ID de grupo */
+    size_t _memberships;                                        /** Soma dos membros */
+
+    /**
+     * @brief Inclui um membro (com os dois mutex travados).
+     */
+    void add(Group&, int, const FanOut::Recipient&);
+
+    /**
+     * @brief Remove um membro (com o mutex da tabela travado); apaga o grupo vazio.
+     */
+    void remove(std::shared_ptr<Group>, int);
+};
+
+#endif
@@ -1,25 +1,291 @@
 #include "server.h"
+#include "replication.h"
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <thread>
+#include <sstream>
+#include <algorithm>
+#include <csignal>
+
+// Converte "IP:Porta" para um endereço
+static bool parseAddress(const std::string &text, sockaddr_in &addr)
+{
+    size_t colon = text.find(':');
+    if (colon == std::string::npos)
+        return false;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(std::stoi(text.substr(colon + 1)));
+
+    return inet_pton(AF_INET, text.substr(0, colon).c_str(), &addr.sin_addr) > 0;
+}
+
+// Chave da replicação: o conteúdo do arquivo, sem os espaços finais
+static bool readKey(const std::string &path, std::string &key)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+
+    key.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+    while (!key.empty() && isspace(static_cast<unsigned char>(key.back())))
+        key.pop_back();
+
+    return key.size() >= 16;
+}
+
+// Recarga da configuração pedida por SIGHUP
+static volatile sig_atomic_t reloadRequested = 0;
+
+static void handleReload(int)
+{
+    reloadRequested = 1;
+}
+
+// Padrões, depois o arquivo (se houver), depois as opções da linha de comando
+static bool buildConfig(const std::string &path, const std::vector<std::pair<std::string, std::string>> &overrides,
+                        ServerConfig &config, std::string &error)
+{
+    ServerConfig built;
+
+    if (!path.empty() && !built.load(path, error))
+        return false;
+
+    for (const auto &entry : overrides)
+    {
+        if (!built.set(entry.first, entry.second, error))
+            return false;
+    }
+
+    config = built;
+    return true;
+}
+
+static void usage(const char *program)
+{
+    std::cerr << "Uso: " << program << " <IP> <Porta> [opções]\n"
+              << "  --cluster <ID do nó> <IP:Porta,IP:Porta,...>  Modo cluster\n"
+              << "  --replica <IP:Porta>  Replica as sessões para um standby\n"
+              << "  --standby <IP:Porta>  Aguarda como standby e assume em caso de falha\n"
+              << "  --replication-key <arquivo>  Chave compartilhada (16+ bytes) que autentica a replicação\n"
+              << "  --snapshot <arquivo>  Persiste as sessões para reinícios rápidos\n"
+              << "  --trace <arquivo> <fração>  Registra a latência de uma amostra das mensagens\n"
+              << "  --multicast <IP:Porta>  Publica os broadcasts em um grupo multicast (rede local)\n"
+              << "  --require-encryption  Recusa clientes que não cifram a sessão\n"
+              << "  --config <arquivo>  Lê os parâmetros de um arquivo (recarregado com SIGHUP)\n"
+              << "  --set <chave>=<valor>  Define um parâmetro, com precedência sobre o arquivo\n"
+              << "  --rcvbuf, --sndbuf, --rcvbuf-max <bytes>  Atalhos para --set\n"
+              << "\nParâmetros:\n";
+
+    for (const auto &key : ServerConfig::keys())
+        std::cerr << "  " << key.first << std::string(key.first.size() < 27 ? 27 - key.first.size() : 1, ' ')
+                  << key.second << "\n";
+
+    std::cerr << std::flush;
+}
 
 int main(int argc, char *argv[])
 {
-    if (argc != 3) 
+    if (argc < 3)
     {
-        std::cerr << "Uso: " << argv[0] << " <IP> <Porta>" << std::endl;
+        usage(argv[0]);
         return EXIT_FAILURE;
     }
 
      std::string ip = argv[1];
     int port = std::stoi(argv[2]);
 
+    int nodeID = -1;
+    std::vector<sockaddr_in> seeds;
+    sockaddr_in replica, standby, multicast;
+    bool hasReplica = false, hasStandby = false, hasMulticast = false, encryptionRequired = false;
+    std::string snapshot, trace, replicationKey;
+    double traceFraction = 0;
+    std::string configPath;
+    std::vector<std::pair<std::string, std::string>> overrides;
+
+    for (int i = 3; i < argc; i++)
+    {
+        std::string option = argv[i];
+
+        // Modo cluster: ID deste nó e endereços iniciais de outros nós
+        if (option == "--cluster" && i + 2 < argc)
+        {
+            nodeID = std::stoi(argv[++i]);
+            std::istringstream stream(argv[++i]);
+            std::string peer;
+            sockaddr_in addr;
+
+            while (std::getline(stream, peer, ','))
+            {
+                if (parseAddress(peer, addr))
+                    seeds.push_back(addr);
+            }
+        }
+        else if (option == "--replica" && i + 1 < argc && parseAddress(argv[i + 1], replica))
+        {
+            hasReplica = true;
+            i++;
+        }
+        else if (option == "--standby" && i + 1 < argc && parseAddress(argv[i + 1], standby))
+        {
+            hasStandby = true;
+            i++;
+        }
+        else if (option == "--replication-key" && i + 1 < argc)
+        {
+            if (!readKey(argv[++i], replicationKey))
+            {
+                std::cerr << "Chave de replicação inválida (o arquivo deve ter ao menos 16 bytes)" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if (option == "--multicast" && i + 1 < argc && parseAddress(argv[i + 1], multicast) &&
+                 IN_MULTICAST(ntohl(multicast.sin_addr.s_addr)))
+        {
+            hasMulticast = true;
+            i++;
+        }
+        else if (option == "--require-encryption")
+        {
+            encryptionRequired = true;
+        }
+        else if (option == "--snapshot" && i + 1 < argc)
+        {
+            snapshot = argv[++i];
+        }
+        else if (option == "--trace" && i + 2 < argc)
+        {
+            trace = argv[++i];
+            traceFraction = std::stod(argv[++i]);
+        }
+        else if (option == "--config" && i + 1 < argc)
+        {
+            configPath = argv[++i];
+        }
+        else if (option == "--set" && i + 1 < argc && strchr(argv[i + 1], '='))
+        {
+            std::string assignment = argv[++i];
+            size_t equals = assignment.find('=');
+            overrides.emplace_back(assignment.substr(0, equals), assignment.substr(equals + 1));
+        }
+        else if ((option == "--rcvbuf" || option == "--sndbuf" || option == "--rcvbuf-max") && i + 1 < argc)
+        {
+            std::string key = option.substr(2);
+            std::replace(key.begin(), key.end(), '-', '_');
+            overrides.emplace_back(key, argv[++i]);
+        }
+        else
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    ServerConfig config;
+    std::string configError;
+
+    if (!buildConfig(configPath, overrides, config, configError))
+    {
+        std::cerr << "Configuração inválida: " << configError << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    struct sigaction reload;
+    reload.sa_handler = handleReload;
+    sigemptyset(&reload.sa_mask);
+    reload.sa_flags = SA_RESTART;
+    sigaction(SIGHUP, &reload, nullptr);
+
+    // Standby: replica o primário até ele parar de responder e então assume
+    //     o endereço dele com as mesmas sessões
+    std::unique_ptr<ReplicationStandby> replicationStandby;
+    if (hasStandby)
+    {
+        sockaddr_in primary;
+        if (!parseAddress(ip + ":" + std::to_string(port), primary))
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        replicationStandby = std::make_unique<ReplicationStandby>(standby, primary, replicationKey);
+        std::cout << "Standby aguardando o primário..." << std::endl;
+        replicationStandby->waitForFailover();
+    }
+
     Server server(ip, port);
+
+    if (!server.reconfigure(config, configError))
+    {
+        std::cerr << "Configuração inválida: " << configError << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (nodeID >= 0)
+        server.enableCluster(nodeID, seeds);
+
+    if (!snapshot.empty())
+        server.enablePersistence(snapshot);
+
+    if (hasReplica)
+        server.enableReplication(replica, replicationKey);
+
+    if (!trace.empty())
+        server.enableTracing(trace, traceFraction);
+
+    if (hasMulticast)
+        server.enableMulticast(multicast);
+
+    if (encryptionRequired)
+        server.requireEncryption();
+
+    if (replicationStandby)
+    {
+        server.restore(replicationStandby->getClients(), replicationStandby->getIdCount());
+
+        auto failover = std::chrono::duration_cast<std::chrono::milliseconds>
+                            (std::chrono::steady_clock::now() - replicationStandby->getLastHeard());
+        std::cout << "Failover: " << replicationStandby->getClients().size() << " sessões, LSN "
+                  << replicationStandby->getAppliedLSN() << ", assumido em "
+                  << failover.count() << " ms após o último contato do primário" << std::endl;
+
+        replicationStandby.reset();
+    }
+
     server.start();
 
     while (true)
     {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        server.runTimers(std::chrono::seconds(1));
+        server.flushTrace();
+
+        if (!reloadRequested)
+            continue;
+
+        reloadRequested = 0;
+
+        // Um arquivo inválido não altera nada: a configuração em vigor continua
+        ServerConfig previous = server.configuration();
+
+        if (!buildConfig(configPath, overrides, config, configError))
+        {
+            std::cerr << "Recarga ignorada: " << configError << std::endl;
+            continue;
+        }
+
+        if (!server.reconfigure(config, configError))
+        {
+            std::cerr << "Recarga ignorada: " << configError << std::endl;
+            continue;
+        }
+
+        std::string changes = config.changes(previous);
+        std::cout << "Configuração recarregada: " << (changes.empty() ? "sem alterações" : changes) << std::endl;
     }
-    
+
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,175 @@
+#include "presence.h"
+#include <algorithm>
+
+bool PresenceBoard::update(int clientID, std::string_view username, Message::PresenceState state, uint32_t now)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto inserted = _entries.try_emplace(clientID);
+    Entry &entry = inserted.first->second;
+
+    if (inserted.second)
+    {
+        entry.username = std::string(username.substr(0, MAX_USERNAME_SIZE));
+        entry.state = entry.announced = Message::PRESENCE_OFFLINE;
+        entry.pending = false;
+    }
+
+    if (state == Message::PRESENCE_TYPING)
+        entry.typingUntil = now + PRESENCE_TYPING_MS;
+
+    if (entry.state == state)
+    {
+        // Saída de quem nunca foi publicado (ex.: sessão restaurada): nada a avisar
+        if (inserted.second)
+            _entries.erase(inserted.first);
+
+        _suppressed++;
+        return false;
+    }
+
+    if (state == Message::PRESENCE_TYPING)
+        _typing.push_back(clientID);
+
+    entry.state = state;
+    touch(clientID, entry);
+    _updates++;
+
+    return true;
+}
+
+int PresenceBoard::wait(uint32_t now)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // A primeira mudança depois de um período calmo sai na hora; as seguintes esperam a janela
+    if (!_pending.empty())
+    {
+        uint32_t elapsed = now - _lastBatch;
+        return !_published || elapsed >= PRESENCE_INTERVAL_MS ? 0 : static_cast<int>(PRESENCE_INTERVAL_MS - elapsed);
+    }
+
+    int next = -1;
+
+    for (int clientID : _typing)
+    {
+        const auto found = _entries.find(clientID);
+
+        if (found == _entries.end() || found->second.state != Message::PRESENCE_TYPING)
+            return 0;
+
+        int left = std::max(0, static_cast<int32_t>(found->second.typingUntil - now));
+        next = next < 0 ? left : std::min(next, left);
+    }
+
+    return next;
+}
+
+size_t PresenceBoard::collect(uint32_t now, std::vector<std::string> &batches)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t published = 0;
+
+    // Quem parou de digitar sem avisar (ou já mudou de estado) sai da lista
+    for (size_t i = 0; i < _typing.size();)
+    {
+        auto found = _entries.find(_typing[i]);
+
+        if (found != _entries.end() && found->second.state == Message::PRESENCE_TYPING &&
+            static_cast<int32_t>(found->second.typingUntil - now) > 0)
+        {
+            i++;
+            continue;
+        }
+
+        if (found != _entries.end() && found->second.state == Message::PRESENCE_TYPING)
+        {
+            found->second.state = Message::PRESENCE_ONLINE;
+            touch(found->first, found->second);
+        }
+
+        _typing[i] = _typing.back();
+        _typing.pop_back();
+    }
+
+    for (int clientID : _pending)
+    {
+        auto found = _entries.find(clientID);
+        if (found == _entries.end())
+            continue;
+
+        Entry &entry = found->second;
+        entry.pending = false;
+
+        // Voltou ao estado publicado dentro da janela: ninguém precisa saber
+        if (entry.state == entry.announced)
+            _suppressed++;
+        else
+        {
+            append(batches, clientID, entry);
+            entry.announced = entry.state;
+            published++;
+        }
+
+        if (entry.state == Message::PRESENCE_OFFLINE)
+            _entries.erase(found);
+    }
+
+    _pending.clear();
+
+    if (published)
+    {
+        _lastBatch = now;
+        _published = true;
+        _batches += batches.size();
+    }
+
+    return published;
+}
+
+std::string PresenceBoard::snapshot(int except)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<std::string> lines;
+
+    for (const auto &client : _entries)
+    {
+        if (client.first != except && client.second.announced != Message::PRESENCE_ONLINE &&
+            client.second.announced != Message::PRESENCE_OFFLINE)
+        {
+            Entry published = client.second;
+            published.state = published.announced;
+            append(lines, client.first, published);
+        }
+    }
+
+    // Vai em uma única mensagem (fragmentada se preciso), como o `LIST`
+    std::string snapshot;
+    for (const std::string &batch : lines)
+    {
+        if (snapshot.size() + batch.size() > MAX_MESSAGE_SIZE - MESSAGE_HEADER_SIZE)
+            break;
+
+        snapshot += batch;
+    }
+
+    return snapshot;
+}
+
+void PresenceBoard::touch(int clientID, Entry &entry)
+{
+    if (!entry.pending)
+    {
+        entry.pending = true;
+        _pending.push_back(clientID);
+    }
+}
+
+void PresenceBoard::append(std::vector<std::string> &batches, int clientID, const Entry &entry)
+{
+    std::string line = std::to_string(clientID) + ":" + std::to_string(entry.state) + ":" + entry.username + "\n";
+
+    if (batches.empty() || batches.back().size() + line.size() > PRESENCE_BATCH_SIZE)
+        batches.emplace_back();
+
+    batches.back() += line;
+}
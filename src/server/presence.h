@@ -0,0 +1,125 @@
+#ifndef PRESENCE_H
+#define PRESENCE_H
+
+#include "../include/message.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#define PRESENCE_INTERVAL_MS 250        /** Janela em que as mudanças de todos os clientes viram um lote */
+#define PRESENCE_TYPING_MS 6000         /** "Digitando" sem renovação volta a "conectado" */
+#define PRESENCE_BATCH_SIZE (MAX_DATAGRAM_SIZE - MESSAGE_HEADER_SIZE - SEAL_OVERHEAD)  /** Texto de um lote (um datagrama) */
+
+/**
+ * @brief Estados de presença dos clientes locais e as mudanças a publicar.
+ *
+ * Cada cliente tem o estado atual e o último publicado. Uma mudança só marca
+ *     o cliente como pendente; a cada `PRESENCE_INTERVAL_MS`, as pendentes de
+ *     todos os clientes viram um lote ("<id>:<estado>:<usuario>" por linha),
+ *     publicado uma vez para todos. Informar o estado atual não gera nada, e
+ *     um cliente que volta ao estado publicado dentro da janela (digitou e
+ *     parou, saiu e voltou) fica de fora do lote. Assim, cada destinatário
+ *     recebe um datagrama por janela com mudanças, qualquer que seja o número
+ *     de clientes que mudaram, em vez de um por mudança.
+ *
+ * Tem o próprio mutex e nunca chama o servidor: pode ser usada com o mutex de
+ *     clientes travado (ordem clientes -> presença).
+ */
+class PresenceBoard
+{
+public:
+    /**
+     * @brief Registra o estado de um cliente.
+     *
+     * @param clientID ID do cliente
+     * @param username Nome do cliente
+     * @param state Novo estado
+     * @param now Instante atual em milissegundos (relógio monotônico)
+     *
+     * @retval `true` Se o estado mudou e o cliente entra no próximo lote
+     * @retval `false` Se já era o estado atual (no "digitando", só renova o prazo)
+     */
+    bool update(int, std::string_view, Message::PresenceState, uint32_t);
+
+    /**
+     * @brief Tempo até o próximo lote.
+     *
+     * @param now Instante atual em milissegundos
+     *
+     * @return int Milissegundos até haver o que publicar (0 = agora, -1 = nada pendente)
+     */
+    int wait(uint32_t);
+
+    /**
+     * @brief Monta os lotes com as mudanças desde o último.
+     *
+     * Antes, os "digitando" vencidos voltam a "conectado".
+     *
+     * @param now Instante atual em milissegundos
+     * @param batches Recebe os textos dos lotes, cada um cabendo em um datagrama
+     *
+     * @return size_t Mudanças publicadas
+     */
+    size_t collect(uint32_t, std::vector<std::string>&);
+
+    /**
+     * @brief Estados publicados diferentes de "conectado", para quem acaba de entrar.
+     *
+     * Os conectados já vêm no `LIST`; no formato dos lotes.
+     *
+     * @param except ID do cliente que vai receber
+     */
+    std::string snapshot(int);
+
+    /**
+     * @brief Mudanças aceitas.
+     */
+    unsigned long updates() const { return _updates; }
+
+    /**
+     * @brief Estados repetidos e mudanças desfeitas dentro da janela.
+     */
+    unsigned long suppressed() const { return _suppressed; }
+
+    /**
+     * @brief Lotes publicados.
+     */
+    unsigned long batches() const { return _batches; }
+
+private:
+    /**
+     * @brief Presença de um cliente.
+     */
+    struct Entry {
+        std::string username;       /** Nome do cliente */
+        uint8_t state;              /** Estado atual (`Message::PresenceState`) */
+        uint8_t announced;          /** Último estado publicado */
+        bool pending;               /** Está em `_pending` */
+        uint32_t typingUntil;       /** Fim do "digitando" (ms) */
+    };
+
+    std::mutex _mutex;                          /** Protege os estados e as listas */
+    std::unordered_map<int, Entry> _entries;    /** Clientes por ID */
+    std::vector<int> _pending;                  /** Clientes com mudança desde o último lote */
+    std::vector<int> _typing;                   /** Clientes que estavam digitando (verificados no lote) */
+    uint32_t _lastBatch = 0;                    /** Instante do último lote */
+    bool _published = false;                    /** Algum lote já foi montado */
+    std::atomic<unsigned long> _updates{0};     /** Mudanças aceitas */
+    std::atomic<unsigned long> _suppressed{0};  /** Mudanças que não geraram publicação */
+    std::atomic<unsigned long> _batches{0};     /** Lotes publicados */
+
+    /**
+     * @brief Marca um cliente como pendente.
+     */
+    void touch(int, Entry&);
+
+    /**
+     * @brief Acrescenta a linha de um cliente ao último lote, abrindo outro se não couber.
+     */
+    static void append(std::vector<std::string>&, int, const Entry&);
+};
+
+#endif
@@ -0,0 +1,499 @@
+#include "replication.h"
+#include <openssl/crypto.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <iostream>
+#include <ctime>
+#include <unistd.h>
+#include <poll.h>
+
+// Máscara do segredo de retomada: HMAC-SHA256(chave, "retomada" || nonce)
+static void resumePad(const std::string &key, const unsigned char *nonce, unsigned char *pad)
+{
+    unsigned char input[8 + REPLICATION_NONCE_SIZE];
+    memcpy(input, "retomada", 8);
+    memcpy(input + 8, nonce, REPLICATION_NONCE_SIZE);
+
+    unsigned int size = 0;
+    HMAC(EVP_sha256(), key.data(), static_cast<int>(key.size()), input, sizeof(input), pad, &size);
+}
+
+std::string Replication::encodeClient(const ClientInfo &client, const std::string &key)
+{
+    std::string data(7, '\0');
+    memcpy(&data[0], &client.address.sin_addr.s_addr, 4);
+    memcpy(&data[4], &client.address.sin_port, 2);
+    data[6] = (client.compression ? 1 : 0) | (client.encrypted ? 2 : 0);
+
+    // O segredo de retomada só viaja mascarado pela chave compartilhada
+    unsigned char nonce[REPLICATION_NONCE_SIZE];
+    if (key.empty() || !client.resumable || RAND_bytes(nonce, sizeof(nonce)) != 1)
+        return data;
+
+    unsigned char pad[EVP_MAX_MD_SIZE];
+    resumePad(key, nonce, pad);
+
+    data[6] |= 4;
+    data.append(reinterpret_cast<char*>(nonce), sizeof(nonce));
+    for (int i = 0; i < SEAL_KEY_SIZE; i++)
+        data.push_back(static_cast<char>(client.resume[i] ^ pad[i]));
+
+    OPENSSL_cleanse(pad, sizeof(pad));
+    return data;
+}
+
+bool Replication::decodeClient(const std::string &data, ClientInfo &client, const std::string &key)
+{
+    if (data.size() < 7)
+        return false;
+
+    bool resumable = data[6] & 4;
+    if (data.size() != (resumable ? 7 + REPLICATION_NONCE_SIZE + SEAL_KEY_SIZE : 7) || (resumable && key.empty()))
+        return false;
+
+    memset(&client.address, 0, sizeof(client.address));
+    client.address.sin_family = AF_INET;
+    memcpy(&client.address.sin_addr.s_addr, &data[0], 4);
+    memcpy(&client.address.sin_port, &data[4], 2);
+    client.compression = data[6] & 1;
+    client.encrypted = data[6] & 2;
+    client.resumable = resumable;
+
+    if (resumable)
+    {
+        unsigned char pad[EVP_MAX_MD_SIZE];
+        resumePad(key, reinterpret_cast<const unsigned char*>(&data[7]), pad);
+
+        for (int i = 0; i < SEAL_KEY_SIZE; i++)
+            client.resume[i] = static_cast<unsigned char>(data[7 + REPLICATION_NONCE_SIZE + i]) ^ pad[i];
+
+        OPENSSL_cleanse(pad, sizeof(pad));
+    }
+
+    return true;
+}
+
+// HMAC-SHA256 da mensagem codificada, truncado em `REPLICATION_TAG_SIZE` bytes
+static std::string tagOf(const Message &message, const std::string &key)
+{
+    std::string encoded(message.encodedSize(), '\0');
+    message.encode(&encoded[0]);
+
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int size = 0;
+    HMAC(EVP_sha256(), key.data(), static_cast<int>(key.size()),
+         reinterpret_cast<const unsigned char*>(encoded.data()), encoded.size(), digest, &size);
+
+    return std::string(reinterpret_cast<char*>(digest), REPLICATION_TAG_SIZE);
+}
+
+uint64_t Replication::firstCounter()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+Message Replication::sign(const Message &message, const std::string &key, uint64_t counter)
+{
+    std::string text = message.getText();
+
+    for (int shift = 56; shift >= 0; shift -= 8)
+        text.push_back(static_cast<char>(counter >> shift));
+
+    Message counted(message.getType(), message.getOriginID(), message.getDestinationID(),
+                    message.getUsernameView(), text);
+    counted.setSequence(message.getSequence());
+
+    if (key.empty())
+        return counted;
+
+    Message tagged(message.getType(), message.getOriginID(), message.getDestinationID(),
+                   message.getUsernameView(), text + tagOf(counted, key));
+    tagged.setSequence(message.getSequence());
+    return tagged;
+}
+
+bool Replication::verify(Message &message, const std::string &key, uint64_t &counter)
+{
+    size_t trailer = REPLICATION_COUNTER_SIZE + (key.empty() ? 0 : REPLICATION_TAG_SIZE);
+    std::string_view text = message.getTextView();
+
+    if (text.size() < trailer)
+        return false;
+
+    // O HMAC cobre a mensagem com o contador
+    Message counted(message.getType(), message.getOriginID(), message.getDestinationID(), message.getUsernameView(),
+                    std::string(text.substr(0, text.size() - trailer + REPLICATION_COUNTER_SIZE)));
+    counted.setSequence(message.getSequence());
+
+    if (!key.empty() &&
+        CRYPTO_memcmp(tagOf(counted, key).data(), text.data() + text.size() - REPLICATION_TAG_SIZE,
+                      REPLICATION_TAG_SIZE) != 0)
+        return false;
+
+    const char *field = text.data() + text.size() - trailer;
+    counter = 0;
+
+    for (int i = 0; i < REPLICATION_COUNTER_SIZE; i++)
+        counter = (counter << 8) | static_cast<unsigned char>(field[i]);
+
+    Message plain(message.getType(), message.getOriginID(), message.getDestinationID(),
+                  message.getUsernameView(), std::string(text.substr(0, text.size() - trailer)));
+    plain.setSequence(message.getSequence());
+
+    message = std::move(plain);
+    return true;
+}
+
+bool Replication::sameAddress(const sockaddr_in &a, const sockaddr_in &b)
+{
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+ReplicationPrimary::ReplicationPrimary(int sockfd, const sockaddr_in &replica, const std::string &key)
+    : _sockfd(sockfd), _replica(replica), _key(key), _running(false), _snapshotRequested(false),
+      _counter(Replication::firstCounter()), _ackCounter(0), _lsn(0), _ackedLSN(0)
+{
+    _incarnation = static_cast<int>(std::time(nullptr));
+}
+
+ReplicationPrimary::~ReplicationPrimary()
+{
+    _running = false;
+
+    if (_thread.joinable())
+        _thread.join();
+}
+
+void ReplicationPrimary::start(SnapshotCallback snapshot)
+{
+    _snapshot = std::move(snapshot);
+    _running = true;
+
+    _thread = std::thread(&ReplicationPrimary::run, this);
+}
+
+void ReplicationPrimary::run()
+{
+    auto lastHeartbeat = std::chrono::steady_clock::now();
+    auto lastSnapshot = std::chrono::steady_clock::time_point();
+
+    while (_running)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(REPLICATION_FLUSH_MS));
+
+        // O standby perdeu entradas (ou acabou de entrar): envia tudo
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastSnapshot > std::chrono::milliseconds(REPLICATION_HEARTBEAT_MS) &&
+            _snapshotRequested.exchange(false))
+        {
+            sendSnapshot();
+            lastSnapshot = now;
+        }
+
+        bool heartbeat = now - lastHeartbeat >= std::chrono::milliseconds(REPLICATION_HEARTBEAT_MS);
+
+        flush(heartbeat);
+
+        if (heartbeat)
+            lastHeartbeat = now;
+    }
+}
+
+bool ReplicationPrimary::handleAck(const sockaddr_in &from, Message &ack)
+{
+    uint64_t counter = 0;
+
+    // Só o standby configurado confirma (e, com chave, só com o HMAC certo)
+    if (!Replication::sameAddress(from, _replica) || !Replication::verify(ack, _key, counter))
+        return false;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // Confirmações repetidas ou atrasadas são descartadas
+    if (counter <= _ackCounter)
+        return false;
+
+    _ackCounter = counter;
+    uint32_t acked = static_cast<uint32_t>(ack.getSequence());
+
+    if (acked > _ackedLSN && acked <= _lsn)
+        _ackedLSN = acked;
+
+    while (!_pending.empty() && _pending.front().first <= _ackedLSN)
+        _pending.pop_front();
+
+    if (ack.getDestinationID() == 1)
+        _snapshotRequested = true;
+
+    return true;
+}
+
+void ReplicationPrimary::send(const Message &batch)
+{
+    Replication::sign(batch, _key, ++_counter).send(_sockfd, _replica);
+}
+
+void ReplicationPrimary::logAdd(int clientID, const ClientInfo &client, int idCount)
+{
+    Message entry(Message::OI, clientID, idCount, client.username, Replication::encodeClient(client, _key));
+    append(entry);
+}
+
+void ReplicationPrimary::logDelete(int clientID)
+{
+    Message entry(Message::TCHAU, clientID, 0, "", "");
+    append(entry);
+}
+
+void ReplicationPrimary::append(const Message &entry)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    Message numbered(entry);
+    numbered.setSequence(static_cast<int>(++_lsn));
+    _pending.emplace_back(_lsn, std::chrono::steady_clock::now());
+
+    size_t offset = _batch.size();
+    _batch.resize(offset + numbered.encodedSize());
+    numbered.encode(&_batch[offset]);
+}
+
+void ReplicationPrimary::flush(bool heartbeat)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_batch.empty() && !heartbeat)
+        return;
+
+    Message batch(Message::REPL, _incarnation, Replication::LOG, "UDP_SERVER", _batch);
+    batch.setSequence(static_cast<int>(_lsn));
+    send(batch);
+    _batch.clear();
+}
+
+void ReplicationPrimary::sendSnapshot()
+{
+    std::unordered_map<int, ClientInfo> clients;
+    int idCount = 0;
+    uint32_t lsn;
+
+    // O LSN é lido antes do estado: entradas repetidas são idempotentes
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        lsn = _lsn;
+    }
+
+    _snapshot(clients, idCount);
+
+    std::string part;
+    int kind = Replication::SNAPSHOT_BEGIN;
+
+    for (const auto &client : clients)
+    {
+        Message entry(Message::OI, client.first, idCount, client.second.username,
+                      Replication::encodeClient(client.second, _key));
+
+        if (MESSAGE_HEADER_SIZE + REPLICATION_COUNTER_SIZE + REPLICATION_TAG_SIZE + part.size() +
+                entry.encodedSize() > MAX_DATAGRAM_SIZE)
+        {
+            send(Message(Message::REPL, _incarnation, kind, "UDP_SERVER", part));
+            kind = Replication::SNAPSHOT_PART;
+            part.clear();
+        }
+
+        size_t offset = part.size();
+        part.resize(offset + entry.encodedSize());
+        entry.encode(&part[offset]);
+    }
+
+    if (!part.empty() || kind == Replication::SNAPSHOT_BEGIN)
+        send(Message(Message::REPL, _incarnation, kind, "UDP_SERVER", part));
+
+    // O fim do snapshot leva o total de entradas e o contador de IDs
+    Message end(Message::REPL, _incarnation, Replication::SNAPSHOT_END, "UDP_SERVER",
+                std::to_string(clients.size()) + " " + std::to_string(idCount));
+    end.setSequence(static_cast<int>(lsn));
+    send(end);
+}
+
+uint32_t ReplicationPrimary::lagEntries()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _lsn - _ackedLSN;
+}
+
+long ReplicationPrimary::lagMilliseconds()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_pending.empty())
+        return 0;
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>
+               (std::chrono::steady_clock::now() - _pending.front().second).count();
+}
+
+ReplicationStandby::ReplicationStandby(const sockaddr_in &listen, const sockaddr_in &primary, const std::string &key)
+    : _primary(primary), _key(key), _idCount(1), _appliedLSN(0), _incarnation(0),
+      _counter(Replication::firstCounter()), _primaryCounter(0), _inSnapshot(false), _snapshotEntries(0)
+{
+    if ((_sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ||
+        bind(_sockfd, (const struct sockaddr *)&listen, sizeof(listen)) < 0)
+    {
+        std::cerr << "Failed to bind replication address" << std::endl;
+        exit(1);
+    }
+}
+
+ReplicationStandby::~ReplicationStandby()
+{
+    close(_sockfd);
+}
+
+void ReplicationStandby::waitForFailover()
+{
+    struct pollfd pfd = {_sockfd, POLLIN, 0};
+    bool heard = false;
+
+    while (true)
+    {
+        if (poll(&pfd, 1, REPLICATION_HEARTBEAT_MS) > 0)
+        {
+            sockaddr_in from;
+            Message batch;
+            uint64_t counter = 0;
+
+            // Com chave, o HMAC garante que o lote veio mesmo do primário; o
+            //     contador, que não é a repetição de um lote antigo
+            if (Message::receive(_sockfd, from, batch, MAX_DATAGRAM_SIZE, &_reassembler, nullptr, this) <= 0 ||
+                batch.getType() != Message::REPL || !Replication::verify(batch, _key, counter) ||
+                counter <= _primaryCounter)
+                continue;
+
+            _primaryCounter = counter;
+
+            heard = true;
+            _lastHeard = std::chrono::steady_clock::now();
+
+            bool inSync = apply(batch);
+            acknowledge(from, !inSync);
+        }
+
+        if (heard && std::chrono::steady_clock::now() - _lastHeard >
+                         std::chrono::milliseconds(REPLICATION_TIMEOUT_MS))
+            return;
+    }
+}
+
+bool ReplicationStandby::apply(const Message &batch)
+{
+    // Um primário reiniciado recomeça o log: é preciso um snapshot
+    if (batch.getOriginID() != _incarnation)
+    {
+        _incarnation = batch.getOriginID();
+        _appliedLSN = 0;
+
+        if (batch.getDestinationID() != Replication::SNAPSHOT_BEGIN)
+            return false;
+    }
+
+    int kind = batch.getDestinationID();
+
+    if (kind == Replication::SNAPSHOT_BEGIN)
+    {
+        _clients.clear();
+        _inSnapshot = true;
+        _snapshotEntries = 0;
+    }
+    else if (kind != Replication::LOG && !_inSnapshot)
+    {
+        return true;
+    }
+
+    if (kind == Replication::SNAPSHOT_END)
+    {
+        size_t total = 0;
+        int idCount = 0;
+        sscanf(batch.getText().c_str(), "%zu %d", &total, &idCount);
+
+        _inSnapshot = false;
+
+        if (total != _snapshotEntries)
+            return false;
+
+        _idCount = idCount;
+        _appliedLSN = static_cast<uint32_t>(batch.getSequence());
+        return true;
+    }
+
+    std::string_view entries = batch.getTextView();
+    size_t offset = 0;
+
+    while (offset < entries.size())
+    {
+        size_t size = Message::frameSize(entries.data() + offset, entries.size() - offset);
+        Message entry;
+
+        if (size == 0 || !Message::decode(entries.data() + offset, size, entry))
+            return false;
+
+        offset += size;
+
+        if (kind == Replication::LOG)
+        {
+            uint32_t lsn = static_cast<uint32_t>(entry.getSequence());
+
+            if (lsn <= _appliedLSN)
+                continue;
+
+            if (lsn != _appliedLSN + 1)
+                return false;
+
+            _appliedLSN = lsn;
+        }
+        else
+        {
+            _snapshotEntries++;
+        }
+
+        if (entry.getType() == Message::OI)
+        {
+            ClientInfo client;
+            client.setUsername(entry.getUsernameView());
+
+            if (Replication::decodeClient(entry.getText(), client, _key))
+            {
+                _clients[entry.getOriginID()] = client;
+                _idCount = std::max(_idCount, entry.getDestinationID());
+            }
+        }
+        else if (entry.getType() == Message::TCHAU)
+        {
+            _clients.erase(entry.getOriginID());
+        }
+    }
+
+    if (_inSnapshot)
+        return true;
+
+    // Depois do lote, o LSN aplicado deve alcançar o do primário
+    return _appliedLSN >= static_cast<uint32_t>(batch.getSequence());
+}
+
+size_t ReplicationStandby::filter(const sockaddr_in &from, char*, size_t size)
+{
+    // Só o endereço do primário configurado (o log sai pelo socket do servidor)
+    if (from.sin_port != _primary.sin_port ||
+        (_primary.sin_addr.s_addr != htonl(INADDR_ANY) && from.sin_addr.s_addr != _primary.sin_addr.s_addr))
+        return 0;
+
+    return size;
+}
+
+void ReplicationStandby::acknowledge(const sockaddr_in &primary, bool needSnapshot)
+{
+    Message ack(Message::REPL_ACK, 0, needSnapshot ? 1 : 0, "UDP_SERVER", "");
+    ack.setSequence(static_cast<int>(_appliedLSN));
+    Replication::sign(ack, _key, ++_counter).send(_sockfd, primary);
+}
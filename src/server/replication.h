@@ -0,0 +1,262 @@
+#ifndef REPLICATION_H
+#define REPLICATION_H
+
+#include "../include/message.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#define REPLICATION_HEARTBEAT_MS 100    /** Intervalo entre heartbeats do primário */
+#define REPLICATION_TIMEOUT_MS 1000     /** Silêncio do primário que dispara o failover */
+#define REPLICATION_FLUSH_MS 5          /** Intervalo máximo para enviar entradas do log */
+#define REPLICATION_TAG_SIZE 16         /** Bytes do HMAC-SHA256 (truncado) no fim de `REPL` e `REPL_ACK` */
+#define REPLICATION_COUNTER_SIZE 8      /** Contador de envio (big-endian) antes do HMAC */
+#define REPLICATION_NONCE_SIZE 16       /** Nonce da máscara do segredo de retomada */
+
+/**
+ * @brief Entrada do log de replicação.
+ *
+ * No fio, cada entrada é uma `Message` codificada: `OI` para um cliente
+ *     adicionado (texto com IP, porta e flags em 7 bytes) ou `TCHAU` para um
+ *     cliente removido. Com chave compartilhada, o `OI` de uma sessão cifrada
+ *     leva ainda o segredo de retomada, mascarado por um HMAC da chave sobre
+ *     um nonce aleatório; sem chave ele não sai do primário, e o standby não
+ *     retoma sessões cifradas. O número de sequência da mensagem é a posição no log
+ *     (LSN) e o destino de um `OI` carrega o contador de IDs do primário.
+ *
+ * Lotes de entradas seguem em `Message::REPL`, enviados pelo socket do
+ *     próprio servidor (o endereço que o standby assume); o standby confirma
+ *     o que aplicou com `Message::REPL_ACK`. Cada lado só aceita datagramas do
+ *     endereço (IP e porta) do outro. O texto de ambos termina com um contador
+ *     de envio e, com uma chave compartilhada, com um HMAC-SHA256 da mensagem
+ *     inteira, contador incluído. O contador começa no relógio de parede em
+ *     microssegundos e cresce a cada datagrama, então também cresce entre
+ *     execuções; o receptor descarta o que não for estritamente mais novo, o
+ *     que impede a repetição de heartbeats, lotes e snapshots antigos.
+ */
+namespace Replication
+{
+    /// Tipo de lote enviado pelo primário (campo destino de `REPL`)
+    enum BatchKind
+    {
+        LOG = 0,            /** Entradas incrementais (ou só heartbeat) */
+        SNAPSHOT_BEGIN = 1, /** Início de um snapshot: o standby descarta seu estado */
+        SNAPSHOT_PART = 2,  /** Continuação de um snapshot */
+        SNAPSHOT_END = 3    /** Fim de um snapshot */
+    };
+
+    /// Codifica o endereço e as flags de um cliente (e o segredo de retomada mascarado, com chave)
+    std::string encodeClient(const ClientInfo&, const std::string&);
+
+    /// Decodifica o endereço e as flags de um cliente (e o segredo de retomada, com chave)
+    bool decodeClient(const std::string&, ClientInfo&, const std::string&);
+
+    /// Valor inicial do contador de envio (relógio de parede em µs)
+    uint64_t firstCounter();
+
+    /// Cópia da mensagem com o contador e o HMAC acrescentados ao texto (sem chave, só o contador)
+    Message sign(const Message&, const std::string&, uint64_t);
+
+    /// Confere e remove o HMAC e o contador do texto (sem chave, só o contador)
+    bool verify(Message&, const std::string&, uint64_t&);
+
+    /// Mesmo IP e porta
+    bool sameAddress(const sockaddr_in&, const sockaddr_in&);
+}
+
+/**
+ * @brief Lado primário da replicação.
+ *
+ * Recebe as mudanças da tabela de sessões do servidor, envia-as em lotes ao
+ *     standby por um socket próprio e mede o atraso da replicação a partir das
+ *     confirmações recebidas.
+ */
+class ReplicationPrimary
+{
+public:
+    /// Gera o estado completo do servidor (clientes e contador de IDs)
+    using SnapshotCallback = std::function<void(std::unordered_map<int, ClientInfo>&, int&)>;
+
+    /**
+     * @brief Construtor da classe ReplicationPrimary.
+     *
+     * O log sai pelo socket do servidor, do endereço que o standby assume e
+     *     de onde espera o log; as confirmações chegam pela recepção do
+     *     servidor (`handleAck`).
+     *
+     * @param sockfd Socket do servidor
+     * @param replica Endereço de replicação do standby (único aceito nas confirmações)
+     * @param key Chave compartilhada do HMAC (vazia = sem HMAC)
+     */
+    ReplicationPrimary(int, const sockaddr_in&, const std::string&);
+
+    /// Destrutor
+    ~ReplicationPrimary();
+
+    /**
+     * @brief Inicia a thread de envio do log e de heartbeats.
+     *
+     * @param snapshot Gera o estado completo quando o standby pede um snapshot
+     */
+    void start(SnapshotCallback);
+
+    /**
+     * @brief Trata uma confirmação recebida pelo socket do servidor.
+     *
+     * Chamado pela thread de recepção. Um pedido de snapshot é atendido
+     *     pela thread de replicação.
+     *
+     * @param from Remetente
+     * @param ack Mensagem `REPL_ACK`
+     *
+     * @retval `true` Se a confirmação veio do standby e é nova
+     * @retval `false` Se foi descartada
+     */
+    bool handleAck(const sockaddr_in&, Message&);
+
+    /**
+     * @brief Registra a adição (ou atualização) de um cliente.
+     *
+     * @param clientID ID do cliente
+     * @param client Dados do cliente
+     * @param idCount Contador de IDs após a adição
+     */
+    void logAdd(int, const ClientInfo&, int);
+
+    /**
+     * @brief Registra a remoção de um cliente.
+     */
+    void logDelete(int);
+
+    /**
+     * @brief Entradas ainda não confirmadas pelo standby.
+     */
+    uint32_t lagEntries();
+
+    /**
+     * @brief Idade, em milissegundos, da entrada mais antiga não confirmada.
+     */
+    long lagMilliseconds();
+
+private:
+    int _sockfd;                                  /** Socket do servidor */
+    sockaddr_in _replica;                         /** Endereço do standby */
+    std::string _key;                             /** Chave compartilhada do HMAC */
+    int _incarnation;                             /** Identifica esta execução do primário */
+    std::atomic<bool> _running;                   /** Flag da thread de replicação */
+    std::atomic<bool> _snapshotRequested;         /** O standby pediu o estado completo */
+    uint64_t _counter;                            /** Último contador enviado (só a thread de replicação) */
+    uint64_t _ackCounter;                         /** Contador da última confirmação aceita */
+    uint32_t _lsn;                                /** Último LSN gerado */
+    uint32_t _ackedLSN;                           /** Último LSN confirmado pelo standby */
+    std::string _batch;                           /** Entradas ainda não enviadas */
+    std::deque<std::pair<uint32_t, std::chrono::steady_clock::time_point>> _pending; /** LSNs não confirmados */
+    std::mutex _mutex;                            /** Protege o log e os contadores */
+    std::thread _thread;                          /** Thread de replicação */
+    SnapshotCallback _snapshot;                   /** Gera o estado completo */
+
+    /**
+     * @brief Laço de envio de lotes, heartbeats e snapshots.
+     */
+    void run();
+
+    /**
+     * @brief Assina e envia um lote ao standby (só a thread de replicação).
+     */
+    void send(const Message&);
+
+    /**
+     * @brief Acrescenta uma entrada ao lote pendente.
+     */
+    void append(const Message&);
+
+    /**
+     * @brief Envia o lote pendente (ou um heartbeat, se vazio).
+     */
+    void flush(bool);
+
+    /**
+     * @brief Envia o estado completo ao standby.
+     */
+    void sendSnapshot();
+};
+
+/**
+ * @brief Lado standby da replicação.
+ *
+ * Aplica o log recebido do primário a uma cópia da tabela de sessões e
+ *     detecta a falha do primário pela ausência de heartbeats.
+ */
+class ReplicationStandby : private DatagramFilter
+{
+public:
+    /**
+     * @brief Construtor da classe ReplicationStandby.
+     *
+     * @param listen Endereço onde o standby recebe o log
+     * @param primary Endereço do primário (que o standby assume); o log só é
+     *     aceito vindo dele (só da porta, se o IP for `0.0.0.0`)
+     * @param key Chave compartilhada do HMAC (vazia = sem HMAC)
+     */
+    ReplicationStandby(const sockaddr_in&, const sockaddr_in&, const std::string&);
+
+    /// Destrutor
+    ~ReplicationStandby();
+
+    /**
+     * @brief Recebe e aplica o log até o primário parar de responder.
+     *
+     * Só retorna depois de ter recebido algo do primário e ficar
+     *     `REPLICATION_TIMEOUT_MS` sem notícias dele.
+     */
+    void waitForFailover();
+
+    /*
+    * Getters
+    */
+
+    const std::unordered_map<int, ClientInfo>& getClients() const { return _clients; }
+    int getIdCount() const { return _idCount; }
+    uint32_t getAppliedLSN() const { return _appliedLSN; }
+    std::chrono::steady_clock::time_point getLastHeard() const { return _lastHeard; }
+
+private:
+    int _sockfd;                                  /** Socket de replicação */
+    sockaddr_in _primary;                         /** Endereço do primário */
+    std::string _key;                             /** Chave compartilhada do HMAC */
+    std::unordered_map<int, ClientInfo> _clients; /** Cópia da tabela de sessões */
+    int _idCount;                                 /** Cópia do contador de IDs */
+    uint32_t _appliedLSN;                         /** Último LSN aplicado */
+    int _incarnation;                             /** Execução do primário de onde vem o log */
+    uint64_t _counter;                            /** Último contador enviado */
+    uint64_t _primaryCounter;                     /** Contador do último lote aceito */
+    bool _inSnapshot;                             /** Recebendo um snapshot */
+    size_t _snapshotEntries;                      /** Entradas recebidas do snapshot atual */
+    std::chrono::steady_clock::time_point _lastHeard; /** Último datagrama do primário */
+    Reassembler _reassembler;                     /** Remontagem de lotes fragmentados */
+
+    /**
+     * @brief Aplica um lote recebido.
+     *
+     * @retval `true` Se o lote foi aplicado sem lacunas
+     * @retval `false` Se faltam entradas e é preciso um snapshot
+     */
+    bool apply(const Message&);
+
+    /**
+     * @brief Confirma o LSN aplicado (ou pede um snapshot).
+     */
+    void acknowledge(const sockaddr_in&, bool);
+
+    /**
+     * @brief Recusa, antes da remontagem, os datagramas que não vêm do endereço do primário.
+     */
+    size_t filter(const sockaddr_in&, char*, size_t) override;
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "scheduler.h"
+#include <algorithm>
+#include <sstream>
+
+// Atendimentos por rodada de cada classe, na ordem de `TrafficClass`
+static const int WEIGHTS[TRAFFIC_CLASSES] = {8, 4, 2, 1};
+
+Scheduler::~Scheduler()
+{
+    stop();
+}
+
+void Scheduler::stop()
+{
+    _running = false;
+    _ready.notify_all();
+
+    for (auto &worker : _workers)
+    {
+        if (worker.joinable())
+            worker.join();
+    }
+
+    _workers.clear();
+}
+
+void Scheduler::start(Handler handler, int workers)
+{
+    _handler = std::move(handler);
+    _running = true;
+
+    resize(workers);
+}
+
+void Scheduler::resize(int workers)
+{
+    size_t target = static_cast<size_t>(std::max(workers, 1));
+    _workerTarget = target;
+
+    // As threads excedentes saem na próxima volta do laço
+    if (target < _workers.size())
+    {
+        _ready.notify_all();
+
+        for (size_t i = target; i < _workers.size(); i++)
+            _workers[i].join();
+
+        _workers.resize(target);
+    }
+
+    while (_workers.size() < target)
+        _workers.emplace_back(&Scheduler::run, this, _workers.size());
+}
+
+bool Scheduler::push(TrafficClass trafficClass, const Message &message, const sockaddr_in &address, bool relayed)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (_queues[trafficClass].size() >= _queueLimit)
+            return false;
+
+        _queues[trafficClass].push_back({trafficClass, message, address, std::chrono::steady_clock::now(), relayed});
+    }
+
+    _ready.notify_one();
+    return true;
+}
+
+void Scheduler::requestStatus()
+{
+    _statusRequestedAt = std::chrono::steady_clock::now().time_since_epoch().count();
+    _statusRequested = true;
+}
+
+int Scheduler::pick()
+{
+    for (int round = 0; round < 2; round++)
+    {
+        for (int i = 0; i < TRAFFIC_CLASSES; i++)
+        {
+            if (!_queues[i].empty() && _credits[i] > 0)
+            {
+                _credits[i]--;
+                return i;
+            }
+        }
+
+        // Rodada esgotada (ou primeira): renova os créditos
+        for (int i = 0; i < TRAFFIC_CLASSES; i++)
+            _credits[i] = WEIGHTS[i];
+    }
+
+    return -1;
+}
+
+void Scheduler::run(size_t index)
+{
+    while (_running && index < _workerTarget)
+    {
+        // O pedido de status entra na fila de menor prioridade
+        if (_statusRequested.exchange(false))
+        {
+            Job status = {STATUS, Message(), {}, std::chrono::steady_clock::time_point(
+                              std::chrono::steady_clock::duration(_statusRequestedAt.load())), false};
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queues[STATUS].push_back(std::move(status));
+        }
+
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            int next = pick();
+
+            if (next < 0)
+            {
+                _ready.wait_for(lock, std::chrono::milliseconds(SCHEDULER_IDLE_MS));
+                continue;
+            }
+
+            job = std::move(_queues[next].front());
+            _queues[next].pop_front();
+        }
+
+        _handler(job);
+        _histograms[job.trafficClass].record(std::chrono::steady_clock::now() - job.enqueued);
+    }
+}
+
+std::string Scheduler::latencySummary() const
+{
+    static const char *NAMES[TRAFFIC_CLASSES] = {"controle", "privada", "broadcast", "status"};
+    std::ostringstream summary;
+
+    summary << "Latência p50/p99 (µs):";
+    for (int i = 0; i < TRAFFIC_CLASSES; i++)
+    {
+        summary << (i ? ", " : " ") << NAMES[i] << " "
+                << _histograms[i].percentile(0.5) << "/" << _histograms[i].percentile(0.99);
+    }
+
+    return summary.str();
+}
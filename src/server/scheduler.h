@@ -0,0 +1,201 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "../include/message.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define SCHEDULER_WORKERS 4             /** Threads de processamento (padrão) */
+#define SCHEDULER_QUEUE_LIMIT 65536     /** Tamanho máximo de cada fila (padrão) */
+#define SCHEDULER_IDLE_MS 50            /** Espera máxima de uma thread ociosa */
+#define LATENCY_BUCKETS 24              /** Faixas do histograma (potências de 2 em µs) */
+
+/**
+ * @brief Classes de tráfego, em ordem de prioridade.
+ */
+enum TrafficClass
+{
+    CONTROL = 0,    /** OI, TCHAU e LIST */
+    DIRECT = 1,     /** Mensagens privadas */
+    BROADCAST = 2,  /** Mensagens para todos */
+    STATUS = 3,     /** Status periódico do servidor */
+    TRAFFIC_CLASSES = 4
+};
+
+/**
+ * @brief Histograma de latência com faixas em potências de 2.
+ *
+ * A faixa `i` conta as amostras com menos de `2^i` microssegundos. Atualizado
+ *     sem lock por várias threads.
+ */
+struct LatencyHistogram {
+    std::atomic<unsigned long> counts[LATENCY_BUCKETS] = {}; /** Amostras por faixa */
+
+    /**
+     * @brief Registra uma amostra.
+     */
+    void record(std::chrono::steady_clock::duration elapsed)
+    {
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        int bucket = 0;
+
+        while (bucket < LATENCY_BUCKETS - 1 && micros >= (1L << bucket))
+            bucket++;
+
+        counts[bucket]++;
+    }
+
+    /**
+     * @brief Limite superior, em microssegundos, do percentil pedido.
+     *
+     * @param fraction Percentil entre 0 e 1
+     *
+     * @return long Limite da faixa que contém o percentil, ou 0 sem amostras
+     */
+    long percentile(double fraction) const
+    {
+        unsigned long total = 0;
+        for (const auto &count : counts)
+            total += count;
+
+        if (total == 0)
+            return 0;
+
+        unsigned long seen = 0;
+        for (int i = 0; i < LATENCY_BUCKETS; i++)
+        {
+            seen += counts[i];
+            if (seen >= fraction * total)
+                return 1L << i;
+        }
+
+        return 1L << (LATENCY_BUCKETS - 1);
+    }
+};
+
+/**
+ * @brief Filas de prioridade do estágio de processamento do servidor.
+ *
+ * A thread de recepção só valida e classifica os datagramas; o trabalho
+ *     (registro, fan-out, listas, status) fica em uma fila por classe de
+ *     tráfego, consumida por um conjunto de threads que pode ser redimensionado
+ *     com o servidor rodando.
+ *
+ * O escalonamento é ponderado: a cada rodada, cada classe pode ser atendida
+ *     até o seu peso (8, 4, 2, 1) antes da próxima rodada, sempre começando
+ *     pela classe de maior prioridade. Assim o controle não espera atrás de
+ *     uma rajada de broadcasts e nenhuma classe fica sem atendimento.
+ */
+class Scheduler
+{
+public:
+    /**
+     * @brief Trabalho enfileirado.
+     */
+    struct Job {
+        TrafficClass trafficClass;                      /** Classe de tráfego */
+        Message message;                                /** Mensagem recebida */
+        sockaddr_in address;                            /** Endereço do remetente */
+        std::chrono::steady_clock::time_point enqueued; /** Momento da chegada */
+        bool relayed;                                   /** Repassada por outro nó do cluster */
+    };
+
+    /// Executa um trabalho
+    using Handler = std::function<void(Job&)>;
+
+    /// Destrutor
+    ~Scheduler();
+
+    /**
+     * @brief Inicia as threads de processamento.
+     *
+     * @param handler Executa os trabalhos
+     * @param workers Quantidade de threads
+     */
+    void start(Handler, int = SCHEDULER_WORKERS);
+
+    /**
+     * @brief Altera a quantidade de threads de processamento.
+     *
+     * As threads removidas terminam o trabalho em andamento antes de sair.
+     *     Chamado apenas pela thread que controla o servidor.
+     */
+    void resize(int);
+
+    /**
+     * @brief Altera o tamanho máximo de cada fila (trabalhos já enfileirados são mantidos).
+     */
+    void setQueueLimit(size_t limit) { _queueLimit = limit; }
+
+    /**
+     * @brief Para as threads de processamento (trabalhos pendentes são descartados).
+     */
+    void stop();
+
+    /**
+     * @brief Enfileira um trabalho.
+     *
+     * @param trafficClass Classe de tráfego
+     * @param message Mensagem
+     * @param address Endereço do remetente
+     * @param relayed Mensagem repassada por outro nó do cluster
+     *
+     * @retval `true` Se o trabalho foi aceito
+     * @retval `false` Se a fila da classe está cheia
+     */
+    bool push(TrafficClass, const Message&, const sockaddr_in&, bool = false);
+
+    /**
+     * @brief Pede o envio do status.
+     *
+     * Só altera variáveis atômicas, podendo ser chamado de um handler de sinal.
+     */
+    void requestStatus();
+
+    /**
+     * @brief Histograma de latência (chegada até o fim do processamento) de uma classe.
+     */
+    const LatencyHistogram& histogram(TrafficClass trafficClass) const { return _histograms[trafficClass]; }
+
+    /**
+     * @brief Resumo dos percentis de todas as classes, para o status.
+     */
+    std::string latencySummary() const;
+
+private:
+    std::deque<Job> _queues[TRAFFIC_CLASSES];            /** Fila de cada classe */
+    int _credits[TRAFFIC_CLASSES] = {};                  /** Atendimentos restantes na rodada */
+    LatencyHistogram _histograms[TRAFFIC_CLASSES];       /** Latência de cada classe */
+    std::mutex _mutex;                                   /** Protege as filas e os créditos */
+    std::condition_variable _ready;                      /** Sinaliza trabalho novo */
+    std::atomic<bool> _running{false};                   /** Flag das threads */
+    std::atomic<bool> _statusRequested{false};           /** Status pedido pelo timer */
+    std::atomic<long> _statusRequestedAt{0};             /** Momento do pedido (ns do relógio monotônico) */
+    std::atomic<size_t> _queueLimit{SCHEDULER_QUEUE_LIMIT};  /** Tamanho máximo de cada fila */
+    std::atomic<size_t> _workerTarget{0};                /** Threads com índice menor continuam rodando */
+    std::vector<std::thread> _workers;                   /** Threads de processamento */
+    Handler _handler;                                    /** Executa os trabalhos */
+
+    /**
+     * @brief Laço de uma thread de processamento.
+     *
+     * @param index Posição da thread em `_workers`
+     */
+    void run(size_t);
+
+    /**
+     * @brief Escolhe a próxima classe a atender (com o mutex travado).
+     *
+     * @return int Classe escolhida, ou -1 se todas as filas estão vazias
+     */
+    int pick();
+};
+
+#endif
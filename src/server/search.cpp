@@ -0,0 +1,409 @@
+#include "search.h"
+#include <cctype>
+#include <algorithm>
+
+// Acrescenta um inteiro sem sinal em varint (7 bits por byte)
+static void writeVarint(std::string &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+
+    out.push_back(static_cast<char>(value));
+}
+
+// Lê um varint a partir de `offset`, avançando-o
+static uint64_t readVarint(const std::string &in, size_t &offset)
+{
+    uint64_t value = 0;
+    int shift = 0;
+
+    while (offset < in.size())
+    {
+        uint8_t byte = static_cast<uint8_t>(in[offset++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80))
+            break;
+
+        shift += 7;
+    }
+
+    return value;
+}
+
+void SearchIndex::PostingList::append(uint64_t doc)
+{
+    if (count % SEARCH_SKIP_INTERVAL == 0)
+        skips.push_back({doc, static_cast<uint32_t>(deltas.size())});
+
+    writeVarint(deltas, doc - last);
+    last = doc;
+    count++;
+}
+
+SearchIndex::Cursor::Cursor(const PostingList &list, uint64_t floor)
+    : list(&list), floor(floor), block(0), position(0)
+{
+    if (!list.skips.empty())
+        load(list.skips.size() - 1);
+}
+
+void SearchIndex::Cursor::load(size_t index)
+{
+    const std::vector<Skip> &skips = list->skips;
+    size_t offset = skips[index].offset;
+    size_t end = index + 1 < skips.size() ? skips[index + 1].offset : list->deltas.size();
+
+    // O primeiro varint do bloco é a diferença para o bloco anterior
+    readVarint(list->deltas, offset);
+    uint64_t doc = skips[index].first;
+
+    block = index;
+    docs.clear();
+
+    // As ocorrências que já saíram da fila são o início da lista
+
+    while (true)
+    {
+        if (doc >= floor)
+            docs.push_back(doc);
+
+        if (offset >= end)
+            break;
+
+        doc += readVarint(list->deltas, offset);
+    }
+
+    position = docs.size();
+}
+
+void SearchIndex::Cursor::advance()
+{
+    if (position == 0 || --position > 0)
+        return;
+
+    // Início do bloco: passa ao anterior, a menos que este já começasse fora da fila
+    if (block > 0 && docs.front() == list->skips[block].first)
+        load(block - 1);
+}
+
+void SearchIndex::Cursor::seek(uint64_t target)
+{
+    if (peek() <= target)
+        return;
+
+    // Todo o bloco é mais novo: salta para o último bloco que começa até `target`
+    if (docs.front() > target)
+    {
+        const std::vector<Skip> &skips = list->skips;
+        auto after = std::upper_bound(skips.begin(), skips.begin() + block, target,
+                                      [](uint64_t doc, const Skip &skip) { return doc < skip.first; });
+
+        // Os blocos anteriores só têm ocorrências que já saíram da fila
+        if (after == skips.begin() || docs.front() != skips[block].first)
+        {
+            position = 0;
+            return;
+        }
+
+        load(static_cast<size_t>(after - skips.begin()) - 1);
+    }
+
+    while (position > 0 && docs[position - 1] > target)
+        position--;
+}
+
+uint64_t SearchIndex::Term::peek() const
+{
+    uint64_t newest = 0;
+
+    for (const auto &cursor : cursors)
+        newest = std::max(newest, cursor.peek());
+
+    return newest;
+}
+
+void SearchIndex::Term::advance()
+{
+    uint64_t current = peek();
+
+    for (auto &cursor : cursors)
+    {
+        if (cursor.peek() == current)
+            cursor.advance();
+    }
+}
+
+void SearchIndex::Term::seek(uint64_t target)
+{
+    for (auto &cursor : cursors)
+        cursor.seek(target);
+}
+
+SearchIndex::SearchIndex(size_t capacity) : _capacity(std::max<size_t>(capacity, 1)), _nextDoc(1)
+{
+}
+
+uint64_t SearchIndex::oldest() const
+{
+    return _tweets.empty() ? _nextDoc : _tweets.front().doc;
+}
+
+void SearchIndex::tokenize(std::string_view text, std::vector<std::string> &terms)
+{
+    std::string term;
+
+    for (size_t i = 0; i <= text.size(); i++)
+    {
+        unsigned char c = i < text.size() ? static_cast<unsigned char>(text[i]) : ' ';
+
+        // Bytes acima de 0x7F (UTF-8) fazem parte das palavras
+        if (isalnum(c) || c >= 0x80)
+        {
+            if (term.size() < SEARCH_MAX_TERM_SIZE)
+                term.push_back(static_cast<char>(tolower(c)));
+        }
+        else if (!term.empty())
+        {
+            terms.push_back(std::move(term));
+            term.clear();
+        }
+    }
+
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+}
+
+uint64_t SearchIndex::add(const Message &message)
+{
+    std::vector<std::string> terms;
+    tokenize(message.getTextView(), terms);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_tweets.size() >= _capacity)
+        evictOldest();
+
+    uint64_t doc = _nextDoc++;
+    _tweets.emplace_back();
+    Tweet &tweet = _tweets.back();
+
+    tweet.doc = doc;
+    tweet.origin = message.getOriginID();
+    std::string_view username = message.getUsernameView();
+    memcpy(tweet.username, username.data(), username.size());
+    tweet.username[username.size()] = '\0';
+    tweet.text.assign(message.getTextView());
+
+    for (const auto &term : terms)
+        _terms[term].append(doc);
+
+    return doc;
+}
+
+void SearchIndex::evictOldest()
+{
+    Tweet &tweet = _tweets.front();
+    std::vector<std::string> terms;
+    tokenize(tweet.text, terms);
+
+    for (const auto &term : terms)
+    {
+        auto found = _terms.find(term);
+        if (found == _terms.end())
+            continue;
+
+        PostingList &list = found->second;
+
+        if (++list.stale >= list.count)
+        {
+            _terms.erase(found);
+        }
+        else if (list.stale * 2 > list.count)
+        {
+            // Os tweets saem em ordem: as ocorrências obsoletas são o início da lista
+            std::vector<uint64_t> docs;
+            decode(list, docs);
+
+            PostingList trimmed;
+            for (uint64_t live : docs)
+            {
+                if (live != tweet.doc)
+                    trimmed.append(live);
+            }
+
+            list = std::move(trimmed);
+        }
+    }
+
+    _tweets.pop_front();
+}
+
+void SearchIndex::decode(const PostingList &list, std::vector<uint64_t> &docs) const
+{
+    uint64_t first = oldest();
+    uint64_t doc = 0;
+    size_t offset = 0;
+
+    docs.reserve(docs.size() + list.count - list.stale);
+
+    while (offset < list.deltas.size())
+    {
+        doc += readVarint(list.deltas, offset);
+
+        if (doc >= first)
+            docs.push_back(doc);
+    }
+}
+
+size_t SearchIndex::search(std::string_view query, int page, std::vector<Hit> &hits, bool &more)
+{
+    more = false;
+
+    // Cada palavra da consulta vira termos; `*` no fim torna o último um prefixo
+    std::vector<std::pair<std::string, bool>> terms;
+    size_t start = 0;
+
+    while (start < query.size() && terms.size() < SEARCH_MAX_TERMS)
+    {
+        size_t end = query.find(' ', start);
+        std::string_view word = query.substr(start, end == std::string_view::npos ? end : end - start);
+        start = end == std::string_view::npos ? query.size() : end + 1;
+
+        bool prefix = !word.empty() && word.back() == '*';
+        std::vector<std::string> tokens;
+        tokenize(prefix ? word.substr(0, word.size() - 1) : word, tokens);
+
+        for (auto &token : tokens)
+            terms.emplace_back(std::move(token), prefix);
+    }
+
+    if (terms.empty())
+        return 0;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint64_t floor = oldest();
+    std::vector<Term> cursors(terms.size());
+
+    for (size_t i = 0; i < terms.size(); i++)
+    {
+        Term &term = cursors[i];
+
+        if (terms[i].second)
+        {
+            const std::string &prefix = terms[i].first;
+
+            for (auto it = _terms.lower_bound(prefix);
+                 it != _terms.end() && it->first.compare(0, prefix.size(), prefix) == 0 &&
+                 term.cursors.size() < SEARCH_MAX_EXPANSIONS; ++it)
+            {
+                term.cursors.emplace_back(it->second, floor);
+                term.estimate += it->second.count - it->second.stale;
+            }
+        }
+        else
+        {
+            auto found = _terms.find(terms[i].first);
+            if (found != _terms.end())
+            {
+                term.cursors.emplace_back(found->second, floor);
+                term.estimate = found->second.count - found->second.stale;
+            }
+        }
+
+        if (term.cursors.empty())
+            return 0;
+    }
+
+    // O termo com menos ocorrências guia; os outros só confirmam, saltando blocos
+    std::sort(cursors.begin(), cursors.end(),
+              [](const Term &a, const Term &b) { return a.estimate < b.estimate; });
+
+    size_t skip = static_cast<size_t>(std::max(page, 0)) * SEARCH_PAGE_SIZE;
+    size_t found = 0;
+    uint64_t doc = cursors[0].peek();
+
+    while (doc != 0)
+    {
+        size_t i = 1;
+
+        for (; i < cursors.size(); i++)
+        {
+            cursors[i].seek(doc);
+            uint64_t other = cursors[i].peek();
+
+            if (other != doc)
+            {
+                doc = other;
+                break;
+            }
+        }
+
+        if (i < cursors.size())
+        {
+            // Outro termo não tem o tweet: o guia salta para o mais novo que ele tem
+            if (doc == 0)
+                break;
+
+            cursors[0].seek(doc);
+            doc = cursors[0].peek();
+            continue;
+        }
+
+        // Um resultado além da página basta para saber que há mais
+        if (found == skip + SEARCH_PAGE_SIZE)
+        {
+            more = true;
+            break;
+        }
+
+        if (found++ >= skip)
+        {
+            const Tweet &tweet = at(doc);
+            hits.push_back({tweet.doc, tweet.origin, tweet.username, tweet.text});
+        }
+
+        cursors[0].advance();
+        doc = cursors[0].peek();
+    }
+
+    return found;
+}
+
+uint64_t SearchIndex::since(uint64_t after, size_t limit, std::vector<Hit> &hits)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    uint64_t newest = _nextDoc - 1;
+    uint64_t first = std::max(after + 1, oldest());
+
+    if (newest >= first && newest - first >= limit)
+        first = newest - limit + 1;
+
+    for (uint64_t doc = first; doc <= newest; doc++)
+    {
+        const Tweet &tweet = at(doc);
+        hits.push_back({tweet.doc, tweet.origin, tweet.username, tweet.text});
+    }
+
+    return newest;
+}
+
+void SearchIndex::setCapacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _capacity = std::max<size_t>(capacity, 1);
+
+    while (_tweets.size() > _capacity)
+        evictOldest();
+}
+
+size_t SearchIndex::termCount()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _terms.size();
+}
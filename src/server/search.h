@@ -0,0 +1,217 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "../include/message.h"
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define SEARCH_HISTORY 262144       /** Tweets mais recentes mantidos para busca (padrão de `search_history`) */
+#define SEARCH_PAGE_SIZE 10         /** Resultados por página */
+#define SEARCH_MAX_TERMS 8          /** Termos considerados em uma consulta */
+#define SEARCH_MAX_TERM_SIZE 32     /** Bytes de um termo (o resto é ignorado) */
+#define SEARCH_MAX_EXPANSIONS 256   /** Termos que um prefixo pode abranger */
+#define SEARCH_SKIP_INTERVAL 64     /** Ocorrências por bloco entre ponteiros de salto */
+
+/**
+ * @brief Índice invertido dos tweets públicos recentes.
+ *
+ * Guarda os últimos `capacity` broadcasts em uma fila e, para cada termo, a
+ *     lista dos tweets que o contêm. A fila cresce conforme os tweets chegam
+ *     (cerca de 230 bytes por tweet retido, com o texto) e, cheia, descarta o
+ *     mais antigo a cada tweet novo. Cada tweet recebe um número
+ *     crescente e as listas guardam as diferenças entre números consecutivos
+ *     como varints, em geral 1 ou 2 bytes por ocorrência. A cada
+ *     `SEARCH_SKIP_INTERVAL` ocorrências, um ponteiro de salto guarda o número
+ *     e a posição do início do bloco, para que a busca decodifique só os
+ *     blocos de que precisa.
+ *
+ * Quando um tweet sai da fila, os termos dele são marcados como obsoletos;
+ *     uma lista é reescrita quando mais da metade dela está obsoleta e apagada
+ *     quando fica vazia.
+ *
+ * O número de cada tweet também serve de posição na linha do tempo: os
+ *     clientes pedem apenas o que é mais novo que o último número recebido.
+ *
+ * Consultas são termos separados por espaço, todos obrigatórios; um termo
+ *     terminado em `*` é um prefixo. Os termos são as sequências de letras e
+ *     dígitos, com ASCII em minúsculas. A interseção percorre as listas do
+ *     mais novo para o mais antigo, guiada pelo termo com menos ocorrências,
+ *     saltando blocos nas demais, e para assim que completa a página pedida.
+ */
+class SearchIndex
+{
+public:
+    /**
+     * @brief Resultado de uma busca.
+     */
+    struct Hit {
+        uint64_t doc;           /** Número do tweet na linha do tempo deste servidor */
+        int origin;             /** ID do autor */
+        std::string username;   /** Nome do autor */
+        std::string text;       /** Texto do tweet */
+    };
+
+    /**
+     * @brief Construtor da classe SearchIndex.
+     *
+     * @param capacity Quantidade de tweets mantidos
+     */
+    SearchIndex(size_t = SEARCH_HISTORY);
+
+    /**
+     * @brief Indexa um tweet público.
+     *
+     * @return uint64_t Número atribuído ao tweet (crescente, a partir de 1)
+     */
+    uint64_t add(const Message&);
+
+    /**
+     * @brief Busca os tweets que contêm todos os termos, do mais novo ao mais antigo.
+     *
+     * @param query Consulta
+     * @param page Página (a partir de 0)
+     * @param hits Recebe os resultados da página
+     * @param more Recebe `true` se há resultados depois da página
+     *
+     * @return size_t Resultados até o fim da página (o total, se `more` for `false`)
+     */
+    size_t search(std::string_view, int, std::vector<Hit>&, bool&);
+
+    /**
+     * @brief Obtém os tweets mais novos que um número, do mais antigo ao mais novo.
+     *
+     * @param after Último número já conhecido (0 = nenhum)
+     * @param limit Quantidade máxima de tweets (os mais novos)
+     * @param hits Recebe os tweets
+     *
+     * @return uint64_t Número do tweet mais novo no buffer (0 se vazio)
+     */
+    uint64_t since(uint64_t, size_t, std::vector<Hit>&);
+
+    /**
+     * @brief Altera a quantidade de tweets mantidos.
+     *
+     * Ao diminuir, os tweets mais antigos que não cabem saem do índice.
+     */
+    void setCapacity(size_t);
+
+    /**
+     * @brief Quantidade de termos distintos no índice.
+     */
+    size_t termCount();
+
+private:
+    /**
+     * @brief Tweet retido no buffer circular.
+     */
+    struct Tweet {
+        uint64_t doc = 0;                               /** Número do tweet */
+        int origin = 0;                                 /** ID do autor */
+        char username[MAX_USERNAME_SIZE + 1] = {};      /** Nome do autor */
+        std::string text;                               /** Texto do tweet */
+    };
+
+    /**
+     * @brief Ponteiro de salto para o início de um bloco de uma lista.
+     */
+    struct Skip {
+        uint64_t first;         /** Número do primeiro tweet do bloco */
+        uint32_t offset;        /** Posição do bloco em `deltas` */
+    };
+
+    /**
+     * @brief Lista de ocorrências de um termo.
+     */
+    struct PostingList {
+        std::string deltas;     /** Diferenças entre números de tweet, em varint */
+        std::vector<Skip> skips;  /** Início de cada bloco de `SEARCH_SKIP_INTERVAL` ocorrências */
+        uint64_t last = 0;      /** Último número acrescentado */
+        uint32_t count = 0;     /** Ocorrências na lista */
+        uint32_t stale = 0;     /** Ocorrências de tweets que já saíram da fila */
+
+        /// Acrescenta um número maior que `last`
+        void append(uint64_t);
+    };
+
+    /**
+     * @brief Percorre uma lista do mais novo para o mais antigo, um bloco por vez.
+     */
+    struct Cursor {
+        const PostingList *list;    /** Lista percorrida */
+        uint64_t floor;             /** Menor número ainda na fila */
+        size_t block;               /** Bloco carregado em `docs` */
+        std::vector<uint64_t> docs; /** Ocorrências do bloco, em ordem crescente */
+        size_t position;            /** `docs[position - 1]` é a ocorrência atual */
+
+        Cursor(const PostingList&, uint64_t);
+
+        /// Ocorrência atual (0 no fim da lista)
+        uint64_t peek() const { return position > 0 ? docs[position - 1] : 0; }
+
+        /// Passa para a ocorrência anterior
+        void advance();
+
+        /// Vai para a maior ocorrência que não passa de `target`, saltando blocos
+        void seek(uint64_t);
+
+        /// Decodifica um bloco e se posiciona na última ocorrência dele
+        void load(size_t);
+    };
+
+    /**
+     * @brief Termo da consulta: a união das listas que ele abrange.
+     */
+    struct Term {
+        std::vector<Cursor> cursors;    /** Uma lista por termo abrangido pelo prefixo */
+        size_t estimate = 0;            /** Ocorrências ainda na fila, para escolher o guia */
+
+        /// Maior ocorrência atual entre as listas (0 no fim de todas)
+        uint64_t peek() const;
+
+        /// Passa da ocorrência atual para a anterior em todas as listas
+        void advance();
+
+        /// Vai para a maior ocorrência que não passa de `target`
+        void seek(uint64_t);
+    };
+
+    std::deque<Tweet> _tweets;                    /** Tweets retidos, com números consecutivos */
+    size_t _capacity;                             /** Máximo de tweets retidos */
+    std::map<std::string, PostingList> _terms;    /** Termo -> ocorrências, em ordem para prefixos */
+    uint64_t _nextDoc;                            /** Próximo número de tweet */
+    std::mutex _mutex;                            /** Protege o índice */
+
+    /**
+     * @brief Menor número de tweet ainda na fila.
+     */
+    uint64_t oldest() const;
+
+    /**
+     * @brief Tweet retido com um número (entre `oldest()` e o mais novo).
+     */
+    const Tweet& at(uint64_t doc) const { return _tweets[doc - _tweets.front().doc]; }
+
+    /**
+     * @brief Retira do índice e da fila o tweet mais antigo.
+     */
+    void evictOldest();
+
+    /**
+     * @brief Decodifica as ocorrências ainda na fila, em ordem crescente.
+     */
+    void decode(const PostingList&, std::vector<uint64_t>&) const;
+
+    /**
+     * @brief Separa um texto em termos distintos.
+     *
+     * @param text Texto a ser separado
+     * @param terms Recebe os termos (sem repetições)
+     */
+    static void tokenize(std::string_view, std::vector<std::string>&);
+};
+
+#endif
@@ -1,27 +1,45 @@
 #include "server.h"
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 #include <thread>
 #include <unistd.h>
 #include <ctime>
 #include <iomanip>
 #include <sys/time.h>
+#include <cerrno>
+#include <system_error>
+#include <openssl/rand.h>
 
 // Instância da classe para ser acessda globalmente (para sinais)
 Server* _serverInstance = nullptr;
 
+// Desafio aleatório e não nulo de uma nova troca de chaves
+static uint64_t newChallenge()
+{
+    uint64_t challenge = 0;
+
+    while (challenge == 0 && RAND_bytes(reinterpret_cast<unsigned char*>(&challenge), sizeof(challenge)) == 1)
+        ;
+
+    return challenge;
+}
+
 // Método para o sinal
 void handleStatusBroadcast(int signal)
 {
     if (signal == SIGALRM)
     {
         if (_serverInstance != nullptr)
-            _serverInstance->sendServerStatus();
+            _serverInstance->requestServerStatus();
     }
 }
 
-Server::Server(const std::string& ip, int port) : _idCount(1), _running(false)
+Server::Server(const std::string& ip, int port) : _idCount(1), _running(false), _timerKick(false), _multicast(false),
+                                                      _requireEncryption(false)
 {
+    _incarnation = static_cast<int>(std::time(nullptr));
+
     if ((_sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
         error("Failed to create socket");
 
@@ -38,28 +56,210 @@ Server::Server(const std::string& ip, int port) : _idCount(1), _running(false)
 
     startTime = std::chrono::steady_clock::now();
 
+    _buffers = std::make_unique<SocketBuffers>(_sockfd, SOCKET_RECEIVE_BUFFER, SOCKET_SEND_BUFFER,
+                                               SOCKET_RECEIVE_LIMIT);
+    _lastStatus = startTime;
+    _lastDrops = 0;
+    _sender = 0;
+
+    _fanOut = std::make_unique<FanOut>(_sockfd);
+
     _file.open("log.txt");
 }
 
 Server::~Server()
 {
     _running = false;
+    _scheduler.stop();
+    _fanOut.reset();
+    _cluster.reset();
+    _replication.reset();
+    _sessionStore.reset();
     _file.close();
     close(_sockfd);
 }
 
+void Server::enableCluster(int nodeID, const std::vector<sockaddr_in> &seeds)
+{
+    if (nodeID < 0 || nodeID >= CLUSTER_MAX_NODES)
+        error("Invalid cluster node ID");
+
+    _cluster = std::make_unique<Cluster>(_sockfd, nodeID, seeds);
+}
+
+void Server::enableReplication(const sockaddr_in &replica, const std::string &key)
+{
+    _replication = std::make_unique<ReplicationPrimary>(_sockfd, replica, key);
+}
+
+void Server::enableMulticast(const sockaddr_in &group)
+{
+    unsigned char ttl = MULTICAST_TTL, loop = 1;
+
+    // Pela interface do IP do servidor (se fixo); o loop mantém a entrega a clientes no mesmo host
+    if (_serverAddr.sin_addr.s_addr != INADDR_ANY &&
+        setsockopt(_sockfd, IPPROTO_IP, IP_MULTICAST_IF, &_serverAddr.sin_addr, sizeof(_serverAddr.sin_addr)) < 0)
+        error("setsockopt(IP_MULTICAST_IF) failed");
+
+    if (setsockopt(_sockfd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0 ||
+        setsockopt(_sockfd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0)
+        error("setsockopt(IP_MULTICAST) failed");
+
+    _multicastGroup = group;
+    _multicast = true;
+}
+
+void Server::requireEncryption()
+{
+    _requireEncryption = true;
+}
+
+void Server::enablePersistence(const std::string &path)
+{
+    _sessionStore = std::make_unique<SessionStore>(path);
+
+    std::unordered_map<int, ClientInfo> clients;
+    int idCount = _idCount;
+
+    if (_sessionStore->load(clients, idCount))
+    {
+        restore(clients, idCount);
+        std::cout << "Sessões restauradas: " << clients.size() << std::endl;
+    }
+
+    if (size_t scheduled = _schedule.enablePersistence(path + ".schedule"))
+        std::cout << "Agendamentos restaurados: " << scheduled << std::endl;
+}
+
+bool Server::reconfigure(const ServerConfig &config, std::string &error)
+{
+    // Nada é aplicado antes de toda a configuração ser validada
+    if (!config.validate(error))
+        return false;
+
+    std::lock_guard<std::mutex> lock(_configMutex);
+
+    // Criar threads é a única troca que pode falhar: vem antes das outras e
+    //     volta ao número anterior se não for possível
+    if (_running)
+    {
+        try
+        {
+            _scheduler.resize(config.workers);
+        }
+        catch (const std::system_error &failure)
+        {
+            _scheduler.resize(_config.workers);
+            error = std::string("workers: ") + failure.what();
+            return false;
+        }
+    }
+
+    _buffers->configure(config.receiveBuffer, config.sendBuffer, config.receiveBufferLimit);
+    _fanOut->configure(config.fanOutThreads, config.fanOutBatch, config.fanOutThreshold, config.fanOutChunk);
+    _scheduler.setQueueLimit(static_cast<size_t>(config.queueLimit));
+    _search.setCapacity(static_cast<size_t>(config.searchHistory));
+
+    {
+        std::lock_guard<std::mutex> clients(_clientsMutex);
+        _ratePolicy = config.ratePolicy();
+    }
+
+    // Antes de `start()`, as threads e o timer são criados já com os valores novos
+    if (_running && config.statusInterval != _config.statusInterval)
+        setupTimer(config.statusInterval);
+
+    _config = config;
+    return true;
+}
+
+ServerConfig Server::configuration()
+{
+    std::lock_guard<std::mutex> lock(_configMutex);
+    return _config;
+}
+
+void Server::enableTracing(const std::string &path, double fraction)
+{
+    _tracer = std::make_unique<Tracer>(path, fraction);
+
+    if (!_tracer->isOpen())
+        error("Failed to open trace file");
+}
+
+void Server::flushTrace()
+{
+    if (_tracer)
+        _tracer->flush();
+}
+
+void Server::restore(const std::unordered_map<int, ClientInfo> &clients, int idCount)
+{
+    std::lock_guard<std::mutex> lock(_clientsMutex);
+
+    _sessions.clear();
+    _addressIndex.clear();
+    _idCount = idCount;
+
+    for (const auto &client : clients)
+    {
+        // Sem o segredo de retomada, ninguém pode provar que é o dono da sessão cifrada
+        if (client.second.encrypted && !client.second.resumable)
+            continue;
+
+        if (SessionTable::Session *session = _sessions.add(client.first, client.second.address,
+                                                           client.second.getUsername(), client.second.compression))
+        {
+            if (client.second.encrypted)
+            {
+                session->rekey = std::make_unique<SessionTable::Rekey>();
+                memcpy(session->rekey->resume, client.second.resume, SEAL_KEY_SIZE);
+                session->rekey->challenge = newChallenge();
+                session->rekey->asked = uptimeMs() - REKEY_INTERVAL_MS;
+                session->rekey->tries = 0;
+            }
+
+            _addressIndex[addressKey(client.second.address)] = client.first;
+            _presence.update(client.first, client.second.getUsername(), Message::PRESENCE_ONLINE, uptimeMs());
+        }
+    }
+}
+
 void Server::start()
 {
     _running = true;
 
     _serverInstance = this;
 
+    if (_cluster)
+    {
+        _cluster->start([this](const Message &msg) { enqueueRelayed(msg); },
+                        [this](int nodeID) { announceClients(nodeID); });
+    }
+
+    if (_replication)
+    {
+        _replication->start([this](std::unordered_map<int, ClientInfo> &clients, int &idCount) {
+            copySessions(clients, idCount);
+        });
+    }
+
+    if (_sessionStore)
+    {
+        _sessionStore->start([this](std::unordered_map<int, ClientInfo> &clients, int &idCount) {
+            copySessions(clients, idCount);
+        });
+    }
+
+    // Threads de processamento, alimentadas pelas filas de prioridade
+    _scheduler.start([this](Scheduler::Job &job) { process(job); }, _config.workers);
+
     // Thread para ouvir mensagens
     std::thread listener(&Server::listen, this);
     listener.detach();
 
     // Timer e Sinal para envio de status
-    setupTimer();
+    setupTimer(_config.statusInterval);
 
     std::cout << "Server ir running..." << std::endl;
 }
@@ -70,60 +270,336 @@ void Server::listen()
     {
         struct sockaddr_in clientAddr;
         memset(&clientAddr, 0, sizeof(clientAddr));
-        Message* msg = Message::receive(_sockfd, clientAddr, BUFFER_SIZE);
+        Message msg;
+        uint32_t overflow = 0;
 
-        if (msg)
+        int n = Message::receive(_sockfd, clientAddr, msg, BUFFER_SIZE, &_reassembler, &overflow, this);
+
+        if (n < 0)
         {
-            if ((msg->getType() == Message::OI))
-                addClient(clientAddr, msg);
+            int code = errno;
+
+            // Sinais (o timer de status) e falta momentânea de memória não
+            //     derrubam o servidor; só um socket inválido é fatal
+            if (code == EINTR)
+                continue;
 
-            if ((msg->getType() == Message::TCHAU))
-                deleteClient(clientAddr, msg);
+            if (!_running)
+                return;
 
-            if ((msg->getType() == Message::MSG))
+            if (code == EBADF || code == ENOTSOCK || code == EFAULT || code == EINVAL)
+                error(std::string("recvmsg error: ") + strerror(code));
+
+            if (_stats.receiveErrors++ % RECEIVE_ERROR_LOG_EVERY == 0)
+                std::cerr << "Erro de recepção ignorado: " << strerror(code) << std::endl;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(RECEIVE_ERROR_BACKOFF_MS));
+            continue;
+        }
+
+        if (overflow && _buffers->observe(overflow))
+            std::cout << "Descartes no kernel: buffer de recepção ampliado para "
+                      << _buffers->receiveSize() / 1024 << " KiB" << std::endl;
+
+        // Datagrama malformado, recusado pelo filtro ou fragmento de mensagem ainda incompleta
+        if (n == 0)
+            continue;
+
+        // Confirmações do standby, que chegam ao socket de onde sai o log
+        if (msg.getType() == Message::REPL_ACK)
+        {
+            if (!_replication || !_replication->handleAck(clientAddr, msg))
+                _stats.droppedDatagrams++;
+
+            continue;
+        }
+
+        // Tráfego entre nós do cluster, aceito apenas de nós conhecidos
+        if (Cluster::isClusterMessage(msg))
+        {
+            if (!_cluster || !_cluster->handle(clientAddr, msg))
+                _stats.droppedDatagrams++;
+
+            continue;
+        }
+
+        // Pedidos de clientes têm texto curto; um maior (fragmentado ou
+        //     comprimido) só serviria para multiplicar o fan-out
+        if (msg.getTextSize() > (msg.getType() == Message::SCHEDULE ? SCHEDULE_REQUEST_SIZE : MAX_TEXT_SIZE))
+        {
+            _stats.droppedDatagrams++;
+            continue;
+        }
+
+        if (msg.getType() == Message::OI)
+        {
+            enqueue(CONTROL, msg, clientAddr);
+            continue;
+        }
+
+        // O filtro já resolveu o remetente pelo endereço (ou pelo canal cifrado)
+        int clientID = _sender;
+
+        if (clientID == 0)
+        {
+            if (msg.getType() == Message::MSG)
             {
-                if (clientExists(msg->getOriginID()))
-                {
-                    Message* cpyMsg = new Message(*msg);
-                    std::thread clientThread(&Server::handleClient, this, cpyMsg);
-                    clientThread.detach();
-                }
-                else
+                Message error(Message::ERRO, 0, msg.getOriginID(), 
+                              msg.getUsernameView(), "Você não está registrado no sistema!");
+                error.send(_sockfd, clientAddr);
+            }
+
+            _stats.droppedDatagrams++;
+            continue;
+        }
+
+        if (clientID != msg.getOriginID())
+        {
+            _stats.droppedDatagrams++;
+            continue;
+        }
+
+        // Deduplicação e limite de taxa antes de qualquer fan-out, sob um só lock
+        RateLimit::Verdict verdict = RateLimit::ALLOW;
+        Screening screening = screen(clientID, msg, verdict);
+
+        if (screening == UNKNOWN)
+        {
+            _stats.droppedDatagrams++;
+            continue;
+        }
+
+        if (screening == DUPLICATE)
+        {
+            _stats.duplicateMessages++;
+            continue;
+        }
+
+        if (screening == LIMITED)
+        {
+            penalize(verdict, msg, clientAddr);
+            continue;
+        }
+
+        // Mensagens amostradas levam a flag até os destinatários
+        if (_tracer && (msg.getType() == Message::MSG) &&
+            (msg.hasFlag(Message::TRACED) || _tracer->sample()))
+        {
+            msg.setFlag(Message::TRACED);
+            _tracer->record(TRACE_SERVER_RECEIVE, clientID, msg.getSequence());
+        }
+
+        if ((msg.getType() == Message::TCHAU) || (msg.getType() == Message::LIST) ||
+            (msg.getType() == Message::MULTICAST) || (msg.getType() == Message::PRESENCE))
+            enqueue(CONTROL, msg, clientAddr);
+
+        if ((msg.getType() == Message::SEARCH) || (msg.getType() == Message::HISTORY) ||
+            (msg.getType() == Message::SCHEDULE) || (msg.getType() == Message::UNSCHEDULE))
+            enqueue(DIRECT, msg, clientAddr);
+
+        if ((msg.getType() == Message::GROUP_CREATE) || (msg.getType() == Message::GROUP_JOIN) ||
+            (msg.getType() == Message::GROUP_LEAVE))
+            enqueue(CONTROL, msg, clientAddr);
+
+        if ((msg.getType() == Message::MSG))
+            enqueue(msg.getDestinationID() == 0 ? BROADCAST : DIRECT, msg, clientAddr);
+
+        if ((msg.getType() == Message::GROUP_MSG))
+            enqueue(BROADCAST, msg, clientAddr);
+    }
+}
+
+size_t Server::filter(const struct sockaddr_in &from, char *datagram, size_t size)
+{
+    _sender = 0;
+
+    if (SecureChannel::isSealed(datagram, size))
+    {
+        std::shared_ptr<SecureChannel> channel;
+        bool pending = false;
+
+        {
+            std::lock_guard<std::mutex> lock(_clientsMutex);
+            SessionTable::Session *session =
+                _sessions.find(static_cast<int>(SecureChannel::sessionOf(datagram, size)));
+
+            // A sessão do cabeçalho deve ser a do endereço de origem
+            if (session && addressKey(session->address) == addressKey(from))
+            {
+                channel = session->channel;
+                _sender = channel ? session->id : 0;
+                pending = session->rekey != nullptr;
+            }
+        }
+
+        // Abre fora do lock: cada canal tem o seu mutex
+        size_t opened = channel ? channel->open(datagram, size) : 0;
+
+        // Restaurada: o primeiro datagrama aberto com o canal novo encerra a troca;
+        //     enquanto isso, o que chega com a chave antiga renova o pedido
+        if (pending)
+        {
+            Message request;
+            bool ask = false;
+
+            {
+                std::lock_guard<std::mutex> lock(_clientsMutex);
+                SessionTable::Session *session =
+                    _sessions.find(static_cast<int>(SecureChannel::sessionOf(datagram, size)));
+
+                if (session && session->rekey && session->channel == channel)
                 {
-                    Message error(Message::ERRO, 0, msg->getOriginID(), 
-                                  msg->getUsername(), "Você não está registrado no sistema!");
-                    error.send(_sockfd, clientAddr);
+                    if (opened)
+                    {
+                        session->rekey.reset();
+                    }
+                    else if (uptimeMs() - session->rekey->asked >= REKEY_INTERVAL_MS)
+                    {
+                        session->rekey->asked = uptimeMs();
+                        request = rekeyRequest(*session);
+                        ask = true;
+                    }
                 }
             }
 
-            if ((msg->getType() == Message::LIST))
-                handleClientListRequest(clientAddr, msg);
+            if (ask)
+                request.send(_sockfd, from);
+        }
+
+        if (opened == 0)
+        {
+            _stats.authFailures++;
+            _sender = 0;
+        }
+
+        return opened;
+    }
 
-            delete msg;
+    // Em claro: o OI (troca de chaves), o cluster e as sessões não cifradas
+    if (size >= 4 && WireHeader::load(WireHeader::at(datagram)->type) == Message::OI)
+        return size;
+
+    {
+        std::lock_guard<std::mutex> lock(_clientsMutex);
+        const auto client = _addressIndex.find(addressKey(from));
+        const SessionTable::Session *session = client != _addressIndex.end() ? _sessions.find(client->second) : nullptr;
+
+        if (session && (session->channel || session->keyless()))
+        {
+            _stats.authFailures++;
+            return 0;
         }
-        else
+
+        if (session)
         {
-            error("recvfrom error");
+            _sender = session->id;
+            return size;
         }
     }
+
+    // Fragmentos em claro de endereços desconhecidos nem chegam à remontagem,
+    //     para que não desalojem as mensagens das sessões (um OI nunca é fragmentado)
+    if (size >= 4 && WireHeader::load(WireHeader::at(datagram)->type) == Message::FRAG &&
+        !(_cluster && _cluster->knows(from)))
+    {
+        _stats.droppedDatagrams++;
+        return 0;
+    }
+
+    return size;
 }
 
-void Server::setupTimer()
+void Server::respond(const Message &message, const struct sockaddr_in &clientAddr, bool compression)
+{
+    std::shared_ptr<SecureChannel> channel;
+
+    {
+        std::lock_guard<std::mutex> lock(_clientsMutex);
+        const auto client = _addressIndex.find(addressKey(clientAddr));
+
+        if (client != _addressIndex.end())
+        {
+            if (const SessionTable::Session *session = _sessions.find(client->second))
+                channel = session->channel;
+        }
+    }
+
+    message.send(_sockfd, clientAddr, compression, channel.get());
+}
+
+void Server::enqueue(TrafficClass trafficClass, const Message &msg, const struct sockaddr_in &clientAddr)
+{
+    if (!_scheduler.push(trafficClass, msg, clientAddr))
+        _stats.droppedDatagrams++;
+}
+
+void Server::enqueueRelayed(const Message &msg)
+{
+    if (!_scheduler.push(msg.getDestinationID() == 0 ? BROADCAST : DIRECT, msg, {}, true))
+        _stats.droppedDatagrams++;
+}
+
+void Server::process(Scheduler::Job &job)
+{
+    Message *msg = &job.message;
+
+    if (job.trafficClass == STATUS)
+        sendServerStatus();
+    else if (job.relayed)
+        deliverRelayed(*msg);
+    else if (msg->getType() == Message::OI)
+        addClient(job.address, msg);
+    else if (msg->getType() == Message::TCHAU)
+        deleteClient(job.address, msg);
+    else if (msg->getType() == Message::LIST)
+        handleClientListRequest(job.address, msg);
+    else if (msg->getType() == Message::SEARCH)
+        handleSearchRequest(job.address, msg);
+    else if (msg->getType() == Message::HISTORY)
+        handleHistoryRequest(job.address, msg);
+    else if (msg->getType() == Message::SCHEDULE)
+        handleScheduleRequest(job.address, msg);
+    else if (msg->getType() == Message::UNSCHEDULE)
+        handleUnscheduleRequest(job.address, msg);
+    else if ((msg->getType() == Message::GROUP_CREATE) || (msg->getType() == Message::GROUP_JOIN) ||
+             (msg->getType() == Message::GROUP_LEAVE))
+        handleGroupRequest(job.address, msg);
+    else if (msg->getType() == Message::GROUP_MSG)
+        groupMessage(job.address, msg);
+    else if (msg->getType() == Message::MULTICAST)
+        handleMulticastRequest(job.address, msg);
+    else if (msg->getType() == Message::PRESENCE)
+        handlePresenceRequest(job.address, msg);
+    else if (msg->getType() == Message::MSG)
+    {
+        if (_tracer && msg->hasFlag(Message::TRACED))
+            _tracer->record(TRACE_SERVER_DEQUEUE, msg->getOriginID(), msg->getSequence());
+
+        handleClient(msg);
+    }
+}
+
+void Server::requestServerStatus()
+{
+    _scheduler.requestStatus();
+}
+
+void Server::setupTimer(int interval)
 {
     struct sigaction sigHandler;
     struct itimerval timer;
 
     sigHandler.sa_handler = handleStatusBroadcast;
     sigemptyset(&sigHandler.sa_mask);
-    sigHandler.sa_flags = 0;
+    sigHandler.sa_flags = SA_RESTART;
 
     if (sigaction(SIGALRM, &sigHandler, NULL) == -1)
         error("Error: cant set signal handle");
     
 
-    timer.it_value.tv_sec = TIMER;
+    timer.it_value.tv_sec = interval;
     timer.it_value.tv_usec = 0;
-    timer.it_interval.tv_sec = TIMER;
+    timer.it_interval.tv_sec = interval;
     timer.it_interval.tv_usec = 0;
 
     if (setitimer(ITIMER_REAL, &timer, nullptr) == -1)
@@ -131,110 +607,894 @@ void Server::setupTimer()
 }
 
 
-void Server::handleClient(Message *message)
+void Server::handleClient(const Message *message)
 {
+    bool traced = _tracer && message->hasFlag(Message::TRACED);
+
     if (message->getDestinationID() == 0)
-        broadcastMessage(message);
+    {
+        // O número de sequência entregue é a posição na linha do tempo do servidor
+        Message stamped(*message);
+        stamped.setSequence(static_cast<int>(_search.add(*message)));
+
+        if (traced)
+            _tracer->record(TRACE_FANOUT_START, message->getOriginID(), message->getSequence(), stamped.getSequence());
+
+        broadcastMessage(&stamped);
+
+        if (traced)
+            _tracer->record(TRACE_FANOUT_END, message->getOriginID(), message->getSequence(), stamped.getSequence());
+
+        if (_cluster)
+            _cluster->relayBroadcast(*message);
+    }
     else
+    {
+        if (traced)
+            _tracer->record(TRACE_FANOUT_START, message->getOriginID(), message->getSequence(), message->getSequence());
+
         privateMessage(message);
 
-    delete message;
+        if (traced)
+            _tracer->record(TRACE_FANOUT_END, message->getOriginID(), message->getSequence(), message->getSequence());
+    }
 }
 
 void Server::handleClientListRequest(struct sockaddr_in clientAddr, Message *message)
 {
     std::string clientList;
+    bool compression = false;
+    SecureChannel *channel = nullptr;
 
     std::lock_guard<std::mutex> lock(_clientsMutex);
-    for (const auto &client : _clients)
+    _sessions.forEach([&](const SessionTable::Session &session) {
+        if (session.id != message->getOriginID())
+            clientList.append(std::to_string(session.id)).append(":")
+                      .append(_sessions.username(session)).append("\n");
+        else
+        {
+            compression = session.compression;
+            channel = session.channel.get();
+        }
+    });
+
+    if (_cluster)
+        _cluster->appendRemoteClients(clientList, message->getOriginID());
+
+    Message reply(Message::LIST, 0, message->getOriginID(), _serverID, clientList);
+    reply.send(_sockfd, clientAddr, compression, channel);
+}
+
+void Server::handleSearchRequest(struct sockaddr_in clientAddr, Message *message)
+{
+    std::vector<SearchIndex::Hit> hits;
+    int page = std::max(message->getDestinationID(), 0);
+    bool more = false;
+    size_t total = _search.search(message->getTextView(), page, hits, more);
+    size_t pages = (total + SEARCH_PAGE_SIZE - 1) / SEARCH_PAGE_SIZE;
+
+    // Primeira linha com o total (ou `N+` se a busca parou na página); depois
+    //     um tweet por linha `ID:usuario:texto`
+    std::string results = more ? "Resultados: " + std::to_string(total) + "+ | Página " +
+                                     std::to_string(page + 1) + "\n"
+                               : "Resultados: " + std::to_string(total) + " | Página " + std::to_string(page + 1) +
+                                     " de " + std::to_string(std::max<size_t>(pages, 1)) + "\n";
+
+    for (auto &hit : hits)
     {
-        if (client.first != message->getOriginID())
-            clientList += std::to_string(client.first) + ":" + 
-                          client.second.username + "\n";
+        std::replace(hit.text.begin(), hit.text.end(), '\n', ' ');
+        results += std::to_string(hit.origin) + ":" + hit.username + ":" + hit.text + "\n";
     }
 
-    Message reply(Message::LIST, 0, message->getOriginID(), _serverID, clientList);
-    reply.send(_sockfd, clientAddr);
+    bool compression = false;
+    std::shared_ptr<SecureChannel> channel;
+    {
+        std::lock_guard<std::mutex> lock(_clientsMutex);
+        if (const SessionTable::Session *session = _sessions.find(message->getOriginID()))
+        {
+            compression = session->compression;
+            channel = session->channel;
+        }
+    }
+
+    Message reply(Message::SEARCH, 0, message->getOriginID(), _serverID, results);
+    reply.setSequence(page);
+    reply.send(_sockfd, clientAddr, compression, channel.get());
 }
 
-void Server::broadcastMessage(Message *message)
+void Server::handleHistoryRequest(struct sockaddr_in clientAddr, Message *message)
 {
-    std::lock_guard<std::mutex> lock(_clientsMutex);
-    for (const auto &client : _clients)
+    std::vector<SearchIndex::Hit> hits;
+    uint64_t after = static_cast<uint32_t>(message->getSequence());
+    uint64_t newest = _search.since(after, HISTORY_LIMIT, hits);
+
+    // Os mais novos que couberem em uma mensagem, do mais antigo ao mais novo
+    size_t first = hits.size(), size = 0;
+    while (first > 0 && size + MESSAGE_HEADER_SIZE + hits[first - 1].text.size() <=
+                            MAX_MESSAGE_SIZE - MESSAGE_HEADER_SIZE)
     {
-        const sockaddr_in &addr = client.second.address;
-        Message msg;
-        memcpy(&msg, message, sizeof(Message));
-        msg.send(_sockfd, addr);
+        first--;
+        size += MESSAGE_HEADER_SIZE + hits[first].text.size();
+    }
+
+    std::string batch;
+    batch.reserve(size);
+
+    for (size_t i = first; i < hits.size(); i++)
+    {
+        Message tweet(Message::MSG, hits[i].origin, 0, hits[i].username, hits[i].text);
+        tweet.setSequence(static_cast<int>(hits[i].doc));
+
+        size_t offset = batch.size();
+        batch.resize(offset + tweet.encodedSize());
+        tweet.encode(&batch[offset]);
+    }
+
+    bool compression = false;
+    std::shared_ptr<SecureChannel> channel;
+    {
+        std::lock_guard<std::mutex> lock(_clientsMutex);
+        if (const SessionTable::Session *session = _sessions.find(message->getOriginID()))
+        {
+            compression = session->compression;
+            channel = session->channel;
+        }
+    }
+
+    // A origem identifica esta execução do servidor: a numeração recomeça a cada início
+    Message reply(Message::HISTORY, _incarnation, message->getOriginID(), _serverID, batch);
+    reply.setSequence(static_cast<int>(newest));
+    reply.send(_sockfd, clientAddr, compression, channel.get());
+}
+
+void Server::handleScheduleRequest(struct sockaddr_in clientAddr, Message *message)
+{
+    std::string_view request = message->getTextView();
+    size_t space = request.find(' ');
+    const char *problem = nullptr;
+
+    ScheduledTweet tweet;
+    tweet.origin = message->getOriginID();
+    tweet.destination = message->getDestinationID();
+    tweet.sequence = message->getSequence();
+    memcpy(tweet.username, message->getUsernameView().data(), message->getUsernameView().size());
+
+    // "<ms desde 1970> <texto>"
+    try
+    {
+        tweet.when = std::stoll(std::string(request.substr(0, space)));
+        tweet.text = space == std::string_view::npos ? "" : std::string(request.substr(space + 1));
+    }
+    catch (const std::exception&)
+    {
+        problem = "Pedido de agendamento inválido!";
+    }
+
+    if (!problem)
+    {
+        switch (_schedule.add(tweet))
+        {
+        case TweetSchedule::SCHEDULED:
+            break;
+        case TweetSchedule::FULL:
+            problem = "O servidor não aceita mais agendamentos no momento.";
+            break;
+        case TweetSchedule::CLIENT_LIMIT:
+            problem = "Você já tem o máximo de tweets agendados.";
+            break;
+        case TweetSchedule::PAST:
+            problem = "O horário do agendamento já passou!";
+            break;
+        case TweetSchedule::TOO_FAR:
+            problem = "O agendamento pode ser feito com até um ano de antecedência.";
+            break;
+        case TweetSchedule::INVALID:
+            problem = "O tweet agendado deve ter de 1 a 140 caracteres.";
+            break;
+        }
+    }
+
+    if (problem)
+    {
+        Message error(Message::ERRO, 0, message->getOriginID(), message->getUsernameView(), problem);
+        respond(error, clientAddr);
+        return;
+    }
+
+    wakeTimers();
+
+    Message reply(Message::SCHEDULE, 0, message->getOriginID(), _serverID,
+                  std::to_string(tweet.ticket) + " " + std::to_string(tweet.when));
+    reply.setSequence(message->getSequence());
+    respond(reply, clientAddr);
+}
+
+void Server::handleUnscheduleRequest(struct sockaddr_in clientAddr, Message *message)
+{
+    uint32_t ticket = static_cast<uint32_t>(strtoul(message->getText().c_str(), nullptr, 10));
+
+    if (ticket == 0 || !_schedule.cancel(ticket, message->getOriginID()))
+    {
+        Message error(Message::ERRO, 0, message->getOriginID(), message->getUsernameView(),
+                      "Agendamento não encontrado!");
+        respond(error, clientAddr);
+        return;
+    }
+
+    Message reply(Message::UNSCHEDULE, 0, message->getOriginID(), _serverID, std::to_string(ticket));
+    respond(reply, clientAddr);
+}
+
+void Server::runTimers(std::chrono::milliseconds period)
+{
+    auto end = std::chrono::steady_clock::now() + period;
+    std::vector<ScheduledTweet> due;
+
+    requestRekeys();
+
+    while (true)
+    {
+        due.clear();
+        _schedule.collect(TweetSchedule::now(), due);
+
+        for (const auto &tweet : due)
+            deliverScheduled(tweet);
+
+        int presence = _presence.wait(uptimeMs());
+        if (presence == 0)
+        {
+            publishPresence();
+            presence = _presence.wait(uptimeMs());
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= end)
+            return;
+
+        std::chrono::steady_clock::duration wait = end - now;
+        if (_schedule.pending() > 0)
+            wait = std::min<std::chrono::steady_clock::duration>(wait, std::chrono::milliseconds(TIMER_WHEEL_TICK_MS));
+        if (presence > 0)
+            wait = std::min<std::chrono::steady_clock::duration>(wait, std::chrono::milliseconds(presence));
+
+        std::unique_lock<std::mutex> lock(_timerMutex);
+        _timerWake.wait_for(lock, wait, [this]() { return _timerKick; });
+        _timerKick = false;
+    }
+}
+
+void Server::wakeTimers()
+{
+    // `runTimers` pode estar esperando o fim do período sem nada pendente
+    {
+        std::lock_guard<std::mutex> lock(_timerMutex);
+        _timerKick = true;
     }
+    _timerWake.notify_one();
+}
+
+void Server::deliverScheduled(const ScheduledTweet &tweet)
+{
+    Message msg(Message::MSG, tweet.origin, tweet.destination, tweet.username, tweet.text);
+    msg.setSequence(tweet.sequence);
+
+    struct sockaddr_in none;
+    memset(&none, 0, sizeof(none));
+
+    _stats.scheduledTweets++;
+    enqueue(tweet.destination == 0 ? BROADCAST : DIRECT, msg, none);
 }
 
-void Server::privateMessage(Message *message)
+void Server::handleGroupRequest(struct sockaddr_in clientAddr, Message *message)
+{
+    std::string_view name = message->getTextView();
+    int clientID = message->getOriginID();
+    int groupID = 0;
+    FanOut::Recipient recipient = {clientAddr, false};
+
+    {
+        std::lock_guard<std::mutex> lock(_clientsMutex);
+        const SessionTable::Session *session = _sessions.find(clientID);
+
+        if (!session)
+            return;
+
+        recipient.compression = session->compression;
+        recipient.channel = session->channel;
+    }
+
+    GroupTable::Result result;
+
+    if (message->getType() == Message::GROUP_CREATE)
+        result = _groups.create(name, clientID, recipient, groupID);
+    else if (message->getType() == Message::GROUP_JOIN)
+        result = _groups.join(name, clientID, recipient, groupID);
+    else
+        result = _groups.leave(name, clientID, groupID);
+
+    const char *problem = nullptr;
+
+    switch (result)
+    {
+    case GroupTable::OK:
+    case GroupTable::ALREADY_MEMBER:
+        break;
+    case GroupTable::EXISTS:
+        problem = "Já existe um grupo com esse nome!";
+        break;
+    case GroupTable::NOT_FOUND:
+        problem = "Grupo não encontrado!";
+        break;
+    case GroupTable::NOT_MEMBER:
+        problem = "Você não participa desse grupo!";
+        break;
+    case GroupTable::LIMIT:
+        problem = "Limite de grupos atingido.";
+        break;
+    case GroupTable::INVALID:
+        problem = "O nome do grupo deve ter de 1 a 20 caracteres, sem espaços.";
+        break;
+    }
+
+    if (problem)
+    {
+        Message error(Message::ERRO, 0, clientID, message->getUsernameView(), problem);
+        respond(error, clientAddr);
+        return;
+    }
+
+    Message reply(static_cast<Message::MessageType>(message->getType()), 0, clientID, _serverID,
+                  std::to_string(groupID) + " " + std::string(name));
+    respond(reply, clientAddr);
+}
+
+void Server::groupMessage(struct sockaddr_in clientAddr, const Message *message)
+{
+    thread_local std::vector<FanOut::Recipient> recipients;
+    bool compression = false;
+
+    if (_groups.recipients(message->getDestinationID(), message->getOriginID(), recipients, compression) !=
+        GroupTable::OK)
+    {
+        Message error(Message::ERRO, 0, message->getOriginID(), message->getUsernameView(),
+                      "Você não participa desse grupo!");
+        respond(error, clientAddr);
+        return;
+    }
+
+    const EncodedMessage encoded(*message, compression);
+    _fanOut->send(encoded, recipients);
+    _stats.groupMessages++;
+}
+
+void Server::handleMulticastRequest(struct sockaddr_in clientAddr, Message *message)
+{
+    int clientID = message->getOriginID();
+
+    if (!_multicast)
+        return;
+
+    if (message->getSequence() == Message::MULTICAST_JOIN)
+    {
+        // O teste vai pelo grupo: só chega se o multicast funciona até o cliente
+        Message probe(Message::MULTICAST, 0, clientID, _serverID, "");
+        probe.setSequence(Message::MULTICAST_PROBE);
+        probe.send(_sockfd, _multicastGroup);
+    }
+    else if (message->getSequence() == Message::MULTICAST_CONFIRM)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_clientsMutex);
+            SessionTable::Session *session = _sessions.find(clientID);
+
+            // O grupo é em claro: sessões cifradas ficam no unicast
+            if (!session || session->channel)
+                return;
+
+            session->multicast = true;
+        }
+
+        Message active(Message::MULTICAST, 0, clientID, _serverID, "");
+        active.setSequence(Message::MULTICAST_ACTIVE);
+        respond(active, clientAddr);
+    }
+}
+
+void Server::handlePresenceRequest(struct sockaddr_in clientAddr, Message *message)
+{
+    int state = message->getSequence();
+    std::string username;
+
+    // O desconectado é anunciado pelo `TCHAU`, não pelo cliente
+    if (state != Message::PRESENCE_ONLINE && state != Message::PRESENCE_AWAY && state != Message::PRESENCE_TYPING)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(_clientsMutex);
+        const SessionTable::Session *session = _sessions.find(message->getOriginID());
+
+        if (!session)
+            return;
+
+        username = std::string(_sessions.username(*session));
+    }
+
+    if (_presence.update(message->getOriginID(), username, static_cast<Message::PresenceState>(state), uptimeMs()))
+        wakeTimers();
+}
+
+void Server::publishPresence()
+{
+    std::vector<std::string> batches;
+
+    if (_presence.collect(uptimeMs(), batches) == 0)
+        return;
+
+    for (const std::string &batch : batches)
+    {
+        Message update(Message::PRESENCE, 0, 0, _serverID, batch);
+        broadcastMessage(&update);
+    }
+}
+
+void Server::broadcastMessage(const Message *message)
+{
+    // Os destinatários são copiados e os envios feitos fora do lock, para que
+    //     a recepção e o controle não esperem pelo fan-out
+    thread_local std::vector<FanOut::Recipient> recipients;
+    recipients.clear();
+    bool compression = false;
+    bool multicast = false, multicastPlain = false;
+
+    {
+        std::lock_guard<std::mutex> lock(_clientsMutex);
+        _sessions.forEach([&](const SessionTable::Session &session) {
+            // Sem canal até refazer a troca de chaves: nada vai em claro
+            if (session.keyless())
+                return;
+
+            // Quem confirmou o multicast recebe a cópia única enviada ao grupo
+            if (session.multicast)
+            {
+                multicast = true;
+                multicastPlain |= !session.compression;
+                return;
+            }
+
+            recipients.push_back({session.address, session.compression, session.channel});
+            compression |= session.compression;
+        });
+    }
+
+    // Codificada (e comprimida) uma vez; cada destinatário recebe os mesmos bytes
+    const EncodedMessage encoded(*message, compression || (multicast && !multicastPlain));
+
+    if (multicast)
+    {
+        encoded.send(_sockfd, _multicastGroup, !multicastPlain);
+        _stats.multicastSends++;
+    }
+
+    _fanOut->send(encoded, recipients);
+}
+
+void Server::privateMessage(const Message *message)
 {
     std::lock_guard<std::mutex> lock(_clientsMutex);
 
-    if (clientExists(message->getDestinationID()))
+    if (const SessionTable::Session *client = _sessions.find(message->getDestinationID()))
+    {
+        if (!client->keyless())
+            message->send(_sockfd, client->address, client->compression, client->channel.get());
+    }
+    else if (_cluster && Cluster::ownerOf(message->getDestinationID()) != _cluster->getNodeID() &&
+             _cluster->relayPrivate(*message))
     {
-        const auto client = _clients.find(message->getDestinationID());
-        message->send(_sockfd, client->second.address);
+        // Entregue pelo nó dono do destinatário
     }
     else
     {
-        const auto client = _clients.find(message->getOriginID());
+        const SessionTable::Session *client = _sessions.find(message->getOriginID());
         Message error(Message::ERRO, 0, message->getOriginID(), 
-                      message->getUsername(), "Usuário não encontrado!");
-        error.send(_sockfd, client->second.address);
+                      message->getUsernameView(), "Usuário não encontrado!");
+
+        if (client && !client->keyless())
+            error.send(_sockfd, client->address, false, client->channel.get());
     }
 }
 
+void Server::deliverRelayed(const Message &message)
+{
+    if (message.getDestinationID() == 0)
+    {
+        Message stamped(message);
+        stamped.setSequence(static_cast<int>(_search.add(message)));
+        broadcastMessage(&stamped);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_clientsMutex);
+    const SessionTable::Session *client = _sessions.find(message.getDestinationID());
+    if (client && !client->keyless())
+        message.send(_sockfd, client->address, client->compression, client->channel.get());
+}
+
+void Server::announceClients(int nodeID)
+{
+    std::lock_guard<std::mutex> lock(_clientsMutex);
+
+    _cluster->beginRoster(nodeID);
+    _sessions.forEach([&](const SessionTable::Session &session) {
+        _cluster->announceJoin(session.id, _sessions.username(session), nodeID);
+    });
+}
+
 void Server::sendServerStatus()
 {
+    // A contagem é lida com a tabela travada, junto do envio
+    std::lock_guard<std::mutex> lock(_clientsMutex);
+
     std::string message = "STATUS: " + _serverID + 
-                          " | Clientes: " + std::to_string(_clients.size()) + 
+                          " | Clientes: " + std::to_string(_sessions.size()) + 
                           " | Tempo: " + getElapsedTime();
 
     if (message.size() > 140)
         message = message.substr(0, 140);
 
-    std::lock_guard<std::mutex> lock(_clientsMutex);
-    for (const auto &client : _clients)
-    {
-        Message msg(Message::MSG, 0, client.first, _serverID, message);
-        const sockaddr_in &addr = client.second.address;
-        msg.send(_sockfd, addr);
-    }
+    _sessions.forEach([&](const SessionTable::Session &session) {
+        if (session.keyless())
+            return;
+
+        Message msg(Message::MSG, 0, session.id, _serverID, message);
+        msg.send(_sockfd, session.address, session.compression, session.channel.get());
+    });
+
+    std::cout << "Datagramas descartados: " << _stats.droppedDatagrams
+              << " | Duplicados suprimidos: " << _stats.duplicateMessages
+              << " | Limitadas: " << _stats.throttledMessages
+              << " (silenciados " << _stats.mutedClients << ", desconectados " << _stats.kickedClients << ")";
+
+    // Descartes do kernel por buffer de recepção cheio desde o último status
+    auto now = std::chrono::steady_clock::now();
+    unsigned long drops = _buffers->kernelDrops();
+    double seconds = std::chrono::duration<double>(now - _lastStatus).count();
+
+    std::cout << " | Erros de recepção: " << _stats.receiveErrors
+              << " | Descartes no kernel: " << drops << " (" << std::fixed << std::setprecision(1)
+              << (seconds > 0 ? (drops - _lastDrops) / seconds : 0.0) << "/s)"
+              << std::defaultfloat << std::setprecision(6)
+              << " | Buffers: " << _buffers->receiveSize() / 1024 << "/" << _buffers->sendSize() / 1024
+              << " KiB (ampliado " << _buffers->growths() << "x" << (_buffers->capped() ? ", no limite" : "") << ")";
+
+    _lastStatus = now;
+    _lastDrops = drops;
+
+    // `_clientsMutex` já está travado desde o envio do status
+    size_t members = 0, encrypted = 0;
+    _sessions.forEach([&members, &encrypted](const SessionTable::Session &session) {
+        members += session.multicast;
+        encrypted += session.channel != nullptr;
+    });
+
+    if (_multicast)
+        std::cout << " | Multicast: " << members << " clientes (" << _stats.multicastSends << " envios)";
+
+    std::cout << " | Cifradas: " << encrypted << " sessões (falhas de autenticação " << _stats.authFailures << ")";
+
+    std::cout << " | Grupos: " << _groups.size() << " (membros " << _groups.memberships()
+              << ", mensagens " << _stats.groupMessages << ")";
+
+    std::cout << " | Presença: " << _presence.updates() << " mudanças (suprimidas " << _presence.suppressed()
+              << ", lotes " << _presence.batches() << ")";
+
+    std::cout << " | Agendados: " << _schedule.pending() << " (publicados " << _stats.scheduledTweets << ")";
+
+    std::cout << " | Termos indexados: " << _search.termCount()
+              << " | Broadcasts paralelos: " << _fanOut->parallelSends();
+
+    if (_cluster)
+        std::cout << " | Nós ativos: " << _cluster->aliveNodes();
+
+    if (_replication)
+        std::cout << " | Replicação: atraso de " << _replication->lagEntries() << " entradas, "
+                  << _replication->lagMilliseconds() << " ms";
+
+    std::cout << std::endl << _scheduler.latencySummary() << std::endl;
 }
 
 void Server::addClient(struct sockaddr_in clientAddr, Message* msg)
 {
+    // Com a flag, o texto do OI é a chave pública do cliente
+    bool encrypted = msg->hasFlag(Message::ACCEPTS_ENCRYPTION);
+    unsigned char peerKey[SEAL_KEY_SIZE];
+
+    if (encrypted && !SecureChannel::fromHex(msg->getTextView(), peerKey))
+        return;
+
+    if (!encrypted && _requireEncryption)
+    {
+        Message error(Message::ERRO, 0, 0, _serverID, "Este servidor aceita apenas sessões cifradas.");
+        error.send(_sockfd, clientAddr);
+        return;
+    }
+
     std::lock_guard<std::mutex> lock(_clientsMutex);
-    if (!clientExists(msg->getOriginID()))
+
+    // Um OI repetido do mesmo endereço recebe o ID já atribuído
+    const auto registered = _addressIndex.find(addressKey(clientAddr));
+    int clientID = registered != _addressIndex.end() ? registered->second
+                 : _cluster ? _cluster->clientID(_idCount) : _idCount;
+    bool compression = msg->hasFlag(Message::ACCEPTS_COMPRESSION);
+    SessionTable::Session *session = registered != _addressIndex.end() ? _sessions.find(clientID) : nullptr;
+    std::shared_ptr<SecureChannel> channel;
+
+    // Sessão cifrada restaurada: só o OI provado com o segredo de retomada e o
+    //     desafio do pedido refaz o canal; a repetição dele recebe o mesmo canal
+    std::string proof;
+
+    if (session && session->rekey && encrypted)
     {
-        _clients[_idCount] = {clientAddr, msg->getUsername()};
+        const SessionTable::Rekey &rekey = *session->rekey;
 
-        Message idMessage(Message::OI, 0, _idCount, _serverID, "");
+        if (!SecureChannel::matches(SecureChannel::prove(rekey.resume, "troca", clientID, rekey.challenge, peerKey),
+                                    msg->getTextView().substr(2 * SEAL_KEY_SIZE)))
+        {
+            _stats.authFailures++;
+            return;
+        }
+
+        if (!session->channel || memcmp(peerKey, session->channel->peerKey(), SEAL_KEY_SIZE) != 0)
+        {
+            SecureChannel::KeyPair keys;
+
+            if (!SecureChannel::generate(keys) || !(channel = SecureChannel::establish(keys, peerKey, false, clientID)))
+            {
+                _stats.authFailures++;
+                return;
+            }
+
+            channel->adoptResume(rekey.resume);
+            session->channel = channel;
+        }
+
+        channel = session->channel;
+        proof = SecureChannel::prove(rekey.resume, "resposta", clientID, rekey.challenge, peerKey, channel->localKey());
+    }
+    else if (session)
+    {
+        // A sessão mantém o modo e a chave do primeiro OI: um OI em claro (ou
+        //     com outra chave) no endereço de uma sessão cifrada é ignorado
+        if (encrypted != (session->channel != nullptr) ||
+            (encrypted && memcmp(peerKey, session->channel->peerKey(), SEAL_KEY_SIZE) != 0))
+        {
+            _stats.authFailures++;
+            return;
+        }
+
+        channel = session->channel;
+    }
+    else if (encrypted)
+    {
+        SecureChannel::KeyPair keys;
+
+        if (!SecureChannel::generate(keys) || !(channel = SecureChannel::establish(keys, peerKey, false, clientID)))
+        {
+            _stats.authFailures++;
+            return;
+        }
+    }
+
+    // O grupo multicast é anunciado como "<IP> <porta>"; a adesão vem depois.
+    //     Em sessões cifradas, a resposta leva a chave pública do servidor (e,
+    //     na retomada, a prova do servidor)
+    bool multicast = _multicast && msg->hasFlag(Message::ACCEPTS_MULTICAST) && !channel;
+    char group[INET_ADDRSTRLEN] = "";
+
+    if (multicast)
+        inet_ntop(AF_INET, &_multicastGroup.sin_addr, group, sizeof(group));
+
+    Message idMessage(Message::OI, 0, clientID, _serverID,
+                      channel ? SecureChannel::toHex(channel->localKey()) + proof
+                      : multicast ? std::string(group) + " " + std::to_string(ntohs(_multicastGroup.sin_port)) : "");
+    if (compression)
+        idMessage.setFlag(Message::ACCEPTS_COMPRESSION);
+    if (multicast)
+        idMessage.setFlag(Message::ACCEPTS_MULTICAST);
+    if (channel)
+        idMessage.setFlag(Message::ACCEPTS_ENCRYPTION);
+
+    // A resposta ao OI vai em claro: o cliente só tem o canal depois dela
+    if (session)
+    {
+        session->compression = compression;
+        session->multicast = false;
         idMessage.send(_sockfd, clientAddr);
+    }
+    else
+    {
+        if (!(session = _sessions.add(clientID, clientAddr, msg->getUsernameView(), compression)))
+            return;
+
+        session->channel = channel;
+        _addressIndex[addressKey(clientAddr)] = clientID;
 
-        log(msg, clientAddr, true);
+        idMessage.send(_sockfd, clientAddr);
+
+        // Quem já estava ausente ou digitando; os conectados vêm no `LIST`
+        std::string presence = _presence.snapshot(clientID);
+        if (!presence.empty())
+        {
+            Message current(Message::PRESENCE, 0, clientID, _serverID, presence);
+            current.send(_sockfd, clientAddr, compression, channel.get());
+        }
+
+        if (_presence.update(clientID, msg->getUsernameView(), Message::PRESENCE_ONLINE, uptimeMs()))
+            wakeTimers();
+
+        if (_cluster)
+            _cluster->announceJoin(clientID, msg->getUsernameView());
+
+        log(msg->getUsernameView(), clientAddr, true, clientID);
 
         _idCount++;
     }
+
+    ClientInfo client = _sessions.info(*session);
+
+    if (_replication)
+        _replication->logAdd(clientID, client, _idCount);
+
+    if (_sessionStore)
+        _sessionStore->journalAdd(clientID, client, _idCount);
 }
 
 void Server::deleteClient(struct sockaddr_in clientAddr, Message* msg)
 {
+    int clientID = msg->getOriginID();
+
+    // O nome vem da sessão: o do TCHAU é escolhido pelo remetente
+    std::string username;
+
+    {
+        std::lock_guard<std::mutex> lock(_clientsMutex);
+        const SessionTable::Session *session = _sessions.find(clientID);
+
+        if (!session)
+            return;
+
+        username = _sessions.username(*session);
+        clientAddr = session->address;
+
+        _sessions.remove(clientID);
+        _addressIndex.erase(addressKey(clientAddr));
+
+        if (_cluster)
+            _cluster->announceLeave(clientID, username);
+
+        if (_replication)
+            _replication->logDelete(clientID);
+
+        if (_sessionStore)
+            _sessionStore->journalDelete(clientID);
+
+        log(username, clientAddr, false, clientID);
+    }
+
+    // Fora do lock dos clientes: os grupos e a presença têm os próprios mutex
+    _groups.leaveAll(clientID);
+
+    if (_presence.update(clientID, username, Message::PRESENCE_OFFLINE, uptimeMs()))
+        wakeTimers();
+}
+
+Server::Screening Server::screen(int clientID, const Message &msg, RateLimit::Verdict &verdict)
+{
+    uint32_t now = uptimeMs();
+
     std::lock_guard<std::mutex> lock(_clientsMutex);
-    if (clientExists(msg->getOriginID()))
+    SessionTable::Session *session = _sessions.find(clientID);
+
+    // Removida entre o filtro e a triagem
+    if (!session)
+        return UNKNOWN;
+
+    if ((msg.getType() == Message::MSG || msg.getType() == Message::GROUP_MSG) &&
+        !session->window.accept(msg.getSequence()))
+        return DUPLICATE;
+
+    // A desconexão é sempre aceita
+    if (msg.getType() == Message::TCHAU)
+        return ACCEPTED;
+
+    verdict = session->rate.admit(now, _ratePolicy);
+    return verdict == RateLimit::ALLOW ? ACCEPTED : LIMITED;
+}
+
+void Server::penalize(RateLimit::Verdict verdict, const Message &msg, const struct sockaddr_in &clientAddr)
+{
+    _stats.throttledMessages++;
+
+    const char *warning = nullptr;
+
+    if (verdict == RateLimit::THROTTLE)
+    {
+        warning = "Muitas mensagens! Aguarde um pouco antes de enviar de novo.";
+    }
+    else if (verdict == RateLimit::MUTE)
+    {
+        _stats.mutedClients++;
+        warning = "Você foi silenciado temporariamente por excesso de mensagens.";
+    }
+    else if (verdict == RateLimit::DISCONNECT)
+    {
+        _stats.kickedClients++;
+        warning = "Você foi desconectado por excesso de mensagens.";
+
+        // Mesmo caminho de um TCHAU do cliente: cluster, replicação e snapshot
+        Message bye(Message::TCHAU, msg.getOriginID(), 0, msg.getUsernameView(), "");
+        enqueue(CONTROL, bye, clientAddr);
+    }
+
+    if (warning)
+    {
+        Message error(Message::ERRO, 0, msg.getOriginID(), msg.getUsernameView(), warning);
+        respond(error, clientAddr);
+    }
+}
+
+void Server::requestRekeys()
+{
+    std::vector<std::pair<Message, sockaddr_in>> requests;
+    uint32_t now = uptimeMs();
+
     {
-        _clients.erase(msg->getOriginID());
+        std::lock_guard<std::mutex> lock(_clientsMutex);
+        _sessions.forEach([&](SessionTable::Session &session) {
+            if (!session.keyless() || session.rekey->tries >= REKEY_ATTEMPTS ||
+                now - session.rekey->asked < REKEY_INTERVAL_MS)
+                return;
 
-        log(msg, clientAddr, false);
+            session.rekey->asked = now;
+            session.rekey->tries++;
+            requests.emplace_back(rekeyRequest(session), session.address);
+        });
     }
+
+    for (const auto &request : requests)
+        request.first.send(_sockfd, request.second);
+}
+
+Message Server::rekeyRequest(const SessionTable::Session &session) const
+{
+    // Em claro, pois o cliente ainda cifra com a chave antiga; a flag distingue o
+    //     pedido de um erro comum e a prova mostra que ele vem de quem conhece a sessão
+    const SessionTable::Rekey &rekey = *session.rekey;
+    Message request(Message::ERRO, 0, session.id, _serverID,
+                    std::to_string(rekey.challenge) + " " +
+                    SecureChannel::prove(rekey.resume, "pedido", session.id, rekey.challenge));
+    request.setFlag(Message::ACCEPTS_ENCRYPTION);
+    return request;
+}
+
+void Server::copySessions(std::unordered_map<int, ClientInfo> &clients, int &idCount)
+{
+    std::lock_guard<std::mutex> lock(_clientsMutex);
+
+    _sessions.forEach([&](const SessionTable::Session &session) {
+        clients[session.id] = _sessions.info(session);
+    });
+    idCount = _idCount;
+}
+
+uint64_t Server::addressKey(const struct sockaddr_in &addr)
+{
+    return (static_cast<uint64_t>(addr.sin_addr.s_addr) << 16) | addr.sin_port;
 }
 
-bool Server::clientExists(int clientID)
+uint32_t Server::uptimeMs()
 {
-    return _clients.find(clientID) != _clients.end();
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>
+                                     (std::chrono::steady_clock::now() - startTime).count());
 }
 
 std::string Server::getElapsedTime()
@@ -262,15 +1522,15 @@ std::string Server::getCurrentTime()
     return ctime(&now);
 }
 
-void Server::log(Message*  msg, struct sockaddr_in clientAddr, bool isAdd)
+void Server::log(std::string_view username, struct sockaddr_in clientAddr, bool isAdd, int clientID)
 {
     if (isAdd)
     {
         std::cout << "Client connected: " << inet_ntoa(clientAddr.sin_addr)
                   << ":" << ntohs(clientAddr.sin_port) 
-                  << " with ID: " << _idCount << std::endl;
+                  << " with ID: " << clientID << std::endl;
 
-        _file << "Connected: " << msg->getUsername() << "#" << _idCount 
+        _file << "Connected: " << username << "#" << clientID 
               << " -  " << getCurrentTime();
         _file.flush();
     }
@@ -278,9 +1538,9 @@ void Server::log(Message*  msg, struct sockaddr_in clientAddr, bool isAdd)
     {
         std::cout << "Client disconnected: " << inet_ntoa(clientAddr.sin_addr)
                   << ":" << ntohs(clientAddr.sin_port) 
-                  << " with ID: " << msg->getOriginID() << std::endl;
+                  << " with ID: " << clientID << std::endl;
 
-        _file << "Disconnected: " << msg->getUsername() << "#" << msg->getOriginID() 
+        _file << "Disconnected: " << username << "#" << clientID 
               << " -  " << getCurrentTime();
         _file.flush();
     }
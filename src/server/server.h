@@ -2,14 +2,57 @@
 #define SERVER_H
 
 #include "../include/message.h"
+#include "cluster.h"
+#include "config.h"
+#include "fanout.h"
+#include "group_table.h"
+#include "presence.h"
+#include "replication.h"
+#include "snapshot.h"
+#include "session_table.h"
+#include "scheduler.h"
+#include "search.h"
+#include "tweet_schedule.h"
+#include "../include/trace.h"
+#include "../include/socket_buffers.h"
 #include <chrono>
+#include <condition_variable>
 #include <unordered_map>
 #include <mutex>
 #include <csignal>
 #include <fstream>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <cstdint>
 
-#define BUFFER_SIZE 1024
-#define TIMER 60
+#define BUFFER_SIZE 2048
+#define HISTORY_LIMIT 200   /** Tweets enviados em resposta a um `HISTORY` */
+#define RECEIVE_ERROR_BACKOFF_MS 10     /** Pausa após um erro de recepção */
+#define RECEIVE_ERROR_LOG_EVERY 1000    /** Erros de recepção entre dois avisos no console */
+#define MULTICAST_TTL 1                 /** Saltos dos datagramas multicast (1 = só a rede local) */
+#define SCHEDULE_REQUEST_SIZE (20 + 1 + MAX_TEXT_SIZE)  /** Texto de um `SCHEDULE`: "<ms> <tweet>" */
+#define REKEY_INTERVAL_MS 1000          /** Intervalo mínimo entre pedidos de nova troca de chaves a uma sessão */
+#define REKEY_ATTEMPTS 30               /** Pedidos periódicos a uma sessão restaurada que não responde */
+
+/**
+ * @brief Contadores de desempenho do servidor.
+ * 
+ * Atualizados pelas threads de recepção e tratamento, e impressos junto com o
+ *     status periódico.
+ */
+struct ServerStats {
+    std::atomic<unsigned long> droppedDatagrams{0};   /** Datagramas descartados por origem inválida */
+    std::atomic<unsigned long> duplicateMessages{0};  /** Mensagens duplicadas suprimidas antes do broadcast */
+    std::atomic<unsigned long> throttledMessages{0};  /** Mensagens recusadas pelo limite de taxa */
+    std::atomic<unsigned long> mutedClients{0};       /** Silêncios temporários aplicados */
+    std::atomic<unsigned long> kickedClients{0};      /** Clientes desconectados por excesso de mensagens */
+    std::atomic<unsigned long> receiveErrors{0};      /** Erros transitórios do `recvmsg` */
+    std::atomic<unsigned long> scheduledTweets{0};    /** Tweets agendados publicados */
+    std::atomic<unsigned long> groupMessages{0};      /** Mensagens entregues a grupos */
+    std::atomic<unsigned long> multicastSends{0};     /** Broadcasts publicados no grupo multicast */
+    std::atomic<unsigned long> authFailures{0};       /** Datagramas cifrados recusados ou em claro de sessão cifrada */
+};
 
 /**
  * @brief Implementação do servidor UDP.
@@ -17,8 +60,11 @@
  * A classe `Server` representa o servidor que gerencia conexões de clientes, 
  * escuta mensagens e responde a pedidos no sistema de comunicação UDP.
  * 
+ * Como filtro de datagramas, abre os datagramas das sessões cifradas e recusa
+ *     os em claro vindos delas (exceto o OI).
+ * 
  */
-class Server
+class Server : private DatagramFilter
 {
 public:
     /**
@@ -41,6 +87,134 @@ public:
      */
     ~Server();
 
+    /**
+     * @brief Ativa o modo cluster.
+     * 
+     * Deve ser chamado antes de `start()`. Os IDs de clientes passam a ser
+     *     particionados entre os nós.
+     * 
+     * @param nodeID ID deste nó no cluster.
+     * @param seeds Endereços de outros nós para o contato inicial.
+     * 
+     */
+    void enableCluster(int, const std::vector<sockaddr_in>&);
+
+    /**
+     * @brief Ativa a replicação das sessões para um standby.
+     * 
+     * Deve ser chamado antes de `start()`.
+     * 
+     * @param replica Endereço de replicação do standby.
+     * @param key Chave compartilhada do HMAC da replicação (vazia = sem HMAC).
+     * 
+     */
+    void enableReplication(const sockaddr_in&, const std::string& = "");
+
+    /**
+     * @brief Ativa a persistência das sessões em disco.
+     * 
+     * Deve ser chamado antes de `start()`. Carrega o snapshot e o journal
+     *     existentes, de modo que um reinício preserva as sessões e os IDs. Os
+     *     tweets agendados ficam em `<path>.schedule`.
+     * 
+     * @param path Caminho do arquivo de snapshot.
+     * 
+     */
+    void enablePersistence(const std::string&);
+
+    /**
+     * @brief Ativa a publicação dos broadcasts em um grupo multicast.
+     * 
+     * Deve ser chamado antes de `start()`. O grupo é anunciado no OI aos
+     *     clientes que aceitam multicast; os que confirmam a adesão
+     *     (`MulticastStep`) recebem os broadcasts por um único datagrama ao
+     *     grupo, e os demais continuam recebendo por unicast.
+     * 
+     * @param group Endereço e porta do grupo.
+     * 
+     */
+    void enableMulticast(const sockaddr_in&);
+
+    /**
+     * @brief Recusa clientes que não cifram a sessão.
+     * 
+     * Deve ser chamado antes de `start()`. O OI sem chave pública recebe um
+     *     `ERRO`; o tráfego entre nós do cluster não é afetado.
+     * 
+     */
+    void requireEncryption();
+
+    /**
+     * @brief Aplica uma configuração.
+     * 
+     * Pode ser chamado antes de `start()` ou com o servidor rodando (recarga
+     *     por `SIGHUP`). A configuração inteira é validada antes de qualquer
+     *     troca; se um parâmetro for inválido, ou se não for possível criar as
+     *     threads pedidas, a configuração em vigor continua intacta. Cada parte
+     *     (threads, filas, fan-out, buffers, limite de taxa e timer) é trocada
+     *     de uma vez, sem estados intermediários. Mensagens em processamento
+     *     terminam com os valores antigos.
+     * 
+     * @param config Nova configuração.
+     * @param error Recebe o motivo da recusa.
+     * 
+     * @retval `true` Se a configuração foi aplicada
+     * @retval `false` Se foi recusada
+     */
+    bool reconfigure(const ServerConfig&, std::string&);
+
+    /**
+     * @brief Configuração em vigor.
+     * 
+     */
+    ServerConfig configuration();
+
+    /**
+     * @brief Ativa o trace de latência.
+     * 
+     * Registra as etapas das mensagens amostradas (pelo cliente ou aqui, na
+     *     fração pedida) em um arquivo binário, lido por `trace-report`.
+     * 
+     * @param path Arquivo de trace.
+     * @param fraction Fração das mensagens amostradas pelo servidor.
+     * 
+     */
+    void enableTracing(const std::string&, double);
+
+    /**
+     * @brief Escreve no arquivo os registros de trace acumulados.
+     * 
+     */
+    void flushTrace();
+
+    /**
+     * @brief Entrega os tweets agendados e os lotes de presença que vencerem durante o período.
+     * 
+     * Chamado em laço pela thread principal. Com agendamentos pendentes,
+     *     acorda a cada tick da roda; sem eles, só ao fim do período, quando
+     *     chega um agendamento novo ou quando fecha a janela de um lote de
+     *     presença.
+     * 
+     * @param period Duração da chamada.
+     * 
+     */
+    void runTimers(std::chrono::milliseconds);
+
+    /**
+     * @brief Restaura as sessões recebidas por replicação.
+     * 
+     * Usado pelo standby ao assumir, antes de `start()`, e ao carregar o
+     *     snapshot. As chaves das sessões cifradas não são copiadas, só o
+     *     segredo de retomada: elas voltam sem canal, com um desafio novo, e
+     *     esperam o cliente refazer a troca provando conhecer o segredo
+     *     (`rekey`). As que vierem sem o segredo não são restauradas.
+     * 
+     * @param clients Sessões replicadas.
+     * @param idCount Contador de IDs replicado.
+     * 
+     */
+    void restore(const std::unordered_map<int, ClientInfo>&, int);
+
     /**
      * @brief Inicia o servidor.
      * 
@@ -59,16 +233,60 @@ public:
      */
     void sendServerStatus();
 
+    /**
+     * @brief Pede o envio do status pelas threads de processamento.
+     * 
+     * Seguro para ser chamado do handler do sinal do timer.
+     * 
+     */
+    void requestServerStatus();
+
 private:
+    /// Resultado da triagem de uma mensagem de cliente
+    enum Screening
+    {
+        ACCEPTED,  /** Segue para as filas */
+        UNKNOWN,   /** A sessão saiu entre o filtro e a triagem */
+        DUPLICATE, /** Sequência já vista */
+        LIMITED    /** Recusada pelo limite de taxa */
+    };
+
     int _sockfd;                                      /** Descritor de socket do servidor */
     int _idCount;                                     /** Contador de IDs para os clientes */
+    int _incarnation;                                 /** Identifica esta execução (e a numeração da linha do tempo) */
     bool _running;                                    /** Flag para indicar se o servidor está rodando */
     const std::string _serverID = "UDP_SERVER";       /** Identificador do servidor */
     struct sockaddr_in _serverAddr;                   /** Endereço do servidor */
     std::ofstream _file;                              /** Arquivo de log para o servidor */
-    std::unordered_map<int, ClientInfo> _clients;     /** Mapeamento de clientes conectados */
+    SessionTable _sessions;                           /** Sessões dos clientes conectados */
+    std::unordered_map<uint64_t, int> _addressIndex;  /** Índice secundário (IP, porta) -> ID do cliente */
     std::mutex _clientsMutex;                         /** Mutex para proteger acesso à lista de clientes */
     std::chrono::time_point<std::chrono::steady_clock> startTime; /** Momento de início do servidor */
+    ServerStats _stats;                               /** Contadores de desempenho */
+    std::unique_ptr<Cluster> _cluster;                /** Modo cluster (nulo em nó único) */
+    std::unique_ptr<ReplicationPrimary> _replication; /** Replicação para standby (nulo se desativada) */
+    std::unique_ptr<SessionStore> _sessionStore;      /** Persistência das sessões (nulo se desativada) */
+    Reassembler _reassembler;                         /** Remontagem de mensagens fragmentadas */
+    SearchIndex _search;                              /** Índice dos tweets públicos recentes */
+    Scheduler _scheduler;                             /** Filas de prioridade e threads de processamento */
+    std::unique_ptr<FanOut> _fanOut;                  /** Envio em lotes (e em paralelo) dos broadcasts */
+    std::unique_ptr<Tracer> _tracer;                  /** Trace de latência (nulo se desativado) */
+    std::unique_ptr<SocketBuffers> _buffers;          /** Buffers do socket e descartes do kernel */
+    TweetSchedule _schedule;                          /** Tweets agendados */
+    GroupTable _groups;                               /** Grupos e seus membros */
+    PresenceBoard _presence;                          /** Presença dos clientes e mudanças a publicar */
+    std::mutex _timerMutex;                           /** Protege `_timerKick` */
+    std::condition_variable _timerWake;               /** Acorda `runTimers` */
+    bool _timerKick;                                  /** Agendamento novo desde a última volta */
+    ServerConfig _config;                             /** Configuração em vigor */
+    std::mutex _configMutex;                          /** Serializa as trocas de configuração */
+    bool _multicast;                                  /** Broadcasts também pelo grupo multicast */
+    bool _requireEncryption;                          /** Só aceita sessões cifradas */
+    struct sockaddr_in _multicastGroup;               /** Grupo multicast anunciado no OI */
+    RateLimit::Policy _ratePolicy;                    /** Limite de taxa em vigor (protegido por `_clientsMutex`) */
+    std::chrono::steady_clock::time_point _lastStatus;  /** Momento do último status (taxa de descartes) */
+    unsigned long _lastDrops;                         /** Descartes do kernel no último status */
+    int _sender;                                      /** Sessão do último datagrama aceito pelo filtro (só a recepção usa) */
 
     /**
      * @brief Função para ouvir mensagens dos clientes.
@@ -79,13 +297,97 @@ private:
      */
     void listen();
 
+    /**
+     * @brief Abre os datagramas cifrados e recusa os que a sessão não aceita.
+     * 
+     * Chamado pela recepção para cada datagrama, antes da remontagem. Um
+     *     datagrama cifrado deve vir do endereço da sessão que leva no
+     *     cabeçalho; um em claro só é aceito se for um OI ou se o endereço não
+     *     pertencer a uma sessão cifrada; um fragmento em claro, só de uma
+     *     sessão em claro ou de um nó do cluster. Um datagrama cifrado que
+     *     uma sessão restaurada não consegue abrir (o cliente ainda usa a
+     *     chave antiga) recebe, em claro, o pedido para refazer a troca
+     *     (`rekeyRequest`); o primeiro aberto com o canal novo a encerra.
+     *     Guarda em `_sender` a sessão resolvida, para a recepção não
+     *     consultar o índice de endereços outra vez.
+     * 
+     * @return size_t Tamanho do datagrama aceito, ou 0 se descartado.
+     */
+    size_t filter(const struct sockaddr_in&, char*, size_t) override;
+
+    /**
+     * @brief Envia uma resposta a um cliente, cifrada se a sessão dele for.
+     * 
+     * @param message Resposta.
+     * @param clientAddr Endereço do cliente.
+     * @param compression Cliente aceita mensagens comprimidas.
+     * 
+     */
+    void respond(const Message&, const struct sockaddr_in&, bool = false);
+
+    /**
+     * @brief Pede às sessões cifradas restauradas que refaçam a troca de chaves.
+     * 
+     * Chamado a cada período dos timers, até `REKEY_ATTEMPTS` vezes por
+     *     sessão, para que clientes que só escutam também se recuperem.
+     * 
+     */
+    void requestRekeys();
+
+    /**
+     * @brief Monta o pedido de nova troca de chaves (`ERRO` com
+     *     `ACCEPTS_ENCRYPTION`, enviado em claro).
+     * 
+     * O texto é o desafio da sessão, em decimal, e a prova do pedido com o
+     *     segredo de retomada. Chamado com `_clientsMutex`.
+     * 
+     * @param session Sessão restaurada, com a troca pendente.
+     * 
+     * @return Message Pedido.
+     */
+    Message rekeyRequest(const SessionTable::Session&) const;
+
+    /**
+     * @brief Enfileira uma mensagem validada para processamento.
+     * 
+     * Se a fila da classe estiver cheia, a mensagem é descartada e contada.
+     * 
+     * @param trafficClass Classe de tráfego da mensagem.
+     * @param msg Mensagem recebida.
+     * @param clientAddr Endereço do remetente.
+     * 
+     */
+    void enqueue(TrafficClass, const Message&, const struct sockaddr_in&);
+
+    /**
+     * @brief Enfileira uma mensagem repassada por outro nó do cluster.
+     * 
+     * Chamado pela thread de recepção ao abrir um lote `RELAY`: o fan-out
+     *     fica com as threads de processamento, nas filas `BROADCAST` ou
+     *     `DIRECT`, como o das mensagens locais.
+     * 
+     * @param msg Mensagem repassada.
+     * 
+     */
+    void enqueueRelayed(const Message&);
+
+    /**
+     * @brief Processa um trabalho retirado das filas de prioridade.
+     * 
+     * @param job Trabalho a ser executado.
+     * 
+     */
+    void process(Scheduler::Job&);
+
     /**
      * @brief Configura o timer do servidor.
      * 
      * Define o intervalo de tempo para envio de sinais.
      * 
+     * @param interval Intervalo em segundos.
+     * 
      */
-    void setupTimer();
+    void setupTimer(int);
     
     /**
      * @brief Lida com mensagens recebidas de um cliente.
@@ -95,7 +397,7 @@ private:
      * @param msg Ponteiro para a mensagem recebida.
      * 
      */
-    void handleClient(Message*);
+    void handleClient(const Message*);
 
     /**
      * @brief Lida com pedidos de lista de clientes online.
@@ -108,15 +410,135 @@ private:
      */
     void handleClientListRequest(struct sockaddr_in, Message*);
 
+    /**
+     * @brief Lida com buscas nos tweets recentes.
+     * 
+     * Responde com uma página de resultados: uma linha com o total e uma
+     *     linha `ID:usuario:texto` por tweet, do mais novo ao mais antigo.
+     * 
+     * @param clientAddr Endereço do cliente que fez a busca.
+     * @param msg Ponteiro para a mensagem com a consulta (destino = página).
+     * 
+     */
+    void handleSearchRequest(struct sockaddr_in, Message*);
+
+    /**
+     * @brief Lida com pedidos dos tweets recentes.
+     * 
+     * Responde com os tweets posteriores à posição pedida (até `HISTORY_LIMIT`),
+     *     codificados em sequência, cada um com sua posição como número de
+     *     sequência.
+     * 
+     * @param clientAddr Endereço do cliente.
+     * @param msg Ponteiro para o pedido (sequência = última posição conhecida).
+     * 
+     */
+    void handleHistoryRequest(struct sockaddr_in, Message*);
+
+    /**
+     * @brief Lida com pedidos de agendamento de tweets.
+     * 
+     * Responde com `SCHEDULE` ("<ticket> <horário>", mesma sequência do
+     *     pedido) ou com um `ERRO`.
+     * 
+     * @param clientAddr Endereço do cliente.
+     * @param msg Ponteiro para o pedido (destino = destinatário do tweet).
+     * 
+     */
+    void handleScheduleRequest(struct sockaddr_in, Message*);
+
+    /**
+     * @brief Lida com cancelamentos de agendamentos.
+     * 
+     * @param clientAddr Endereço do cliente.
+     * @param msg Ponteiro para o pedido (texto = ticket).
+     * 
+     */
+    void handleUnscheduleRequest(struct sockaddr_in, Message*);
+
+    /**
+     * @brief Publica um tweet agendado vencido.
+     * 
+     * O tweet entra na fila como uma mensagem do autor, pelo mesmo caminho de
+     *     um `MSG` recebido (linha do tempo, cluster e fan-out), mesmo que o
+     *     autor já tenha se desconectado.
+     * 
+     * @param tweet Agendamento vencido.
+     * 
+     */
+    void deliverScheduled(const ScheduledTweet&);
+
+    /**
+     * @brief Lida com a criação de grupos e as entradas e saídas de membros.
+     * 
+     * Responde com o mesmo tipo do pedido ("<ID do grupo> <nome>") ou com um
+     *     `ERRO`.
+     * 
+     * @param clientAddr Endereço do cliente.
+     * @param msg Ponteiro para o pedido (texto = nome do grupo).
+     * 
+     */
+    void handleGroupRequest(struct sockaddr_in, Message*);
+
+    /**
+     * @brief Envia uma mensagem aos membros de um grupo.
+     * 
+     * Os membros são copiados da `GroupTable`, sem a lista de clientes, e
+     *     recebem a mesma codificação pelo `FanOut`. O remetente deve ser
+     *     membro; caso contrário, recebe um `ERRO`.
+     * 
+     * @param clientAddr Endereço do remetente.
+     * @param msg Ponteiro para a mensagem (destino = ID do grupo).
+     * 
+     */
+    void groupMessage(struct sockaddr_in, const Message*);
+
+    /**
+     * @brief Lida com as etapas da adesão de um cliente ao multicast.
+     * 
+     * @param clientAddr Endereço do cliente.
+     * @param msg Ponteiro para o pedido (sequência = `MulticastStep`).
+     * 
+     */
+    void handleMulticastRequest(struct sockaddr_in, Message*);
+
+    /**
+     * @brief Lida com a mudança de estado de presença de um cliente.
+     * 
+     * Só registra o estado: a publicação é feita em lotes por `runTimers`.
+     * 
+     * @param clientAddr Endereço do cliente.
+     * @param msg Ponteiro para o pedido (sequência = `PresenceState`).
+     * 
+     */
+    void handlePresenceRequest(struct sockaddr_in, Message*);
+
+    /**
+     * @brief Publica o lote de mudanças de presença pendentes.
+     * 
+     * Cada lote é um broadcast: uma codificação para todos os destinatários
+     *     e um único datagrama para os que recebem por multicast.
+     * 
+     */
+    void publishPresence();
+
+    /**
+     * @brief Acorda `runTimers` para reavaliar os prazos.
+     * 
+     */
+    void wakeTimers();
+
     /**
      * @brief Envia uma mensagem para todos os clientes conectados.
      * 
      * Realiza o broadcast de uma mensagem para todos os clientes. conectados ao
-     *     servidor.
+     *     servidor. Os envios são feitos pelo `FanOut`, divididos entre threads
+     *     quando há muitos destinatários; os clientes com multicast recebem um
+     *     único datagrama enviado ao grupo.
      * @param msg Ponteiro para a mensagem a ser enviada.
      * 
      */
-    void broadcastMessage(Message*);
+    void broadcastMessage(const Message*);
 
     /**
      * @brief Envia uma mensagem privada para um cliente.
@@ -127,7 +549,26 @@ private:
      * @param msg Ponteiro para a mensagem a ser enviada.
      * 
      */
-    void privateMessage(Message*);
+    void privateMessage(const Message*);
+
+    /**
+     * @brief Entrega uma mensagem repassada por outro nó do cluster.
+     * 
+     * Faz o broadcast ou a mensagem privada apenas para clientes locais.
+     *     Executado pelas threads de processamento (veja `enqueueRelayed`).
+     * 
+     * @param msg Mensagem repassada.
+     * 
+     */
+    void deliverRelayed(const Message&);
+
+    /**
+     * @brief Envia a lista de clientes locais para outro nó do cluster.
+     * 
+     * @param nodeID ID do nó de destino.
+     * 
+     */
+    void announceClients(int);
     
     /**
      * @brief Adciona cliente ao servidor.
@@ -143,7 +584,9 @@ private:
     /**
      * @brief Remove cliente do servidor.
      * 
-     * Desconecta e remove um cliente do servidor.
+     * Desconecta e remove um cliente do servidor. O log, o cluster e a
+     *     presença recebem o nome e o endereço guardados na sessão, não os
+     *     do `TCHAU`.
      * 
      * @param clientAddr Endereço do cliente.
      * @param msg Ponteiro para a mensagem de desconexão.
@@ -152,17 +595,56 @@ private:
     void deleteClient(struct sockaddr_in, Message*);
 
     /**
-     * @brief Verifica se um cliente existe.
+     * @brief Faz a triagem de uma mensagem de um cliente já resolvido.
+     * 
+     * Sob um único lock dos clientes, registra a sequência na janela de
+     *     deduplicação e consome uma ficha do limite de taxa (exceto no `TCHAU`).
+     * 
+     * @param clientId ID resolvido pelo filtro para o remetente.
+     * @param msg Mensagem recebida.
+     * @param verdict Decisão do limite de taxa, quando a mensagem é recusada por ele.
+     * 
+     * @return Screening Destino da mensagem.
+     */
+    Screening screen(int, const Message&, RateLimit::Verdict&);
+
+    /**
+     * @brief Aplica a punição de uma mensagem recusada pelo limite de taxa.
+     * 
+     * Avisa o cliente com um `ERRO` ao começar um estouro ou um silêncio, e
+     *     enfileira a desconexão quando as punições se esgotam.
+     * 
+     * @param verdict Decisão de `admit`.
+     * @param msg Mensagem recusada.
+     * @param clientAddr Endereço do remetente.
+     * 
+     */
+    void penalize(RateLimit::Verdict, const Message&, const struct sockaddr_in&);
+
+    /**
+     * @brief Copia as sessões para o formato da replicação e do snapshot.
      * 
-     * Checa se um cliente com determinado ID já está conectado ao servidor.
+     * @param clients Recebe as sessões por ID.
+     * @param idCount Recebe o contador de IDs.
      * 
-     * @param clientId ID do cliente a ser verificado.
+     */
+    void copySessions(std::unordered_map<int, ClientInfo>&, int&);
+
+    /**
+     * @brief Gera a chave do índice de endereços.
+     * 
+     * @param addr Endereço do cliente.
      * 
-     * @retval `true` Se o cliente existe.
-     * @retval `false` Se o cliente não existe.
+     * @return uint64_t Chave composta por IP e porta.
+     */
+    static uint64_t addressKey(const struct sockaddr_in&);
+
+    /**
+     * @brief Obtém os milissegundos desde o início do servidor (relógio monotônico).
      * 
+     * @return uint32_t Instante usado pelo limite de taxa e pela presença.
      */
-    bool clientExists(int);
+    uint32_t uptimeMs();
 
     /**
      * @brief Obtém o tempo decorrido desde o início do servidor.
@@ -184,12 +666,13 @@ private:
      * Faz o log do servidor, imprimindo no console e escrevendo em um arquivo
      *     de log.
      * 
-     * @param msg Ponteiro para a mensagem recebida.
+     * @param username Nome registrado do cliente.
      * @param clientAddr Endereço do cliente.
      * @param isAdd Indica se o log é para adicionar um novo cliente (true) 
      *     ou remover (false).
+     * @param clientID ID do cliente.
      */
-    void log(Message*, struct sockaddr_in, bool);
+    void log(std::string_view, struct sockaddr_in, bool, int);
 
     /**
      * @brief Imrpime mensagem de erro no console.
@@ -0,0 +1,145 @@
+#include "session_table.h"
+
+uint32_t UsernameArena::intern(std::string_view name)
+{
+    name = name.substr(0, MAX_USERNAME_SIZE);
+
+    const auto found = _index.find(name);
+    if (found != _index.end())
+    {
+        _names[found->second].references++;
+        return found->second;
+    }
+
+    // Reaproveita o menor espaço liberado em que o nome cabe
+    uint32_t handle = static_cast<uint32_t>(_names.size());
+    for (size_t capacity = name.size(); capacity <= MAX_USERNAME_SIZE; capacity++)
+    {
+        if (!_free[capacity].empty())
+        {
+            handle = _free[capacity].back();
+            _free[capacity].pop_back();
+            break;
+        }
+    }
+
+    if (handle == _names.size())
+    {
+        // Nomes têm no máximo `MAX_USERNAME_SIZE` bytes, sempre menores que um bloco
+        if (_used + name.size() > ARENA_BLOCK_SIZE)
+        {
+            _blocks.push_back(std::make_unique<char[]>(ARENA_BLOCK_SIZE));
+            _used = 0;
+        }
+
+        _names.push_back({_blocks.back().get() + _used, 0, static_cast<uint8_t>(name.size()), 0});
+        _used += name.size();
+    }
+
+    Name &entry = _names[handle];
+    memcpy(entry.data, name.data(), name.size());
+    entry.size = static_cast<uint8_t>(name.size());
+    entry.references = 1;
+    _index.emplace(get(handle), handle);
+
+    return handle;
+}
+
+void UsernameArena::release(uint32_t handle)
+{
+    Name &entry = _names[handle];
+
+    if (entry.references == 0 || --entry.references > 0)
+        return;
+
+    _index.erase(get(handle));
+    _free[entry.capacity].push_back(handle);
+}
+
+SessionTable::Session* SessionTable::find(int clientID)
+{
+    return const_cast<Session*>(static_cast<const SessionTable*>(this)->find(clientID));
+}
+
+const SessionTable::Session* SessionTable::find(int clientID) const
+{
+    const auto slot = _slots.find(clientID);
+    return slot != _slots.end() ? &_sessions[slot->second] : nullptr;
+}
+
+SessionTable::Session* SessionTable::add(int clientID, const sockaddr_in &address,
+                                         std::string_view username, bool compression)
+{
+    if (clientID <= 0)
+        return nullptr;
+
+    const auto found = _slots.find(clientID);
+    Session *session;
+
+    if (found != _slots.end())
+    {
+        session = &_sessions[found->second];
+        _names.release(session->username);
+    }
+    else
+    {
+        _slots.emplace(clientID, static_cast<uint32_t>(_sessions.size()));
+        session = &_sessions.emplace_back();
+    }
+
+    *session = Session{};
+    session->id = clientID;
+    session->username = _names.intern(username.substr(0, MAX_USERNAME_SIZE));
+    session->address = address;
+    session->compression = compression;
+
+    return session;
+}
+
+bool SessionTable::remove(int clientID)
+{
+    const auto found = _slots.find(clientID);
+    if (found == _slots.end())
+        return false;
+
+    uint32_t slot = found->second;
+    _names.release(_sessions[slot].username);
+    _slots.erase(found);
+
+    // A última sessão ocupa a posição liberada
+    if (slot + 1 != _sessions.size())
+    {
+        _sessions[slot] = std::move(_sessions.back());
+        _slots[_sessions[slot].id] = slot;
+    }
+
+    _sessions.pop_back();
+    return true;
+}
+
+void SessionTable::clear()
+{
+    _sessions.clear();
+    _slots.clear();
+    _names = UsernameArena();
+}
+
+ClientInfo SessionTable::info(const Session &session) const
+{
+    ClientInfo client;
+    client.address = session.address;
+    client.setUsername(username(session));
+    client.compression = session.compression;
+    client.encrypted = session.channel != nullptr || session.rekey;
+
+    // O segredo é o da primeira troca, guardado no canal ou na troca pendente
+    const unsigned char *resume = session.rekey ? session.rekey->resume
+                                : session.channel ? session.channel->resumeKey() : nullptr;
+    if (resume)
+    {
+        memcpy(client.resume, resume, SEAL_KEY_SIZE);
+        client.resumable = true;
+    }
+
+    return client;
+}
@@ -0,0 +1,287 @@
+#ifndef SESSION_TABLE_H
+#define SESSION_TABLE_H
+
+#include "../include/message.h"
+#include <algorithm>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#define ARENA_BLOCK_SIZE 4096   /** Tamanho de cada bloco do arena de nomes */
+
+#define RATE_LIMIT_PER_SECOND 20        /** Mensagens por segundo sustentadas por sessão */
+#define RATE_LIMIT_BURST 40             /** Mensagens aceitas em rajada */
+#define RATE_LIMIT_MUTE_AFTER 3         /** Estouros seguidos até o silêncio temporário */
+#define RATE_LIMIT_MUTE_MS 30000        /** Duração do silêncio temporário */
+#define RATE_LIMIT_DISCONNECT_AFTER 3   /** Silêncios até a desconexão */
+#define RATE_LIMIT_FORGIVE_MS 60000     /** Tempo sem estouros que zera a contagem */
+
+/**
+ * @brief Balde de fichas de uma sessão, com punições progressivas.
+ *
+ * Cada mensagem consome uma ficha (em milésimos, para repor frações) e o
+ *     balde se enche a `perSecond` fichas por segundo até `burst`. Cada
+ *     sequência de mensagens sem ficha é um estouro: após `muteAfter`
+ *     estouros a sessão é silenciada por `muteMs` e, após `disconnectAfter`
+ *     silêncios, desconectada. É um registro de tamanho fixo guardado na
+ *     própria sessão; os limites (`Policy`) são do servidor e podem mudar com
+ *     ele rodando.
+ */
+struct RateLimit {
+    /// Resultado da admissão de uma mensagem
+    enum Verdict : uint8_t
+    {
+        ALLOW,          /** Mensagem aceita */
+        THROTTLE,       /** Primeira mensagem recusada de um estouro (avisar o cliente) */
+        DROP,           /** Recusada silenciosamente (estouro ou silêncio em curso) */
+        MUTE,           /** Sessão acaba de ser silenciada (avisar o cliente) */
+        DISCONNECT      /** Sessão deve ser desconectada */
+    };
+
+    /// Limites aplicados a todas as sessões
+    struct Policy {
+        uint32_t perSecond = RATE_LIMIT_PER_SECOND;         /** Fichas repostas por segundo */
+        uint32_t burst = RATE_LIMIT_BURST;                  /** Capacidade do balde */
+        uint8_t muteAfter = RATE_LIMIT_MUTE_AFTER;          /** Estouros até o silêncio */
+        uint32_t muteMs = RATE_LIMIT_MUTE_MS;               /** Duração do silêncio */
+        uint8_t disconnectAfter = RATE_LIMIT_DISCONNECT_AFTER;  /** Silêncios até a desconexão */
+        uint32_t forgiveMs = RATE_LIMIT_FORGIVE_MS;         /** Tempo sem estouros que zera a contagem */
+    };
+
+    uint32_t tokens = 0;                        /** Fichas disponíveis, em milésimos (balde cheio na primeira mensagem) */
+    uint32_t refilledAt = 0;                    /** Última reposição (ms desde o início do servidor) */
+    uint32_t mutedUntil = 0;                    /** Fim do silêncio em curso (ms, 0 = nenhum) */
+    uint32_t lastViolation = 0;                 /** Último estouro (ms) */
+    uint8_t violations = 0;                     /** Estouros desde o último perdão ou silêncio */
+    uint8_t mutes = 0;                          /** Silêncios aplicados nesta sessão */
+    bool throttled = false;                     /** A última mensagem foi recusada */
+
+    /**
+     * @brief Decide se uma mensagem pode ser aceita.
+     *
+     * @param now Instante atual em milissegundos (relógio monotônico)
+     * @param policy Limites em vigor
+     */
+    Verdict admit(uint32_t now, const Policy &policy)
+    {
+        if (refilledAt == 0)
+        {
+            refilledAt = now;
+            tokens = policy.burst * 1000;
+        }
+
+        uint64_t refill = static_cast<uint64_t>(now - refilledAt) * policy.perSecond;
+        tokens = static_cast<uint32_t>(std::min<uint64_t>(tokens + refill, policy.burst * 1000ULL));
+        refilledAt = now;
+
+        if (mutedUntil != 0)
+        {
+            if (static_cast<int32_t>(mutedUntil - now) > 0)
+                return DROP;
+
+            mutedUntil = 0;
+        }
+
+        if (tokens >= 1000)
+        {
+            tokens -= 1000;
+            throttled = false;
+            return ALLOW;
+        }
+
+        if (throttled)
+            return DROP;
+
+        throttled = true;
+
+        if (violations > 0 && now - lastViolation > policy.forgiveMs)
+            violations = 0;
+
+        lastViolation = now;
+
+        if (++violations < policy.muteAfter)
+            return THROTTLE;
+
+        violations = 0;
+
+        if (++mutes >= policy.disconnectAfter)
+            return DISCONNECT;
+
+        mutedUntil = now + policy.muteMs;
+        return MUTE;
+    }
+};
+
+/**
+ * @brief Arena de nomes de usuário internados.
+ *
+ * Cada nome distinto é copiado uma única vez para blocos que nunca são
+ *     movidos e passa a ser referenciado por um handle de 32 bits. Os nomes
+ *     têm contagem de referências: quando a última sessão que usa um nome sai,
+ *     o handle e o espaço dele voltam para listas livres separadas por
+ *     tamanho e são reaproveitados pelo próximo nome que couber.
+ */
+class UsernameArena
+{
+public:
+    /**
+     * @brief Interna um nome de usuário e adiciona uma referência a ele.
+     *
+     * @return uint32_t Handle do nome (o mesmo para nomes iguais)
+     */
+    uint32_t intern(std::string_view);
+
+    /**
+     * @brief Remove uma referência; sem referências, o nome é liberado.
+     */
+    void release(uint32_t);
+
+    /**
+     * @brief Obtém o nome referenciado por um handle.
+     */
+    std::string_view get(uint32_t handle) const { return {_names[handle].data, _names[handle].size}; }
+
+    /**
+     * @brief Quantidade de nomes em uso.
+     */
+    size_t size() const { return _index.size(); }
+
+private:
+    /// Nome internado e o espaço reservado para ele no bloco
+    struct Name {
+        char *data;             /** Início do espaço no bloco */
+        uint8_t size;           /** Tamanho do nome */
+        uint8_t capacity;       /** Bytes reservados no bloco */
+        uint32_t references;    /** Sessões que usam o nome */
+    };
+
+    std::vector<std::unique_ptr<char[]>> _blocks;         /** Blocos de `ARENA_BLOCK_SIZE` bytes */
+    size_t _used = ARENA_BLOCK_SIZE;                      /** Bytes ocupados no último bloco */
+    std::vector<Name> _names;                             /** Nomes por handle */
+    std::vector<uint32_t> _free[MAX_USERNAME_SIZE + 1];   /** Handles livres por capacidade */
+    std::unordered_map<std::string_view, uint32_t> _index; /** Nome -> handle */
+};
+
+/**
+ * @brief Tabela de sessões dos clientes locais.
+ *
+ * As sessões ficam em um vetor denso de registros de tamanho fixo, sem
+ *     posições vazias: o broadcast é uma varredura linear, sem nós de hash nem
+ *     strings por sessão. Os IDs continuam crescentes e nunca são reutilizados;
+ *     um índice ID -> posição resolve as buscas. Ao remover uma sessão, a
+ *     última do vetor ocupa a posição dela, de modo que o vetor acompanha as
+ *     sessões ativas, e não o total de conexões desde o início.
+ *
+ * Ponteiros para sessões valem até a próxima remoção.
+ *
+ * Não é thread-safe: o servidor a protege com o mutex de clientes.
+ */
+class SessionTable
+{
+public:
+    /**
+     * @brief Nova troca de chaves de uma sessão cifrada restaurada.
+     *
+     * Existe da restauração até o primeiro datagrama aberto com o canal
+     *     novo; o desafio não muda nesse intervalo, e só um OI provado com ele
+     *     e com o segredo de retomada refaz o canal.
+     */
+    struct Rekey {
+        unsigned char resume[SEAL_KEY_SIZE];    /** Segredo de retomada da sessão */
+        uint64_t challenge;                     /** Desafio dos pedidos ao cliente */
+        uint32_t asked;                         /** Último pedido (ms desde o início do servidor) */
+        uint8_t tries;                          /** Pedidos periódicos já enviados (limite `REKEY_ATTEMPTS`) */
+    };
+
+    /**
+     * @brief Sessão de um cliente.
+     */
+    struct Session {
+        int32_t id;             /** ID do cliente */
+        uint32_t username;      /** Handle do nome no `UsernameArena` */
+        sockaddr_in address;    /** Endereço do cliente */
+        SequenceWindow window;  /** Janela de deduplicação das mensagens do cliente */
+        RateLimit rate;         /** Limite de mensagens do cliente */
+        bool compression;       /** Cliente aceita mensagens comprimidas (negociado no OI) */
+        bool multicast;         /** Recebe os broadcasts pelo grupo multicast (adesão confirmada) */
+        std::shared_ptr<SecureChannel> channel; /** Canal cifrado (nulo = em claro ou restaurada); não é persistido */
+        std::unique_ptr<Rekey> rekey;           /** Nova troca de chaves pendente (nulo = nenhuma) */
+
+        /// Sessão cifrada ainda sem canal: nada pode ser enviado a ela
+        bool keyless() const { return rekey && !channel; }
+    };
+
+    /**
+     * @brief Busca a sessão de um ID.
+     *
+     * @return Session* Sessão, ou `nullptr` se o ID não está conectado
+     */
+    Session* find(int);
+    const Session* find(int) const;
+
+    /**
+     * @brief Cria (ou substitui) a sessão de um ID.
+     *
+     * @return Session* Sessão criada, ou `nullptr` se o ID é inválido
+     */
+    Session* add(int, const sockaddr_in&, std::string_view, bool);
+
+    /**
+     * @brief Remove a sessão de um ID.
+     *
+     * @retval `true` Se a sessão existia
+     */
+    bool remove(int);
+
+    /**
+     * @brief Remove todas as sessões.
+     */
+    void clear();
+
+    /**
+     * @brief Quantidade de sessões ativas.
+     */
+    size_t size() const { return _sessions.size(); }
+
+    /**
+     * @brief Nome de usuário de uma sessão.
+     */
+    std::string_view username(const Session &session) const { return _names.get(session.username); }
+
+    /**
+     * @brief Copia uma sessão para o formato usado na replicação e no snapshot.
+     */
+    ClientInfo info(const Session&) const;
+
+    /**
+     * @brief Percorre as sessões ativas.
+     *
+     * @param visit Chamada com cada `const Session&`
+     */
+    template <typename Visitor>
+    void forEach(Visitor visit) const
+    {
+        for (const Session &session : _sessions)
+            visit(session);
+    }
+
+    /**
+     * @brief Percorre as sessões ativas, permitindo alterá-las (mas não removê-las).
+     *
+     * @param visit Chamada com cada `Session&`
+     */
+    template <typename Visitor>
+    void forEach(Visitor visit)
+    {
+        for (Session &session : _sessions)
+            visit(session);
+    }
+
+private:
+    std::vector<Session> _sessions;   /** Sessões ativas, sem posições vazias */
+    std::unordered_map<int, uint32_t> _slots; /** ID -> posição em `_sessions` */
+    UsernameArena _names;             /** Nomes de usuário internados */
+};
+
+#endif
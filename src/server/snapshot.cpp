@@ -0,0 +1,286 @@
+#include "snapshot.h"
+#include <iostream>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char SNAPSHOT_MAGIC[4] = {'M', 'T', 'W', 'S'};
+
+// Mapeia um arquivo inteiro para leitura; devolve nullptr se vazio ou inexistente
+static const char* mapFile(const std::string &path, size_t &size)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat info;
+    const char *data = nullptr;
+
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        void *map = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED)
+        {
+            data = static_cast<const char*>(map);
+            size = info.st_size;
+        }
+    }
+
+    close(fd);
+    return data;
+}
+
+SessionStore::SessionStore(const std::string &path)
+    : _path(path), _journalPath(path + ".journal"), _journalFd(-1), _running(false)
+{
+}
+
+SessionStore::~SessionStore()
+{
+    _running = false;
+
+    if (_thread.joinable())
+        _thread.join();
+
+    if (_journalFd >= 0)
+        close(_journalFd);
+}
+
+bool SessionStore::load(std::unordered_map<int, ClientInfo> &clients, int &idCount)
+{
+    bool found = false;
+    size_t size = 0;
+    const char *data = mapFile(_path, size);
+
+    if (data)
+    {
+        Header header;
+        memcpy(&header, data, std::min(size, sizeof(header)));
+
+        if (size >= sizeof(header) && memcmp(header.magic, SNAPSHOT_MAGIC, 4) == 0 &&
+            header.version == SNAPSHOT_VERSION && header.recordSize == sizeof(SessionRecord) &&
+            header.count <= (size - sizeof(header)) / sizeof(SessionRecord))
+        {
+            const char *records = data + sizeof(header);
+
+            for (uint64_t i = 0; i < header.count; i++)
+            {
+                SessionRecord record;
+                memcpy(&record, records + i * sizeof(record), sizeof(record));
+                clients[record.id] = fromRecord(record);
+            }
+
+            idCount = std::max(idCount, static_cast<int>(header.idCount));
+            found = true;
+        }
+        else
+        {
+            std::cerr << "Snapshot inválido ignorado: " << _path << std::endl;
+        }
+
+        munmap(const_cast<char*>(data), size);
+    }
+
+    // Um checkpoint interrompido deixa o journal anterior, que vem primeiro
+    size_t before = clients.size();
+    replay(_journalPath + ".old", clients, idCount);
+    replay(_journalPath, clients, idCount);
+    found = found || clients.size() != before;
+
+    // Compacta: o estado carregado vira o novo snapshot e o journal recomeça
+    std::lock_guard<std::mutex> lock(_journalMutex);
+
+    if (writeSnapshot(clients, idCount))
+    {
+        unlink((_journalPath + ".old").c_str());
+        _journalFd = open(_journalPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_TRUNC, 0600);
+    }
+    else
+    {
+        _journalFd = open(_journalPath.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0600);
+    }
+
+    if (_journalFd < 0)
+        std::cerr << "Falha ao abrir o journal: " << _journalPath << std::endl;
+
+    return found;
+}
+
+void SessionStore::replay(const std::string &path, std::unordered_map<int, ClientInfo> &clients, int &idCount)
+{
+    size_t size = 0;
+    const char *data = mapFile(path, size);
+
+    if (!data)
+        return;
+
+    // Uma entrada incompleta no fim (escrita interrompida) é ignorada
+    for (size_t offset = 0; offset + sizeof(JournalEntry) <= size; offset += sizeof(JournalEntry))
+    {
+        JournalEntry entry;
+        memcpy(&entry, data + offset, sizeof(entry));
+
+        if (entry.version != SNAPSHOT_VERSION)
+            break;
+
+        if (entry.op == 'A')
+            clients[entry.record.id] = fromRecord(entry.record);
+        else if (entry.op == 'D')
+            clients.erase(entry.record.id);
+
+        idCount = std::max(idCount, static_cast<int>(entry.idCount));
+    }
+
+    munmap(const_cast<char*>(data), size);
+}
+
+void SessionStore::start(StateCallback state)
+{
+    _state = std::move(state);
+    _running = true;
+
+    _thread = std::thread([this]() {
+        auto last = std::chrono::steady_clock::now();
+
+        while (_running)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+            if (std::chrono::steady_clock::now() - last >= std::chrono::seconds(SNAPSHOT_INTERVAL))
+            {
+                checkpoint();
+                last = std::chrono::steady_clock::now();
+            }
+        }
+    });
+}
+
+void SessionStore::journalAdd(int clientID, const ClientInfo &client, int idCount)
+{
+    JournalEntry entry = {};
+    entry.op = 'A';
+    entry.version = SNAPSHOT_VERSION;
+    entry.idCount = idCount;
+    entry.record = toRecord(clientID, client);
+    append(entry);
+}
+
+void SessionStore::journalDelete(int clientID)
+{
+    JournalEntry entry = {};
+    entry.op = 'D';
+    entry.version = SNAPSHOT_VERSION;
+    entry.record.id = clientID;
+    append(entry);
+}
+
+void SessionStore::append(const JournalEntry &entry)
+{
+    std::lock_guard<std::mutex> lock(_journalMutex);
+
+    if (_journalFd >= 0 && write(_journalFd, &entry, sizeof(entry)) != sizeof(entry))
+        std::cerr << "Falha ao escrever no journal: " << _journalPath << std::endl;
+}
+
+void SessionStore::checkpoint()
+{
+    if (!_state)
+        return;
+
+    // O journal é trocado antes da cópia do estado: o que ficar no journal
+    //     antigo já está na cópia, e o que vier depois vai para o novo. Se um
+    //     checkpoint anterior falhou, o journal antigo ainda existe e o atual
+    //     continua recebendo entradas até um snapshot ser gravado
+    std::string old = _journalPath + ".old";
+    {
+        std::lock_guard<std::mutex> lock(_journalMutex);
+
+        if (access(old.c_str(), F_OK) != 0)
+        {
+            if (_journalFd >= 0)
+            {
+                close(_journalFd);
+                rename(_journalPath.c_str(), old.c_str());
+            }
+
+            _journalFd = open(_journalPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_TRUNC, 0600);
+            if (_journalFd < 0)
+                std::cerr << "Falha ao abrir o journal: " << _journalPath << std::endl;
+        }
+    }
+
+    std::unordered_map<int, ClientInfo> clients;
+    int idCount = 0;
+    _state(clients, idCount);
+
+    if (writeSnapshot(clients, idCount))
+        unlink(old.c_str());
+}
+
+bool SessionStore::writeSnapshot(const std::unordered_map<int, ClientInfo> &clients, int idCount)
+{
+    Header header = {};
+    memcpy(header.magic, SNAPSHOT_MAGIC, 4);
+    header.version = SNAPSHOT_VERSION;
+    header.recordSize = sizeof(SessionRecord);
+    header.idCount = idCount;
+    header.count = clients.size();
+
+    std::vector<char> buffer(sizeof(header) + clients.size() * sizeof(SessionRecord));
+    memcpy(buffer.data(), &header, sizeof(header));
+
+    size_t offset = sizeof(header);
+    for (const auto &client : clients)
+    {
+        SessionRecord record = toRecord(client.first, client.second);
+        memcpy(buffer.data() + offset, &record, sizeof(record));
+        offset += sizeof(record);
+    }
+
+    // Escreve em um temporário e renomeia: o snapshot anterior vale até o fim
+    std::string temporary = _path + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+    if (fd < 0 || write(fd, buffer.data(), buffer.size()) != static_cast<ssize_t>(buffer.size()) ||
+        fsync(fd) < 0)
+    {
+        std::cerr << "Falha ao gravar o snapshot: " << _path << std::endl;
+
+        if (fd >= 0)
+            close(fd);
+
+        return false;
+    }
+
+    close(fd);
+    return rename(temporary.c_str(), _path.c_str()) == 0;
+}
+
+SessionRecord SessionStore::toRecord(int clientID, const ClientInfo &client)
+{
+    SessionRecord record = {};
+    record.id = clientID;
+    record.address = client.address.sin_addr.s_addr;
+    record.port = client.address.sin_port;
+    record.flags = (client.compression ? 1 : 0) | (client.encrypted ? 2 : 0) | (client.resumable ? 4 : 0);
+    memcpy(record.username, client.username, sizeof(record.username));
+    memcpy(record.resume, client.resume, sizeof(record.resume));
+    return record;
+}
+
+ClientInfo SessionStore::fromRecord(const SessionRecord &record)
+{
+    ClientInfo client;
+    memset(&client.address, 0, sizeof(client.address));
+    client.address.sin_family = AF_INET;
+    client.address.sin_addr.s_addr = record.address;
+    client.address.sin_port = record.port;
+    client.compression = record.flags & 1;
+    client.encrypted = record.flags & 2;
+    client.resumable = record.flags & 4;
+    memcpy(client.resume, record.resume, sizeof(client.resume));
+    client.setUsername(std::string_view(record.username, strnlen(record.username, MAX_USERNAME_SIZE)));
+    return client;
+}
@@ -0,0 +1,152 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "../include/message.h"
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#define SNAPSHOT_VERSION 2          /** Versão do formato do snapshot e do journal */
+#define SNAPSHOT_INTERVAL 30        /** Intervalo entre checkpoints (segundos) */
+
+/**
+ * @brief Registro de uma sessão no snapshot e no journal.
+ *
+ * Tamanho fixo, na ordem de bytes do host (o arquivo é local); endereço e
+ *     porta ficam em ordem de rede, como no `sockaddr_in`. Leva o segredo de
+ *     retomada das sessões cifradas, por isso os arquivos são criados só com
+ *     permissão para o dono.
+ */
+struct SessionRecord {
+    int32_t id;                             /** ID do cliente */
+    uint32_t address;                       /** IP do cliente */
+    uint16_t port;                          /** Porta do cliente */
+    uint8_t flags;                          /** 1 = aceita compressão, 2 = sessão cifrada, 4 = `resume` válido */
+    char username[MAX_USERNAME_SIZE + 1];   /** Nome de usuário */
+    unsigned char resume[SEAL_KEY_SIZE];    /** Segredo de retomada da sessão cifrada */
+};
+
+static_assert(sizeof(SessionRecord) == 64, "SessionRecord deve ter 64 bytes");
+
+/**
+ * @brief Persistência da tabela de sessões do servidor.
+ *
+ * O estado é gravado periodicamente em um snapshot binário versionado
+ *     (cabeçalho + registros de tamanho fixo) e, entre snapshots, cada mudança
+ *     é acrescentada a um journal. Na inicialização o snapshot e o journal são
+ *     mapeados com `mmap` e aplicados, de modo que um reinício preserva IDs e
+ *     sessões sem que os clientes percebam.
+ *
+ * Para um checkpoint, o journal atual é renomeado para `<arquivo>.journal.old`
+ *     e outro é aberto; o snapshot é escrito em um arquivo temporário e
+ *     renomeado, e só então o journal antigo é apagado. Reaplicar entradas já
+ *     contidas no snapshot não altera o resultado.
+ */
+class SessionStore
+{
+public:
+    /// Copia o estado do servidor (clientes e contador de IDs)
+    using StateCallback = std::function<void(std::unordered_map<int, ClientInfo>&, int&)>;
+
+    /**
+     * @brief Construtor da classe SessionStore.
+     *
+     * @param path Caminho do snapshot (o journal usa o mesmo nome + `.journal`)
+     */
+    SessionStore(const std::string&);
+
+    /// Destrutor
+    ~SessionStore();
+
+    /**
+     * @brief Carrega o snapshot e aplica o journal.
+     *
+     * @param clients Recebe as sessões
+     * @param idCount Recebe o contador de IDs
+     *
+     * @retval `true` Se havia estado salvo
+     * @retval `false` Se não havia arquivos (ou estavam inválidos)
+     */
+    bool load(std::unordered_map<int, ClientInfo>&, int&);
+
+    /**
+     * @brief Inicia os checkpoints periódicos.
+     *
+     * @param state Copia o estado do servidor; chamado com o mesmo lock que
+     *     protege `journalAdd`/`journalDelete`
+     */
+    void start(StateCallback);
+
+    /**
+     * @brief Registra a adição (ou atualização) de um cliente no journal.
+     */
+    void journalAdd(int, const ClientInfo&, int);
+
+    /**
+     * @brief Registra a remoção de um cliente no journal.
+     */
+    void journalDelete(int);
+
+    /**
+     * @brief Grava um snapshot do estado atual.
+     */
+    void checkpoint();
+
+private:
+    /**
+     * @brief Cabeçalho do snapshot
+     */
+    struct Header {
+        char magic[4];          /** "MTWS" */
+        uint32_t version;       /** `SNAPSHOT_VERSION` */
+        uint32_t recordSize;    /** `sizeof(SessionRecord)` */
+        int32_t idCount;        /** Contador de IDs */
+        uint64_t count;         /** Quantidade de registros */
+    };
+
+    /**
+     * @brief Entrada do journal
+     */
+    struct JournalEntry {
+        uint8_t op;             /** 'A' adição, 'D' remoção */
+        uint8_t version;        /** `SNAPSHOT_VERSION` */
+        uint8_t padding[2];
+        int32_t idCount;        /** Contador de IDs após a mudança */
+        SessionRecord record;   /** Sessão afetada */
+    };
+
+    std::string _path;                    /** Caminho do snapshot */
+    std::string _journalPath;             /** Caminho do journal */
+    int _journalFd;                       /** Descritor do journal aberto */
+    std::mutex _journalMutex;             /** Protege `_journalFd` */
+    std::atomic<bool> _running;           /** Flag da thread de checkpoint */
+    std::thread _thread;                  /** Thread de checkpoint */
+    StateCallback _state;                 /** Copia o estado do servidor */
+
+    /**
+     * @brief Escreve uma entrada no journal.
+     */
+    void append(const JournalEntry&);
+
+    /**
+     * @brief Aplica um journal mapeado em memória.
+     */
+    void replay(const std::string&, std::unordered_map<int, ClientInfo>&, int&);
+
+    /**
+     * @brief Grava o snapshot em um temporário e o renomeia sobre o atual.
+     *
+     * @retval `true` Se o novo snapshot substituiu o anterior
+     * @retval `false` Se a gravação falhou (o anterior continua valendo)
+     */
+    bool writeSnapshot(const std::unordered_map<int, ClientInfo>&, int);
+
+    static SessionRecord toRecord(int, const ClientInfo&);
+    static ClientInfo fromRecord(const SessionRecord&);
+};
+
+#endif
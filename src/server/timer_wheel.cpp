@@ -0,0 +1,210 @@
+#include "timer_wheel.h"
+#include <algorithm>
+
+TimerWheel::TimerWheel(int64_t now) : _free(NONE), _current(tick(now)), _size(0)
+{
+    std::fill(std::begin(_heads), std::end(_heads), NONE);
+}
+
+uint32_t TimerWheel::insert(ScheduledTweet &&tweet, bool keepTicket)
+{
+    uint32_t index;
+
+    if (keepTicket)
+    {
+        index = tweet.ticket & (TIMER_WHEEL_CAPACITY - 1);
+
+        if (tweet.ticket == 0)
+            return 0;
+
+        // O vetor cresce até a posição do ticket; as intermediárias ficam livres
+        while (_nodes.size() <= index)
+        {
+            _nodes.emplace_back();
+            _nodes.back().used = false;
+            _nodes.back().generation = 0;
+            release(static_cast<uint32_t>(_nodes.size() - 1));
+        }
+
+        if (_nodes[index].used)
+            return 0;
+
+        _nodes[index].generation = static_cast<uint16_t>(tweet.ticket >> TIMER_WHEEL_INDEX_BITS);
+    }
+    else
+    {
+        if (_free == NONE)
+        {
+            if (_nodes.size() >= TIMER_WHEEL_CAPACITY)
+                return 0;
+
+            _nodes.emplace_back();
+            _nodes.back().used = false;
+            _nodes.back().generation = 0;
+            release(static_cast<uint32_t>(_nodes.size() - 1));
+        }
+
+        index = _free;
+
+        // Tickets positivos e diferentes de zero: gerações de 1 a 511
+        Node &node = _nodes[index];
+        node.generation = static_cast<uint16_t>(node.generation % 511 + 1);
+        tweet.ticket = makeTicket(index, node.generation);
+    }
+
+    // Sai da lista de livres
+    Node &node = _nodes[index];
+
+    if (node.prev != NONE)
+        _nodes[node.prev].next = node.next;
+    else
+        _free = node.next;
+
+    if (node.next != NONE)
+        _nodes[node.next].prev = node.prev;
+
+    node.expires = std::max(tick(tweet.when), _current);
+    node.tweet = std::move(tweet);
+    node.used = true;
+    _size++;
+
+    link(index);
+    return node.tweet.ticket;
+}
+
+bool TimerWheel::cancel(uint32_t ticket, int32_t origin)
+{
+    uint32_t index = ticket & (TIMER_WHEEL_CAPACITY - 1);
+
+    if (index >= _nodes.size())
+        return false;
+
+    Node &node = _nodes[index];
+
+    if (!node.used || node.tweet.ticket != ticket || node.tweet.origin != origin)
+        return false;
+
+    unlink(index);
+    release(index);
+    _size--;
+
+    return true;
+}
+
+void TimerWheel::advance(int64_t now, const Expired &expired)
+{
+    uint64_t target = tick(now);
+
+    while (_current <= target)
+    {
+        // Sem itens, não há o que descer nem entregar até o horário atual
+        if (_size == 0)
+        {
+            _current = target + 1;
+            return;
+        }
+
+        // Do nível mais alto para o mais baixo: o que desce de um nível pode
+        //     cair na posição que o nível de baixo processa neste mesmo tick
+        for (int level = TIMER_WHEEL_LEVELS - 1; level > 0; level--)
+        {
+            if ((_current & ((1ULL << (TIMER_WHEEL_BITS * level)) - 1)) == 0)
+                cascade(level);
+        }
+
+        uint32_t &head = _heads[_current & (TIMER_WHEEL_SLOTS - 1)];
+        uint32_t index = head;
+        head = NONE;
+
+        while (index != NONE)
+        {
+            uint32_t next = _nodes[index].next;
+            ScheduledTweet tweet = std::move(_nodes[index].tweet);
+
+            release(index);
+            _size--;
+
+            expired(std::move(tweet));
+            index = next;
+        }
+
+        _current++;
+    }
+}
+
+void TimerWheel::forEach(const std::function<void(const ScheduledTweet&)> &visit) const
+{
+    for (const auto &node : _nodes)
+    {
+        if (node.used)
+            visit(node.tweet);
+    }
+}
+
+void TimerWheel::link(uint32_t index)
+{
+    Node &node = _nodes[index];
+    uint64_t delta = node.expires - _current;
+    uint64_t placed = node.expires;
+    int level = 0;
+
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1ULL << (TIMER_WHEEL_BITS * (level + 1))))
+        level++;
+
+    // Além do alcance da roda: última posição, recolocado a cada volta
+    if (delta >= (1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)))
+        placed = _current + (1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+
+    node.slot = static_cast<uint16_t>(level * TIMER_WHEEL_SLOTS +
+                                      ((placed >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1)));
+    node.prev = NONE;
+    node.next = _heads[node.slot];
+
+    if (node.next != NONE)
+        _nodes[node.next].prev = index;
+
+    _heads[node.slot] = index;
+}
+
+void TimerWheel::unlink(uint32_t index)
+{
+    Node &node = _nodes[index];
+
+    if (node.prev != NONE)
+        _nodes[node.prev].next = node.next;
+    else
+        _heads[node.slot] = node.next;
+
+    if (node.next != NONE)
+        _nodes[node.next].prev = node.prev;
+}
+
+void TimerWheel::release(uint32_t index)
+{
+    Node &node = _nodes[index];
+
+    node.used = false;
+    node.tweet = ScheduledTweet();
+    node.prev = NONE;
+    node.next = _free;
+
+    if (_free != NONE)
+        _nodes[_free].prev = index;
+
+    _free = index;
+}
+
+void TimerWheel::cascade(int level)
+{
+    uint32_t &head = _heads[level * TIMER_WHEEL_SLOTS +
+                            ((_current >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1))];
+    uint32_t index = head;
+    head = NONE;
+
+    while (index != NONE)
+    {
+        uint32_t next = _nodes[index].next;
+        link(index);
+        index = next;
+    }
+}
@@ -0,0 +1,152 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include "../include/message.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define TIMER_WHEEL_TICK_MS 10          /** Resolução da roda */
+#define TIMER_WHEEL_BITS 6              /** log2 das posições de cada nível */
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 5            /** Níveis: 64^5 ticks de 10 ms, cerca de 124 dias */
+#define TIMER_WHEEL_INDEX_BITS 22       /** Bits do índice no ticket */
+#define TIMER_WHEEL_CAPACITY (1u << TIMER_WHEEL_INDEX_BITS)  /** Máximo de itens pendentes */
+
+/**
+ * @brief Tweet agendado para entrega futura.
+ */
+struct ScheduledTweet {
+    uint32_t ticket = 0;                        /** Identificador devolvido ao cliente */
+    int64_t when = 0;                           /** Horário de entrega (ms desde 1970) */
+    int32_t origin = 0;                         /** ID do autor */
+    int32_t destination = 0;                    /** Destinatário (0 = todos) */
+    int32_t sequence = 0;                       /** Sequência do pedido no cliente */
+    char username[MAX_USERNAME_SIZE + 1] = {};  /** Nome do autor no momento do agendamento */
+    std::string text;                           /** Texto (até `MAX_TEXT_SIZE`) */
+};
+
+/**
+ * @brief Roda de timers hierárquica.
+ *
+ * Cada nível tem 64 posições; uma posição do nível `n` cobre `64^n` ticks.
+ *     Um item entra no nível mais baixo cujo alcance cobre o seu prazo, e os
+ *     itens de uma posição de nível alto descem (em cascata) quando o tempo a
+ *     alcança. Prazos além do último nível ficam na última posição e são
+ *     recolocados a cada volta.
+ *
+ * Os itens ficam em um vetor com lista de livres e listas duplamente ligadas
+ *     por índice, então inserir e cancelar são O(1) e a memória é limitada a
+ *     `TIMER_WHEEL_CAPACITY` itens. O ticket combina o índice com uma geração,
+ *     para que um ticket antigo não cancele o item que reusou a posição.
+ *
+ * Não é thread-safe.
+ */
+class TimerWheel
+{
+public:
+    /// Recebe os itens vencidos
+    using Expired = std::function<void(ScheduledTweet&&)>;
+
+    /**
+     * @brief Construtor da classe TimerWheel.
+     *
+     * @param now Horário atual (ms desde 1970)
+     */
+    explicit TimerWheel(int64_t);
+
+    /**
+     * @brief Agenda um item.
+     *
+     * O ticket do item é gerado aqui, exceto se `keepTicket` (restauração
+     *     de um item persistido).
+     *
+     * @param tweet Item (o horário pode estar no passado: vence no próximo tick)
+     * @param keepTicket Mantém o ticket já presente em `tweet`
+     *
+     * @return uint32_t Ticket do item, ou 0 se a roda está cheia (ou o ticket
+     *     restaurado está em uso)
+     */
+    uint32_t insert(ScheduledTweet&&, bool = false);
+
+    /**
+     * @brief Cancela um item pendente.
+     *
+     * @param ticket Ticket do item
+     * @param origin Apenas o autor pode cancelar
+     *
+     * @retval `true` Se o item existia, era do autor e foi removido
+     * @retval `false` Caso contrário
+     */
+    bool cancel(uint32_t, int32_t);
+
+    /**
+     * @brief Avança a roda até o horário dado, entregando os itens vencidos.
+     *
+     * @param now Horário atual (ms desde 1970); recuos do relógio são ignorados
+     * @param expired Recebe cada item vencido, em ordem de tick
+     */
+    void advance(int64_t, const Expired&);
+
+    /**
+     * @brief Percorre os itens pendentes (ordem não especificada).
+     */
+    void forEach(const std::function<void(const ScheduledTweet&)>&) const;
+
+    /**
+     * @brief Quantidade de itens pendentes.
+     */
+    size_t size() const { return _size; }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    /**
+     * @brief Posição do vetor de itens.
+     */
+    struct Node {
+        ScheduledTweet tweet;       /** Item agendado */
+        uint64_t expires;           /** Tick de vencimento */
+        uint32_t prev;              /** Anterior na lista da posição (ou na de livres) */
+        uint32_t next;              /** Próximo na lista da posição (ou na de livres) */
+        uint16_t slot;              /** Nível * 64 + posição (para remover da cabeça) */
+        uint16_t generation;        /** Incrementada a cada reuso */
+        bool used;                  /** Item pendente */
+    };
+
+    std::vector<Node> _nodes;                       /** Itens (crescem até a capacidade) */
+    uint32_t _heads[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];  /** Cabeça de cada posição */
+    uint32_t _free;                                 /** Lista de livres */
+    uint64_t _current;                              /** Próximo tick a processar */
+    size_t _size;                                   /** Itens pendentes */
+
+    /**
+     * @brief Coloca um item na posição do seu vencimento.
+     */
+    void link(uint32_t);
+
+    /**
+     * @brief Tira um item da sua posição.
+     */
+    void unlink(uint32_t);
+
+    /**
+     * @brief Devolve uma posição do vetor à lista de livres.
+     */
+    void release(uint32_t);
+
+    /**
+     * @brief Desce os itens de uma posição de nível alto.
+     */
+    void cascade(int);
+
+    static uint64_t tick(int64_t when) { return static_cast<uint64_t>(std::max<int64_t>(when, 0)) / TIMER_WHEEL_TICK_MS; }
+    static uint32_t makeTicket(uint32_t index, uint16_t generation)
+    {
+        return (static_cast<uint32_t>(generation) << TIMER_WHEEL_INDEX_BITS) | index;
+    }
+};
+
+#endif
@@ -0,0 +1,240 @@
+#include "tweet_schedule.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char SCHEDULE_MAGIC[4] = {'M', 'T', 'S', 'C'};
+
+TweetSchedule::TweetSchedule() : _wheel(now()), _fd(-1), _obsolete(0)
+{
+}
+
+TweetSchedule::~TweetSchedule()
+{
+    if (_fd >= 0)
+        close(_fd);
+}
+
+size_t TweetSchedule::enablePersistence(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _path = path;
+
+    std::ifstream file(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::unordered_map<uint32_t, ScheduledTweet> live;
+    uint32_t version = 0;
+
+    if (data.size() >= 8)
+        memcpy(&version, data.data() + 4, sizeof(version));
+
+    if (data.size() >= 8 && memcmp(data.data(), SCHEDULE_MAGIC, 4) == 0 && version == SCHEDULE_VERSION)
+    {
+        // Um registro cortado no fim (queda durante a escrita) é ignorado
+        for (size_t offset = 8; offset + sizeof(ScheduleRecord) <= data.size();)
+        {
+            ScheduleRecord record;
+            memcpy(&record, data.data() + offset, sizeof(record));
+            offset += sizeof(record);
+
+            if (record.op == 'D')
+            {
+                live.erase(record.ticket);
+                continue;
+            }
+
+            if (record.op != 'A' || record.textSize > MAX_TEXT_SIZE || offset + record.textSize > data.size())
+                break;
+
+            ScheduledTweet &tweet = live[record.ticket];
+            tweet.ticket = record.ticket;
+            tweet.when = record.when;
+            tweet.origin = record.origin;
+            tweet.destination = record.destination;
+            tweet.sequence = record.sequence;
+            memcpy(tweet.username, record.username, sizeof(tweet.username));
+            tweet.username[MAX_USERNAME_SIZE] = '\0';
+            tweet.text.assign(data.data() + offset, record.textSize);
+            offset += record.textSize;
+        }
+    }
+    else if (!data.empty())
+    {
+        std::cerr << "Arquivo de agendamentos inválido, ignorado: " << path << std::endl;
+    }
+
+    // Vencidos enquanto o servidor estava parado saem no primeiro tick
+    for (auto &entry : live)
+    {
+        int32_t origin = entry.second.origin;
+
+        if (_wheel.insert(std::move(entry.second), true))
+            _perOrigin[origin]++;
+    }
+
+    compact();
+    return _wheel.size();
+}
+
+TweetSchedule::Result TweetSchedule::add(ScheduledTweet &tweet)
+{
+    int64_t current = now();
+
+    if (tweet.text.empty() || tweet.text.size() > MAX_TEXT_SIZE)
+        return INVALID;
+
+    if (tweet.when < current - SCHEDULE_PAST_TOLERANCE_MS)
+        return PAST;
+
+    if (tweet.when > current + SCHEDULE_MAX_DAYS * 86400000LL)
+        return TOO_FAR;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint32_t &count = _perOrigin[tweet.origin];
+
+    if (count >= SCHEDULE_MAX_PER_CLIENT)
+        return CLIENT_LIMIT;
+
+    ScheduledTweet stored = tweet;
+    tweet.ticket = _wheel.insert(std::move(stored));
+
+    if (tweet.ticket == 0)
+    {
+        if (count == 0)
+            _perOrigin.erase(tweet.origin);
+
+        return FULL;
+    }
+
+    count++;
+    append('A', tweet);
+
+    return SCHEDULED;
+}
+
+bool TweetSchedule::cancel(uint32_t ticket, int32_t origin)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (!_wheel.cancel(ticket, origin))
+        return false;
+
+    if (--_perOrigin[origin] == 0)
+        _perOrigin.erase(origin);
+
+    ScheduledTweet cancelled;
+    cancelled.ticket = ticket;
+    append('D', cancelled);
+
+    return true;
+}
+
+void TweetSchedule::collect(int64_t current, std::vector<ScheduledTweet> &due)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _wheel.advance(current, [this, &due](ScheduledTweet &&tweet) {
+        auto count = _perOrigin.find(tweet.origin);
+
+        if (count != _perOrigin.end() && --count->second == 0)
+            _perOrigin.erase(count);
+
+        append('D', tweet);
+        due.push_back(std::move(tweet));
+    });
+
+    if (_obsolete >= SCHEDULE_COMPACT_MIN && _obsolete > _wheel.size())
+        compact();
+}
+
+size_t TweetSchedule::pending()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _wheel.size();
+}
+
+int64_t TweetSchedule::now()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void TweetSchedule::append(char op, const ScheduledTweet &tweet)
+{
+    if (_fd < 0)
+        return;
+
+    // Registro e texto em uma única escrita, para não intercalar com outra
+    char buffer[sizeof(ScheduleRecord) + MAX_TEXT_SIZE];
+    ScheduleRecord record = {};
+    record.op = static_cast<uint8_t>(op);
+    record.ticket = tweet.ticket;
+
+    if (op == 'A')
+    {
+        record.textSize = static_cast<uint8_t>(tweet.text.size());
+        record.when = tweet.when;
+        record.origin = tweet.origin;
+        record.destination = tweet.destination;
+        record.sequence = tweet.sequence;
+        memcpy(record.username, tweet.username, sizeof(record.username));
+    }
+    else
+    {
+        // O 'D' e o 'A' correspondente deixam de descrever um pendente
+        _obsolete += 2;
+    }
+
+    memcpy(buffer, &record, sizeof(record));
+    memcpy(buffer + sizeof(record), tweet.text.data(), record.textSize);
+
+    ssize_t size = static_cast<ssize_t>(sizeof(record) + record.textSize);
+
+    if (write(_fd, buffer, size) != size)
+        std::cerr << "Falha ao escrever no arquivo de agendamentos: " << _path << std::endl;
+}
+
+void TweetSchedule::compact()
+{
+    if (_path.empty())
+        return;
+
+    std::string temporary = _path + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd >= 0)
+    {
+        char header[8];
+        uint32_t version = SCHEDULE_VERSION;
+        memcpy(header, SCHEDULE_MAGIC, 4);
+        memcpy(header + 4, &version, sizeof(version));
+
+        bool written = write(fd, header, sizeof(header)) == sizeof(header);
+
+        // O arquivo novo recebe os pendentes e passa a receber os acréscimos
+        std::swap(fd, _fd);
+        _wheel.forEach([this, &written](const ScheduledTweet &tweet) {
+            if (written)
+                append('A', tweet);
+        });
+        std::swap(fd, _fd);
+
+        if (written && fsync(fd) == 0 && rename(temporary.c_str(), _path.c_str()) == 0)
+        {
+            if (_fd >= 0)
+                close(_fd);
+
+            _fd = fd;
+            _obsolete = 0;
+            return;
+        }
+
+        close(fd);
+    }
+
+    // Sem o arquivo compactado, continua acrescentando ao atual (se houver)
+    std::cerr << "Falha ao compactar o arquivo de agendamentos: " << _path << std::endl;
+}
@@ -0,0 +1,130 @@
+#ifndef TWEET_SCHEDULE_H
+#define TWEET_SCHEDULE_H
+
+#include "timer_wheel.h"
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define SCHEDULE_VERSION 1                  /** Versão do formato do arquivo de agendamentos */
+#define SCHEDULE_MAX_PER_CLIENT 100         /** Agendamentos pendentes por autor */
+#define SCHEDULE_MAX_DAYS 365               /** Maior antecedência aceita */
+#define SCHEDULE_PAST_TOLERANCE_MS 5000     /** Atraso aceito (relógios levemente dessincronizados) */
+#define SCHEDULE_COMPACT_MIN 4096           /** Registros obsoletos antes de compactar o arquivo */
+
+/**
+ * @brief Registro do arquivo de agendamentos, seguido de `textSize` bytes de texto.
+ *
+ * Na ordem de bytes do host (o arquivo é local).
+ */
+struct ScheduleRecord {
+    uint8_t op;                             /** 'A' agendado, 'D' entregue ou cancelado */
+    uint8_t textSize;                       /** Bytes de texto após o registro */
+    uint8_t reserved[2];                    /** Sempre zero */
+    uint32_t ticket;                        /** Ticket do agendamento */
+    int64_t when;                           /** Horário de entrega (ms desde 1970) */
+    int32_t origin;                         /** ID do autor */
+    int32_t destination;                    /** Destinatário (0 = todos) */
+    int32_t sequence;                       /** Sequência do pedido no cliente */
+    char username[MAX_USERNAME_SIZE + 1];   /** Nome do autor */
+    char padding[3];                        /** Sempre zero */
+};
+
+static_assert(sizeof(ScheduleRecord) == 56, "ScheduleRecord deve ter 56 bytes");
+static_assert(MAX_TEXT_SIZE <= UINT8_MAX, "O tamanho do texto deve caber em ScheduleRecord::textSize");
+
+/**
+ * @brief Tweets agendados do servidor.
+ *
+ * Guarda os agendamentos em uma `TimerWheel` protegida por mutex: as threads
+ *     de processamento agendam e cancelam, e a thread principal do servidor
+ *     retira os vencidos. Com persistência, cada mudança é acrescentada a um
+ *     arquivo (cabeçalho "MTSC" + versão, depois registros); ao carregar e
+ *     quando os registros obsoletos passam dos pendentes, o arquivo é
+ *     reescrito só com os pendentes (temporário + rename).
+ */
+class TweetSchedule
+{
+public:
+    /// Resultado de um pedido de agendamento
+    enum Result
+    {
+        SCHEDULED,      /** Agendado; o ticket foi preenchido */
+        FULL,           /** Capacidade do servidor esgotada */
+        CLIENT_LIMIT,   /** Autor já tem `SCHEDULE_MAX_PER_CLIENT` pendentes */
+        PAST,           /** Horário já passou */
+        TOO_FAR,        /** Além de `SCHEDULE_MAX_DAYS` */
+        INVALID         /** Texto vazio ou maior que `MAX_TEXT_SIZE` */
+    };
+
+    /// Construtor
+    TweetSchedule();
+
+    /// Destrutor
+    ~TweetSchedule();
+
+    /**
+     * @brief Carrega os agendamentos salvos e passa a salvar as mudanças.
+     *
+     * @param path Caminho do arquivo
+     *
+     * @return size_t Agendamentos pendentes carregados
+     */
+    size_t enablePersistence(const std::string&);
+
+    /**
+     * @brief Agenda um tweet.
+     *
+     * @param tweet Agendamento (o ticket é preenchido se aceito)
+     *
+     * @return Result Resultado
+     */
+    Result add(ScheduledTweet&);
+
+    /**
+     * @brief Cancela um agendamento do autor.
+     *
+     * @retval `true` Se o agendamento existia e foi cancelado
+     * @retval `false` Caso contrário
+     */
+    bool cancel(uint32_t, int32_t);
+
+    /**
+     * @brief Retira os agendamentos vencidos.
+     *
+     * @param now Horário atual (ms desde 1970)
+     * @param due Recebe os vencidos, em ordem de horário
+     */
+    void collect(int64_t, std::vector<ScheduledTweet>&);
+
+    /**
+     * @brief Agendamentos pendentes.
+     */
+    size_t pending();
+
+    /**
+     * @brief Horário atual do relógio de parede, em ms desde 1970.
+     */
+    static int64_t now();
+
+private:
+    std::mutex _mutex;                                  /** Protege a roda, as contagens e o arquivo */
+    TimerWheel _wheel;                                  /** Agendamentos pendentes */
+    std::unordered_map<int32_t, uint32_t> _perOrigin;   /** Pendentes por autor */
+    std::string _path;                                  /** Arquivo (vazio sem persistência) */
+    int _fd;                                            /** Arquivo aberto para acréscimos */
+    size_t _obsolete;                                   /** Registros que não descrevem mais um pendente */
+
+    /**
+     * @brief Acrescenta um registro ao arquivo (com o mutex travado).
+     */
+    void append(char, const ScheduledTweet&);
+
+    /**
+     * @brief Reescreve o arquivo só com os pendentes (com o mutex travado).
+     */
+    void compact();
+};
+
+#endif
@@ -0,0 +1,185 @@
+#include "../include/message.h"
+#include "../server/fanout.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#define BENCH_SMALL_SIZE (MESSAGE_HEADER_SIZE + MAX_TEXT_SIZE)  /** Datagrama de um tweet cheio */
+#define BENCH_OPEN_PACKETS 200000       /** Datagramas pré-cifrados para medir a abertura */
+#define BENCH_FANOUT_ROUNDS 200         /** Broadcasts por medição do fan-out */
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Par de canais ligados: o do cliente cifra o que o do servidor abre
+static void makePair(std::unique_ptr<SecureChannel> &client, std::unique_ptr<SecureChannel> &server, uint32_t id)
+{
+    SecureChannel::KeyPair clientKeys, serverKeys;
+
+    if (!SecureChannel::generate(clientKeys) || !SecureChannel::generate(serverKeys) ||
+        !(client = SecureChannel::establish(clientKeys, serverKeys.publicKey, true, id)) ||
+        !(server = SecureChannel::establish(serverKeys, clientKeys.publicKey, false, id)))
+    {
+        std::cerr << "Falha na troca de chaves" << std::endl;
+        exit(1);
+    }
+}
+
+static void benchHandshake(double duration)
+{
+    std::unique_ptr<SecureChannel> client, server;
+    unsigned long count = 0;
+    Clock::time_point start = Clock::now();
+
+    while (secondsSince(start) < duration)
+    {
+        makePair(client, server, 1);
+        count++;
+    }
+
+    std::cout << "Troca de chaves (X25519 + HKDF, os dois lados): " << std::fixed << std::setprecision(0)
+              << count / secondsSince(start) << " por segundo" << std::endl;
+}
+
+static void benchSeal(size_t size, double duration)
+{
+    std::unique_ptr<SecureChannel> client, server;
+    makePair(client, server, 1);
+
+    std::vector<char> plain(size, 'x'), sealed(size + SEAL_OVERHEAD);
+    unsigned long count = 0;
+    Clock::time_point start = Clock::now();
+
+    while (secondsSince(start) < duration)
+    {
+        for (int i = 0; i < 1024; i++)
+            client->seal(plain.data(), size, sealed.data());
+
+        count += 1024;
+    }
+
+    double elapsed = secondsSince(start);
+    std::cout << "Cifrar " << std::setw(5) << size << " B: " << std::setw(10) << count / elapsed
+              << " pacotes/s (" << std::setprecision(1) << count * size / elapsed / 1e6 << " MB/s)"
+              << std::setprecision(0) << std::endl;
+}
+
+static void benchOpen(size_t size)
+{
+    std::unique_ptr<SecureChannel> client, server;
+    makePair(client, server, 1);
+
+    // Cada contador só abre uma vez: os datagramas são cifrados antes da medição
+    size_t stride = size + SEAL_OVERHEAD;
+    std::vector<char> plain(size, 'x'), sealed(BENCH_OPEN_PACKETS * stride);
+
+    for (size_t i = 0; i < BENCH_OPEN_PACKETS; i++)
+        client->seal(plain.data(), size, &sealed[i * stride]);
+
+    unsigned long failures = 0;
+    Clock::time_point start = Clock::now();
+
+    for (size_t i = 0; i < BENCH_OPEN_PACKETS; i++)
+        failures += server->open(&sealed[i * stride], stride) != size;
+
+    double elapsed = secondsSince(start);
+    std::cout << "Abrir  " << std::setw(5) << size << " B: " << std::setw(10) << BENCH_OPEN_PACKETS / elapsed
+              << " pacotes/s (" << std::setprecision(1) << BENCH_OPEN_PACKETS * size / elapsed / 1e6 << " MB/s)"
+              << std::setprecision(0);
+
+    if (failures)
+        std::cout << " | FALHAS: " << failures;
+
+    std::cout << std::endl;
+}
+
+// Datagramas por segundo de um broadcast pelo `FanOut`, para um socket local que não lê
+static double fanOutRate(FanOut &fanOut, const EncodedMessage &message,
+                         const std::vector<FanOut::Recipient> &recipients)
+{
+    Clock::time_point start = Clock::now();
+
+    for (int round = 0; round < BENCH_FANOUT_ROUNDS; round++)
+        fanOut.send(message, recipients);
+
+    return static_cast<double>(BENCH_FANOUT_ROUNDS) * recipients.size() / secondsSince(start);
+}
+
+static void benchFanOut(size_t count)
+{
+    int sink = socket(AF_INET, SOCK_DGRAM, 0);
+    int sender = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (sink < 0 || sender < 0 || bind(sink, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+        getsockname(sink, (struct sockaddr*)&address, &length) < 0)
+    {
+        std::cerr << "Falha ao criar os sockets" << std::endl;
+        exit(1);
+    }
+
+    std::vector<FanOut::Recipient> plain(count, FanOut::Recipient{address, false, nullptr});
+    std::vector<FanOut::Recipient> sealed = plain;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        std::unique_ptr<SecureChannel> client, server;
+        makePair(client, server, static_cast<uint32_t>(i + 1));
+        sealed[i].channel = std::move(server);
+    }
+
+    Message tweet(Message::MSG, 1, 0, "bench", std::string(MAX_TEXT_SIZE, 'x'));
+    const EncodedMessage encoded(tweet, false);
+    FanOut fanOut(sender);
+
+    // Uma volta de aquecimento de cada, para as páginas e os buffers da thread
+    fanOutRate(fanOut, encoded, plain);
+    fanOutRate(fanOut, encoded, sealed);
+
+    double plainRate = fanOutRate(fanOut, encoded, plain);
+    double sealedRate = fanOutRate(fanOut, encoded, sealed);
+
+    std::cout << "Fan-out para " << count << " destinatários (" << BENCH_SMALL_SIZE << " B): em claro "
+              << plainRate << " pacotes/s, cifrado " << sealedRate << " pacotes/s (custo "
+              << std::setprecision(1) << 100.0 * (plainRate - sealedRate) / plainRate << "%)"
+              << std::setprecision(0) << std::endl;
+
+    close(sender);
+    close(sink);
+}
+
+int main(int argc, char *argv[])
+{
+    double duration = argc > 1 ? std::stod(argv[1]) : 1.0;
+    size_t recipients = argc > 2 ? std::stoul(argv[2]) : 1000;
+
+    if (duration <= 0 || recipients == 0)
+    {
+        std::cerr << "Uso: " << argv[0] << " [segundos por medição] [destinatários do fan-out]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << std::fixed << std::setprecision(0);
+
+    benchHandshake(duration);
+    benchSeal(BENCH_SMALL_SIZE, duration);
+    benchSeal(MAX_DATAGRAM_SIZE, duration);
+    benchOpen(BENCH_SMALL_SIZE);
+    benchOpen(MAX_DATAGRAM_SIZE);
+    benchFanOut(recipients);
+
+    return 0;
+}
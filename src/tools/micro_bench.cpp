@@ -0,0 +1,440 @@
+#include "../include/message.h"
+#include "../server/fanout.h"
+#include "../server/session_table.h"
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#define BENCH_MIN_TIME 0.5              /** Duração mínima de cada medição, em segundos (padrão) */
+#define BENCH_MAX_SESSIONS 1000000      /** Maior tabela de sessões medida (padrão) */
+#define BENCH_MAX_ITERATIONS 1000000000UL   /** Limite de iterações de uma medição */
+#define BENCH_LOOKUPS 65536             /** IDs sorteados percorridos pelas buscas */
+#define BENCH_REGRESSION_PERCENT 20     /** Piora do tempo que conta como regressão (padrão) */
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Resultado de uma medição.
+ */
+struct Result {
+    std::string name;           /** Nome da medição (`grupo/caso/parâmetro`) */
+    unsigned long iterations;   /** Iterações executadas */
+    double nanoseconds;         /** Tempo médio por iteração */
+    double itemsPerSecond;      /** Itens (mensagens, buscas, datagramas) por segundo */
+    double bytesPerSecond;      /** Bytes processados por segundo (0 = não se aplica) */
+};
+
+static double minTime = BENCH_MIN_TIME;
+static std::string filter;
+static std::vector<Result> results;
+
+// Impede que o compilador descarte o resultado de uma iteração
+static volatile size_t sink;
+
+static double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Repete `body` com cada vez mais iterações até a medição durar `minTime`
+static void measure(const std::string &name, size_t items, size_t bytes,
+                    const std::function<void(unsigned long)> &body)
+{
+    if (name.find(filter) == std::string::npos)
+        return;
+
+    unsigned long iterations = 1;
+
+    while (true)
+    {
+        Clock::time_point start = Clock::now();
+        body(iterations);
+        double elapsed = secondsSince(start);
+
+        if (elapsed >= minTime || iterations >= BENCH_MAX_ITERATIONS)
+        {
+            double total = static_cast<double>(iterations);
+            results.push_back({name, iterations, elapsed * 1e9 / total, total * items / elapsed,
+                               total * bytes / elapsed});
+            break;
+        }
+
+        // Mira um pouco acima do mínimo para não medir de novo por pouco
+        double factor = elapsed > 0 ? minTime * 1.4 / elapsed : 10.0;
+        iterations = std::min<unsigned long>(BENCH_MAX_ITERATIONS,
+                                             iterations * std::max(2.0, std::min(factor, 10.0)));
+    }
+
+    const Result &result = results.back();
+    std::cout << std::left << std::setw(32) << result.name << std::right
+              << std::setw(14) << std::setprecision(1) << result.nanoseconds << " ns"
+              << std::setw(12) << result.iterations
+              << std::setw(14) << std::setprecision(0) << result.itemsPerSecond << " itens/s";
+
+    if (bytes)
+        std::cout << std::setw(10) << std::setprecision(1) << result.bytesPerSecond / 1e6 << " MB/s";
+
+    std::cout << std::endl;
+}
+
+// Texto de tamanho dado com palavras repetidas, como um texto real (comprimível)
+static std::string sampleText(size_t size)
+{
+    static const char *words[] = {"rede ", "datagrama ", "servidor ", "cliente ", "tweet ", "mensagem "};
+    std::string text;
+
+    for (size_t i = 0; text.size() < size; i = (i * 7 + 3) % 6)
+        text += words[i];
+
+    text.resize(size);
+    return text;
+}
+
+static void benchCodec()
+{
+    // Tweet curto, tweet cheio, texto que precisa de fragmentos e resposta grande
+    for (size_t size : {16, MAX_TEXT_SIZE, 1024, 16384})
+    {
+        Message message(Message::MSG, 1, 0, "bench", sampleText(size));
+        std::vector<char> buffer(message.encodedSize());
+        size_t bytes = buffer.size();
+        std::string suffix = "/" + std::to_string(size);
+
+        measure("codec/encode" + suffix, 1, bytes, [&](unsigned long iterations) {
+            for (unsigned long i = 0; i < iterations; i++)
+                sink = message.encode(buffer.data());
+        });
+
+        measure("codec/decode" + suffix, 1, bytes, [&](unsigned long iterations) {
+            Message decoded;
+            for (unsigned long i = 0; i < iterations; i++)
+                sink = Message::decode(buffer.data(), bytes, decoded);
+        });
+
+        if (size <= MAX_TEXT_SIZE)
+            continue;
+
+        // Codificação do broadcast (com a versão comprimida) e decodificação no cliente
+        measure("codec/encode_compressed" + suffix, 1, bytes, [&](unsigned long iterations) {
+            for (unsigned long i = 0; i < iterations; i++)
+                sink = EncodedMessage(message, true).bytes(true).size();
+        });
+
+        const EncodedMessage encoded(message, true);
+        std::string_view compressed = encoded.bytes(true);
+
+        measure("codec/decode_compressed" + suffix, 1, bytes, [&](unsigned long iterations) {
+            Message decoded;
+            for (unsigned long i = 0; i < iterations; i++)
+                sink = Message::decode(compressed.data(), compressed.size(), decoded);
+        });
+    }
+
+    // Conversão de ordem de bytes dos cinco inteiros do cabeçalho, ida e volta
+    measure("codec/header_byte_order", 1, 0, [](unsigned long iterations) {
+        WireHeader header{};
+        for (unsigned long i = 0; i < iterations; i++)
+        {
+            int32_t value = static_cast<int32_t>(i);
+            WireHeader::store(header.type, value);
+            WireHeader::store(header.origin, value + 1);
+            WireHeader::store(header.destination, value + 2);
+            WireHeader::store(header.textSize, value + 3);
+            WireHeader::store(header.sequence, value + 4);
+            sink = WireHeader::load(header.type) + WireHeader::load(header.origin) +
+                   WireHeader::load(header.destination) + WireHeader::load(header.textSize) +
+                   WireHeader::load(header.sequence);
+        }
+    });
+}
+
+static sockaddr_in sessionAddress(size_t index)
+{
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(0x0A000000 | static_cast<uint32_t>(index >> 16));
+    address.sin_port = htons(static_cast<uint16_t>(index));
+    return address;
+}
+
+static void fillSessions(SessionTable &table, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        table.add(static_cast<int>(i + 1), sessionAddress(i), "usuario" + std::to_string(i % 1000), i % 2 == 0);
+}
+
+static void benchSessions(size_t count, FanOut &fanOut, const sockaddr_in &sinkAddress)
+{
+    std::string suffix = "/" + std::to_string(count);
+
+    measure("sessions/add" + suffix, count, 0, [count](unsigned long iterations) {
+        for (unsigned long i = 0; i < iterations; i++)
+        {
+            SessionTable table;
+            fillSessions(table, count);
+            sink = table.size();
+        }
+    });
+
+    SessionTable table;
+    fillSessions(table, count);
+
+    // IDs sorteados antes: a busca, não o sorteio, é o que se mede
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> pick(1, static_cast<int>(count));
+    std::vector<int> ids(BENCH_LOOKUPS);
+
+    for (int &id : ids)
+        id = pick(random);
+
+    measure("sessions/find" + suffix, 1, 0, [&](unsigned long iterations) {
+        size_t found = 0;
+        for (unsigned long i = 0; i < iterations; i++)
+        {
+            const SessionTable::Session *session = table.find(ids[i % BENCH_LOOKUPS]);
+            found += session && session->compression;
+        }
+        sink = found;
+    });
+
+    // Parte do `broadcastMessage` feita com o mutex de clientes: cópia dos destinatários
+    std::mutex clientsMutex;
+    std::vector<FanOut::Recipient> recipients;
+
+    measure("broadcast/collect" + suffix, count, 0, [&](unsigned long iterations) {
+        for (unsigned long i = 0; i < iterations; i++)
+        {
+            recipients.clear();
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            table.forEach([&](const SessionTable::Session &session) {
+                recipients.push_back({session.address, session.compression, session.channel});
+            });
+            sink = recipients.size();
+        }
+    });
+
+    // Envio pelo `FanOut` a um socket local que não lê (o kernel descarta o excedente)
+    for (FanOut::Recipient &recipient : recipients)
+        recipient.address = sinkAddress;
+
+    Message tweet(Message::MSG, 1, 0, "bench", sampleText(MAX_TEXT_SIZE));
+    const EncodedMessage encoded(tweet, true);
+    size_t bytes = encoded.bytes(false).size();
+
+    measure("broadcast/fanout" + suffix, count, count * bytes, [&](unsigned long iterations) {
+        for (unsigned long i = 0; i < iterations; i++)
+            fanOut.send(encoded, recipients);
+    });
+}
+
+static bool writeJson(const std::string &path, size_t maxSessions)
+{
+    std::ofstream file;
+    std::ostream &out = path == "-" ? std::cout : (file.open(path), file);
+
+    if (path != "-" && !file)
+        return false;
+
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+
+    // Mesmo formato do `--benchmark_format=json` do Google Benchmark
+    out << std::fixed << "{\n  \"context\": {\n"
+        << "    \"date\": \"" << date << "\",\n"
+        << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+        << "    \"min_time\": " << std::setprecision(3) << minTime << ",\n"
+        << "    \"max_sessions\": " << maxSessions << "\n"
+        << "  },\n  \"benchmarks\": [";
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result &result = results[i];
+        out << (i ? "," : "") << "\n    {\n"
+            << "      \"name\": \"" << result.name << "\",\n"
+            << "      \"iterations\": " << result.iterations << ",\n"
+            << "      \"real_time\": " << std::setprecision(3) << result.nanoseconds << ",\n"
+            << "      \"time_unit\": \"ns\",\n"
+            << "      \"items_per_second\": " << std::setprecision(1) << result.itemsPerSecond;
+
+        if (result.bytesPerSecond > 0)
+            out << ",\n      \"bytes_per_second\": " << result.bytesPerSecond;
+
+        out << "\n    }";
+    }
+
+    out << "\n  ]\n}" << std::endl;
+    return static_cast<bool>(out);
+}
+
+// Lê os tempos por iteração de um JSON gravado por esta ferramenta
+static bool readBaseline(const std::string &path, std::map<std::string, double> &times)
+{
+    std::ifstream file(path);
+    std::string line, name;
+
+    if (!file)
+        return false;
+
+    while (std::getline(file, line))
+    {
+        size_t key = line.find("\"name\": \"");
+        if (key != std::string::npos)
+        {
+            size_t start = key + 9;
+            name = line.substr(start, line.find('"', start) - start);
+            continue;
+        }
+
+        key = line.find("\"real_time\": ");
+        if (key != std::string::npos && !name.empty())
+        {
+            times[name] = std::stod(line.substr(key + 13));
+            name.clear();
+        }
+    }
+
+    return true;
+}
+
+// Compara com a referência; retorna quantas medições pioraram além do limite
+static int compare(const std::map<std::string, double> &baseline, double threshold)
+{
+    int regressions = 0;
+
+    std::cout << std::endl << "Comparação com a referência (limite +" << std::setprecision(0) << threshold << "%):"
+              << std::endl;
+
+    for (const Result &result : results)
+    {
+        auto found = baseline.find(result.name);
+        if (found == baseline.end() || found->second <= 0)
+            continue;
+
+        double change = 100.0 * (result.nanoseconds - found->second) / found->second;
+        bool regression = change > threshold;
+        regressions += regression;
+
+        std::cout << std::left << std::setw(32) << result.name << std::right << std::setw(14)
+                  << std::setprecision(1) << found->second << " ns ->" << std::setw(14) << result.nanoseconds
+                  << " ns" << std::setw(9) << std::showpos << change << "%" << std::noshowpos
+                  << (regression ? "  REGRESSÃO" : "") << std::endl;
+    }
+
+    return regressions;
+}
+
+static void usage(const char *program)
+{
+    std::cerr << "Uso: " << program << " [--json <arquivo|->] [--min-time <segundos>]"
+              << " [--max-sessions <n>] [--filter <trecho do nome>]"
+              << " [--baseline <arquivo> [--threshold <porcentagem>]]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string json, baselinePath;
+    size_t maxSessions = BENCH_MAX_SESSIONS;
+    double threshold = BENCH_REGRESSION_PERCENT;
+    std::map<std::string, double> baseline;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+
+        if (i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (option == "--json")
+            json = argv[++i];
+        else if (option == "--min-time")
+            minTime = std::stod(argv[++i]);
+        else if (option == "--max-sessions")
+            maxSessions = std::stoul(argv[++i]);
+        else if (option == "--filter")
+            filter = argv[++i];
+        else if (option == "--baseline")
+            baselinePath = argv[++i];
+        else if (option == "--threshold")
+            threshold = std::stod(argv[++i]);
+        else
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (minTime <= 0 || maxSessions < 10 || threshold < 0)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Lida antes das medições: a referência pode ser o próprio arquivo do `--json`
+    if (!baselinePath.empty() && !readBaseline(baselinePath, baseline))
+    {
+        std::cerr << "Falha ao ler " << baselinePath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    int sinkSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    int sender = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (sinkSocket < 0 || sender < 0 || bind(sinkSocket, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+        getsockname(sinkSocket, (struct sockaddr*)&address, &length) < 0)
+    {
+        std::cerr << "Falha ao criar os sockets" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Com o JSON na saída padrão, a tabela vai para a saída de erro
+    std::streambuf *table = std::cout.rdbuf();
+    if (json == "-")
+        std::cout.rdbuf(std::cerr.rdbuf());
+
+    std::cout << std::fixed;
+
+    {
+        FanOut fanOut(sender);
+
+        benchCodec();
+
+        for (size_t count = 10; count <= maxSessions; count *= 10)
+            benchSessions(count, fanOut, address);
+    }
+
+    close(sender);
+    close(sinkSocket);
+
+    int regressions = baselinePath.empty() ? 0 : compare(baseline, threshold);
+    std::cout.rdbuf(table);
+
+    if (!json.empty() && !writeJson(json, maxSessions))
+    {
+        std::cerr << "Falha ao gravar " << json << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Código de saída próprio para que um script diferencie regressão de erro
+    return regressions ? 2 : 0;
+}
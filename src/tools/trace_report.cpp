@@ -0,0 +1,191 @@
+#include "../include/trace.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <vector>
+
+/**
+ * @brief Etapas de uma mensagem amostrada, identificada por origem e sequência do cliente.
+ */
+struct Timeline {
+    uint64_t stages[TRACE_STAGES] = {};     /** Horário de cada etapa (0 = não registrada) */
+    std::vector<uint64_t> renders;          /** Horários de exibição nos destinatários */
+};
+
+/**
+ * @brief Trecho entre duas etapas, com as amostras em nanossegundos.
+ */
+struct Segment {
+    const char *name;                       /** Nome do trecho */
+    TraceStage from;                        /** Etapa inicial */
+    TraceStage to;                          /** Etapa final */
+    std::vector<uint64_t> samples;          /** Durações medidas */
+};
+
+using Key = std::pair<int32_t, int32_t>;
+
+static bool readTrace(const char *path, std::vector<TraceRecord> &records)
+{
+    std::ifstream file(path, std::ios::binary);
+    char header[8];
+
+    if (!file.read(header, sizeof(header)) || memcmp(header, "MTTR", 4) != 0)
+        return false;
+
+    uint32_t version;
+    memcpy(&version, header + 4, sizeof(version));
+    if (version != TRACE_VERSION)
+        return false;
+
+    TraceRecord record;
+    while (file.read(reinterpret_cast<char*>(&record), sizeof(record)))
+        records.push_back(record);
+
+    return true;
+}
+
+static void keepFirst(uint64_t &slot, uint64_t timestamp)
+{
+    if (slot == 0 || timestamp < slot)
+        slot = timestamp;
+}
+
+// Completa um texto UTF-8 até a largura pedida (em caracteres, não em bytes)
+static std::string pad(const std::string &text, size_t width, bool left)
+{
+    size_t characters = std::count_if(text.begin(), text.end(), [](char c) { return (c & 0xC0) != 0x80; });
+    std::string fill(width > characters ? width - characters : 0, ' ');
+    return left ? text + fill : fill + text;
+}
+
+static double percentile(std::vector<uint64_t> &samples, double fraction)
+{
+    size_t index = std::min(samples.size() - 1, static_cast<size_t>(fraction * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index] / 1000.0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Uso: " << argv[0] << " <trace> [trace...]\n"
+                  << "  Junta os arquivos de trace do servidor e dos clientes (gravados no mesmo\n"
+                  << "  host, com o mesmo relógio monotônico) e mostra a latência de cada etapa."
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<TraceRecord> records;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!readTrace(argv[i], records))
+        {
+            std::cerr << "Arquivo de trace inválido: " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // O broadcast é entregue com a posição na linha do tempo no lugar da
+    //     sequência do cliente; o fan-out registra a ligação entre as duas
+    std::map<Key, Timeline> timelines;
+    std::map<Key, Key> delivered;
+
+    for (const auto &record : records)
+    {
+        if (record.stage >= TRACE_STAGES)
+            continue;
+
+        Key key(record.origin, record.sequence);
+
+        if (record.stage == TRACE_FANOUT_START)
+            delivered[Key(record.origin, record.link)] = key;
+
+        if (record.stage != TRACE_RENDER)
+            keepFirst(timelines[key].stages[record.stage], record.timestamp);
+    }
+
+    size_t unmatched = 0;
+
+    for (const auto &record : records)
+    {
+        if (record.stage != TRACE_RENDER)
+            continue;
+
+        auto found = delivered.find(Key(record.origin, record.sequence));
+        if (found == delivered.end())
+        {
+            unmatched++;
+            continue;
+        }
+
+        timelines[found->second].renders.push_back(record.timestamp);
+    }
+
+    std::vector<Segment> segments = {
+        {"cliente -> servidor", TRACE_CLIENT_SEND, TRACE_SERVER_RECEIVE, {}},
+        {"fila do servidor", TRACE_SERVER_RECEIVE, TRACE_SERVER_DEQUEUE, {}},
+        {"processamento", TRACE_SERVER_DEQUEUE, TRACE_FANOUT_START, {}},
+        {"fan-out completo", TRACE_FANOUT_START, TRACE_FANOUT_END, {}},
+        {"fan-out -> exibição", TRACE_FANOUT_START, TRACE_RENDER, {}},
+        {"total (envio -> exibição)", TRACE_CLIENT_SEND, TRACE_RENDER, {}},
+    };
+
+    for (const auto &entry : timelines)
+    {
+        const Timeline &timeline = entry.second;
+
+        for (auto &segment : segments)
+        {
+            uint64_t start = timeline.stages[segment.from];
+            if (start == 0)
+                continue;
+
+            if (segment.to == TRACE_RENDER)
+            {
+                for (uint64_t render : timeline.renders)
+                {
+                    if (render >= start)
+                        segment.samples.push_back(render - start);
+                }
+            }
+            else if (timeline.stages[segment.to] >= start)
+            {
+                segment.samples.push_back(timeline.stages[segment.to] - start);
+            }
+        }
+    }
+
+    std::cout << "Registros: " << records.size() << " | Mensagens: " << timelines.size();
+    if (unmatched)
+        std::cout << " | Exibições sem fan-out correspondente: " << unmatched;
+    std::cout << "\n\n";
+
+    std::cout << pad("Etapa", 28, true) << pad("Amostras", 10, false) << pad("p50 (µs)", 12, false)
+              << pad("p90 (µs)", 12, false) << pad("p99 (µs)", 12, false) << pad("máx (µs)", 12, false) << "\n";
+
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (auto &segment : segments)
+    {
+        std::cout << pad(segment.name, 28, true) << std::setw(10) << segment.samples.size();
+
+        if (segment.samples.empty())
+        {
+            std::cout << std::setw(12) << "-" << std::setw(12) << "-" << std::setw(12) << "-"
+                      << std::setw(12) << "-" << "\n";
+            continue;
+        }
+
+        std::cout << std::setw(12) << percentile(segment.samples, 0.50)
+                  << std::setw(12) << percentile(segment.samples, 0.90)
+                  << std::setw(12) << percentile(segment.samples, 0.99)
+                  << std::setw(12) << *std::max_element(segment.samples.begin(), segment.samples.end()) / 1000.0
+                  << "\n";
+    }
+
+    return EXIT_SUCCESS;
+}
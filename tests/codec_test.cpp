@@ -0,0 +1,549 @@
+#include "../include/message.h"
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#define TEST_CASES 200                  /** Casos sorteados por propriedade (padrão) */
+#define TEST_TYPE_COUNT 21              /** Tipos de `Message::MessageType` (0 a `PRESENCE`) */
+#define TEST_SOCKET_BUFFER (4 << 20)    /** Buffer de recepção do socket de teste (mensagens fragmentadas inteiras) */
+
+using Rng = std::mt19937_64;
+
+static unsigned long cases = TEST_CASES;
+static unsigned long failures;
+static std::string failure;
+
+// Registra a primeira falha do caso atual; o caso continua, mas é contado uma vez
+static bool check(bool condition, const std::string &what)
+{
+    if (!condition && failure.empty())
+        failure = what;
+    return condition;
+}
+
+// Executa `body` em `cases` casos, cada um com uma semente própria, e informa
+//     a semente do primeiro caso que falhar
+static void property(const std::string &name, uint64_t seed, const std::function<void(Rng&)> &body)
+{
+    unsigned long failed = 0;
+    uint64_t firstSeed = 0;
+    std::string firstFailure;
+
+    for (unsigned long i = 0; i < cases; i++)
+    {
+        Rng rng(seed + i);
+        failure.clear();
+        body(rng);
+
+        if (!failure.empty() && failed++ == 0)
+        {
+            firstSeed = seed + i;
+            firstFailure = failure;
+        }
+    }
+
+    if (failed)
+    {
+        failures++;
+        std::cout << "FALHA  " << name << ": " << failed << "/" << cases << " casos (semente " << firstSeed
+                  << "): " << firstFailure << std::endl;
+    }
+    else
+    {
+        std::cout << "ok     " << name << " (" << cases << " casos)" << std::endl;
+    }
+}
+
+static size_t uniform(Rng &rng, size_t low, size_t high)
+{
+    return std::uniform_int_distribution<size_t>(low, high)(rng);
+}
+
+static std::string randomBytes(Rng &rng, size_t size)
+{
+    std::string bytes(size, '\0');
+    for (char &byte : bytes)
+        byte = static_cast<char>(rng());
+    return bytes;
+}
+
+// Texto com palavras do tráfego real (comprimível) ou bytes quaisquer
+static std::string randomText(Rng &rng, size_t size)
+{
+    static const char *words[] = {"bom dia ", "pessoal ", "1:ana\n", "STATUS: ", "http://", "kkkk ", "tweet "};
+
+    if (rng() % 3 == 0)
+        return randomBytes(rng, size);
+
+    std::string text;
+    while (text.size() < size)
+        text += words[rng() % 7];
+
+    text.resize(size);
+    return text;
+}
+
+// Tamanho do texto: quase sempre um tweet, às vezes uma resposta grande
+static size_t randomTextSize(Rng &rng)
+{
+    switch (rng() % 4)
+    {
+    case 0:
+        return uniform(rng, 0, 16);
+    case 1:
+    case 2:
+        return uniform(rng, 0, MAX_TEXT_SIZE);
+    default:
+        return uniform(rng, MAX_TEXT_SIZE + 1, MAX_MESSAGE_SIZE - MESSAGE_HEADER_SIZE);
+    }
+}
+
+// Nome sem '\0' (que terminaria o campo); pode passar do limite e ser truncado
+static std::string randomUsername(Rng &rng)
+{
+    std::string name(uniform(rng, 0, MAX_USERNAME_SIZE + 4), 'a');
+    for (char &c : name)
+        c = static_cast<char>(uniform(rng, 1, 255));
+    return name;
+}
+
+static Message randomMessage(Rng &rng, int type, size_t textSize)
+{
+    Message message(type, static_cast<int>(rng()), static_cast<int>(rng()), randomUsername(rng),
+                    randomText(rng, textSize));
+    message.setSequence(static_cast<int>(rng()));
+
+    for (Message::MessageFlag flag : {Message::ACCEPTS_COMPRESSION, Message::TRACED, Message::ACCEPTS_MULTICAST,
+                                      Message::ACCEPTS_ENCRYPTION})
+    {
+        if (rng() % 2)
+            message.setFlag(flag);
+    }
+
+    return message;
+}
+
+static std::string encode(const Message &message)
+{
+    std::string buffer(message.encodedSize(), '\0');
+    message.encode(&buffer[0]);
+    return buffer;
+}
+
+static bool sameMessage(const Message &a, const Message &b)
+{
+    return a.getType() == b.getType() && a.getOriginID() == b.getOriginID() &&
+           a.getDestinationID() == b.getDestinationID() && a.getSequence() == b.getSequence() &&
+           a.getUsernameView() == b.getUsernameView() && a.getTextView() == b.getTextView() &&
+           encode(a) == encode(b);
+}
+
+// Socket UDP no loopback, em porta efêmera
+static int openSocket(sockaddr_in &addr)
+{
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    int size = TEST_SOCKET_BUFFER;
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+    timeval timeout = {1, 0};
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(sockfd, (sockaddr*)&addr, sizeof(addr));
+
+    socklen_t length = sizeof(addr);
+    getsockname(sockfd, (sockaddr*)&addr, &length);
+    return sockfd;
+}
+
+// Datagramas de uma mensagem como saem do socket (fragmentados se preciso)
+static std::vector<std::string> sendAndCapture(const Message &message, bool compress, int sender, int receiver,
+                                               const sockaddr_in &to)
+{
+    message.send(sender, to, compress);
+
+    std::vector<std::string> datagrams;
+    char buffer[MAX_DATAGRAM_SIZE + 1];
+    ssize_t n;
+
+    while ((n = recv(receiver, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0)
+        datagrams.emplace_back(buffer, n);
+
+    return datagrams;
+}
+
+static void testCodec(uint64_t seed)
+{
+    for (int type = 0; type < TEST_TYPE_COUNT; type++)
+    {
+        property("codec/roundtrip/tipo-" + std::to_string(type), seed, [type](Rng &rng) {
+            Message message = randomMessage(rng, type, randomTextSize(rng));
+            std::string bytes = encode(message);
+            Message decoded;
+
+            if (!check(Message::decode(bytes.data(), bytes.size(), decoded), "decode recusou a codificação"))
+                return;
+
+            check(sameMessage(message, decoded), "campos diferentes após ida e volta");
+            check(decoded.getUsernameView().size() <= MAX_USERNAME_SIZE, "nome maior que o limite");
+            check(Message::frameSize(bytes.data(), bytes.size()) == bytes.size(), "frameSize diferente");
+        });
+    }
+
+    property("codec/frames-em-sequencia", seed, [](Rng &rng) {
+        std::vector<Message> messages;
+        std::string stream;
+
+        for (size_t i = uniform(rng, 1, 8); i > 0; i--)
+        {
+            messages.push_back(randomMessage(rng, Message::MSG, uniform(rng, 0, MAX_TEXT_SIZE)));
+            stream += encode(messages.back());
+        }
+
+        size_t offset = 0;
+        for (const Message &message : messages)
+        {
+            size_t size = Message::frameSize(stream.data() + offset, stream.size() - offset);
+            Message decoded;
+
+            if (!check(size > 0 && Message::decode(stream.data() + offset, size, decoded), "frame recusado"))
+                return;
+
+            check(sameMessage(message, decoded), "frame diferente do original");
+            offset += size;
+        }
+
+        check(offset == stream.size(), "bytes sobrando após os frames");
+    });
+
+    property("codec/truncado-e-inconsistente", seed, [](Rng &rng) {
+        std::string bytes = encode(randomMessage(rng, static_cast<int>(rng() % TEST_TYPE_COUNT),
+                                                 uniform(rng, 0, MAX_TEXT_SIZE)));
+        Message decoded;
+
+        size_t cut = uniform(rng, 0, bytes.size() - 1);
+        check(!Message::decode(bytes.data(), cut, decoded), "prefixo aceito");
+        check(Message::frameSize(bytes.data(), cut) == 0, "frameSize de prefixo");
+
+        std::string longer = bytes + randomBytes(rng, uniform(rng, 1, 8));
+        check(!Message::decode(longer.data(), longer.size(), decoded), "bytes extras aceitos");
+
+        int wrong = static_cast<int>(rng());
+        if (wrong != static_cast<int>(bytes.size() - MESSAGE_HEADER_SIZE))
+        {
+            WireHeader::store(WireHeader::at(&bytes[0])->textSize, wrong);
+            check(!Message::decode(bytes.data(), bytes.size(), decoded), "tamanho do texto inconsistente aceito");
+        }
+    });
+
+    property("codec/maior-que-o-limite", seed, [](Rng &rng) {
+        // Monta o fio à mão: `Message` não guarda textos acima do limite
+        size_t textSize = MAX_MESSAGE_SIZE - MESSAGE_HEADER_SIZE + uniform(rng, 1, 64);
+        std::string bytes(MESSAGE_HEADER_SIZE, '\0');
+        WireHeader::store(WireHeader::at(&bytes[0])->type, Message::MSG);
+        WireHeader::store(WireHeader::at(&bytes[0])->textSize, static_cast<int>(textSize));
+        bytes += randomBytes(rng, textSize);
+
+        Message decoded;
+        check(!Message::decode(bytes.data(), bytes.size(), decoded), "texto acima de MAX_MESSAGE_SIZE aceito");
+    });
+}
+
+static void testFragments(uint64_t seed)
+{
+    sockaddr_in senderAddr, receiverAddr;
+    int sender = openSocket(senderAddr);
+    int receiver = openSocket(receiverAddr);
+
+    property("frag/divide-e-remonta", seed, [&](Rng &rng) {
+        size_t textSize = uniform(rng, MAX_DATAGRAM_SIZE, MAX_MESSAGE_SIZE - MESSAGE_HEADER_SIZE);
+        Message message = randomMessage(rng, Message::LIST, textSize);
+        std::vector<std::string> datagrams = sendAndCapture(message, false, sender, receiver, receiverAddr);
+        size_t count = (message.encodedSize() + FRAGMENT_PAYLOAD_SIZE - 1) / FRAGMENT_PAYLOAD_SIZE;
+
+        if (!check(datagrams.size() == count, "quantidade de fragmentos"))
+            return;
+
+        for (const std::string &datagram : datagrams)
+        {
+            uint32_t id, total;
+            uint16_t index, fragments;
+            check(datagram.size() <= MAX_DATAGRAM_SIZE, "fragmento maior que o datagrama");
+            check(Fragmenter::readHeader(datagram.data(), datagram.size(), id, index, fragments, total),
+                  "cabeçalho de fragmento inválido");
+        }
+
+        // Fora de ordem e com duplicatas: só o último fragmento novo completa
+        std::vector<std::string> shuffled = datagrams;
+        for (size_t i = uniform(rng, 0, 4); i > 0; i--)
+            shuffled.push_back(datagrams[rng() % datagrams.size()]);
+        std::shuffle(shuffled.begin(), shuffled.end(), rng);
+
+        Reassembler reassembler;
+        std::vector<bool> seen(datagrams.size());
+        size_t unique = 0, completions = 0;
+
+        for (const std::string &datagram : shuffled)
+        {
+            size_t index = std::find(datagrams.begin(), datagrams.end(), datagram) - datagrams.begin();
+            bool fresh = !seen[index];
+            unique += fresh;
+            seen[index] = true;
+
+            const char *data;
+            size_t size;
+            if (!reassembler.add(datagram.data(), datagram.size(), senderAddr, &data, &size))
+                continue;
+
+            completions++;
+            check(fresh && unique == datagrams.size(), "completou antes de todos os fragmentos");
+
+            Message decoded;
+            check(Message::decode(data, size, decoded) && sameMessage(message, decoded),
+                  "mensagem remontada diferente");
+            if (unique == datagrams.size())
+                break;
+        }
+
+        check(completions == 1, "mensagem completada " + std::to_string(completions) + " vezes");
+    });
+
+    property("frag/remetentes-intercalados", seed, [&](Rng &rng) {
+        // Duas mensagens com o mesmo ID, de endereços diferentes, não se misturam
+        std::vector<Message> messages;
+        std::vector<std::vector<std::string>> datagrams;
+        for (int i = 0; i < 2; i++)
+        {
+            messages.push_back(randomMessage(rng, Message::HISTORY, uniform(rng, MAX_DATAGRAM_SIZE, 8192)));
+            datagrams.push_back(sendAndCapture(messages.back(), false, sender, receiver, receiverAddr));
+        }
+
+        for (std::string &datagram : datagrams[1])
+            memcpy(&datagram[4], &datagrams[0][0][4], 4);
+
+        sockaddr_in sources[2] = {senderAddr, senderAddr};
+        sources[1].sin_port = htons(ntohs(senderAddr.sin_port) + 1);
+
+        Reassembler reassembler;
+        size_t next[2] = {0, 0};
+        int completed[2] = {0, 0};
+
+        while (next[0] < datagrams[0].size() || next[1] < datagrams[1].size())
+        {
+            int i = next[1] == datagrams[1].size() || (next[0] < datagrams[0].size() && rng() % 2) ? 0 : 1;
+            const std::string &datagram = datagrams[i][next[i]++];
+            const char *data;
+            size_t size;
+
+            if (!reassembler.add(datagram.data(), datagram.size(), sources[i], &data, &size))
+                continue;
+
+            Message decoded;
+            check(next[i] == datagrams[i].size(), "completou antes de todos os fragmentos");
+            check(Message::decode(data, size, decoded) && sameMessage(messages[i], decoded),
+                  "remetentes misturados");
+            completed[i]++;
+        }
+
+        check(completed[0] == 1 && completed[1] == 1, "mensagens intercaladas não completaram");
+    });
+
+    property("frag/cota-por-remetente", seed, [&](Rng &rng) {
+        // Um remetente que abre muitas mensagens só desaloja as próprias
+        Message message = randomMessage(rng, Message::LIST, uniform(rng, 2 * MAX_DATAGRAM_SIZE, 16384));
+        std::vector<std::string> datagrams = sendAndCapture(message, false, sender, receiver, receiverAddr);
+        std::string flood = datagrams[0];
+
+        sockaddr_in attacker = senderAddr;
+        attacker.sin_port = htons(ntohs(senderAddr.sin_port) + 1);
+
+        Reassembler reassembler;
+        const char *data;
+        size_t size;
+        size_t split = uniform(rng, 1, datagrams.size() - 1);
+        int completed = 0;
+
+        for (size_t i = 0; i < datagrams.size(); i++)
+        {
+            if (i == split)
+            {
+                for (size_t n = uniform(rng, REASSEMBLY_SLOTS, 4 * REASSEMBLY_SLOTS); n > 0; n--)
+                {
+                    uint32_t id = static_cast<uint32_t>(rng());
+                    memcpy(&flood[4], &id, 4);
+                    reassembler.add(flood.data(), flood.size(), attacker, &data, &size);
+                }
+            }
+
+            if (reassembler.add(datagrams[i].data(), datagrams[i].size(), senderAddr, &data, &size))
+            {
+                Message decoded;
+                completed++;
+                check(Message::decode(data, size, decoded) && sameMessage(message, decoded),
+                      "mensagem remontada diferente");
+            }
+        }
+
+        check(completed == 1, "mensagem desalojada por outro remetente");
+    });
+
+    property("frag/cabecalho-invalido", seed, [&](Rng &rng) {
+        Message message = randomMessage(rng, Message::LIST, uniform(rng, MAX_DATAGRAM_SIZE, 16384));
+        std::vector<std::string> datagrams = sendAndCapture(message, false, sender, receiver, receiverAddr);
+        if (!check(!datagrams.empty(), "nenhum fragmento"))
+            return;
+
+        std::string datagram = datagrams[rng() % datagrams.size()];
+        uint32_t id, total;
+        uint16_t index, count;
+
+        // Corrompe um campo do cabeçalho (ID não é validado) ou o tamanho do datagrama
+        switch (rng() % 4)
+        {
+        case 0:
+            datagram[10] = datagram[11] = 0; // total de fragmentos = 0
+            break;
+        case 1:
+            datagram[8] = static_cast<char>(0xff); // índice >= total
+            break;
+        case 2:
+            datagram[12] = static_cast<char>(datagram[12] + 1); // tamanho total inconsistente
+            break;
+        default:
+            datagram.resize(uniform(rng, 0, datagram.size() - 1));
+            break;
+        }
+
+        check(!Fragmenter::readHeader(datagram.data(), datagram.size(), id, index, count, total),
+              "cabeçalho corrompido aceito");
+
+        Reassembler reassembler;
+        const char *data;
+        size_t size;
+        check(!reassembler.add(datagram.data(), datagram.size(), senderAddr, &data, &size),
+              "fragmento corrompido aceito");
+    });
+
+    property("receive/datagrama-truncado", seed, [&](Rng &rng) {
+        // Um datagrama maior que o buffer é descartado, nunca decodificado pela metade
+        Message message = randomMessage(rng, Message::MSG, uniform(rng, 1, MAX_TEXT_SIZE));
+        std::string bytes = encode(message);
+        int bufferSize = static_cast<int>(uniform(rng, 1, bytes.size() - 1));
+        sendto(sender, bytes.data(), bytes.size(), 0, (sockaddr*)&receiverAddr, sizeof(receiverAddr));
+
+        sockaddr_in from;
+        Message decoded;
+        check(Message::receive(receiver, from, decoded, bufferSize) == 0, "datagrama truncado aceito");
+
+        sendto(sender, bytes.data(), bytes.size(), 0, (sockaddr*)&receiverAddr, sizeof(receiverAddr));
+        check(Message::receive(receiver, from, decoded, static_cast<int>(bytes.size())) ==
+                  static_cast<int>(bytes.size()) && sameMessage(message, decoded),
+              "datagrama do tamanho exato recusado");
+    });
+
+    close(sender);
+    close(receiver);
+}
+
+static void testCompression(uint64_t seed)
+{
+    property("compressao/ida-e-volta", seed, [](Rng &rng) {
+        std::string text = randomText(rng, randomTextSize(rng));
+        std::string compressed, restored;
+
+        if (!Compression::compress(text.data(), text.size(), compressed))
+            return;
+
+        check(compressed.size() < text.size(), "compressão não reduziu");
+        check(Compression::decompress(compressed.data(), compressed.size(), restored) && restored == text,
+              "texto descomprimido diferente");
+    });
+
+    property("compressao/mensagem", seed, [](Rng &rng) {
+        Message message = randomMessage(rng, static_cast<int>(rng() % TEST_TYPE_COUNT), randomTextSize(rng));
+        EncodedMessage encoded(message, true);
+        std::string_view bytes = encoded.bytes(true);
+        Message decoded;
+
+        check(Message::decode(bytes.data(), bytes.size(), decoded) && sameMessage(message, decoded),
+              "mensagem comprimida diferente");
+        check(!decoded.hasFlag(Message::COMPRESSED), "flag COMPRESSED após decodificar");
+    });
+
+    property("compressao/status-curto", seed, [](Rng &rng) {
+        // O status periódico (~50 bytes) deve encolher graças ao dicionário
+        char text[MAX_TEXT_SIZE];
+        int size = snprintf(text, sizeof(text), "STATUS: UDP_SERVER | Clientes: %d | Tempo: %02d:%02d:%02d",
+                            static_cast<int>(rng() % 100000), static_cast<int>(rng() % 100),
+                            static_cast<int>(rng() % 60), static_cast<int>(rng() % 60));
+        std::string compressed, restored;
+
+        if (!check(Compression::compress(text, size, compressed), "status não comprimido"))
+            return;
+
+        check(compressed.size() < static_cast<size_t>(size), "compressão não reduziu");
+        check(Compression::decompress(compressed.data(), compressed.size(), restored) && restored == text,
+              "status descomprimido diferente");
+    });
+
+    property("compressao/corrompida", seed, [](Rng &rng) {
+        std::string text = randomText(rng, uniform(rng, COMPRESSION_MIN_SIZE, 4096));
+        std::string compressed, restored;
+        if (!Compression::compress(text.data(), text.size(), compressed))
+            return;
+
+        size_t cut = uniform(rng, 0, compressed.size() - 1);
+        check(!Compression::decompress(compressed.data(), cut, restored), "fluxo truncado aceito");
+
+        // Tamanho original declarado diferente do real
+        std::string lying = compressed;
+        uint32_t original = htonl(static_cast<uint32_t>(text.size() + uniform(rng, 1, 64)));
+        memcpy(&lying[0], &original, 4);
+        check(!Compression::decompress(lying.data(), lying.size(), restored), "tamanho original falso aceito");
+
+        // Bytes quaisquer: pode aceitar, mas nunca passar do limite
+        std::string noise = randomBytes(rng, uniform(rng, 0, 512));
+        if (Compression::decompress(noise.data(), noise.size(), restored))
+            check(restored.size() <= COMPRESSION_MAX_SIZE, "descompressão acima do limite");
+    });
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t seed = std::random_device{}();
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+
+        if (option == "--seed" && i + 1 < argc)
+            seed = std::stoull(argv[++i]);
+        else if (option == "--cases" && i + 1 < argc)
+            cases = std::stoul(argv[++i]);
+        else
+        {
+            std::cerr << "Uso: " << argv[0] << " [--seed <n>] [--cases <n>]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "semente " << seed << std::endl;
+
+    testCodec(seed);
+    testFragments(seed);
+    testCompression(seed);
+
+    if (failures)
+    {
+        std::cout << failures << " propriedade(s) falharam; repita com --seed <semente>" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
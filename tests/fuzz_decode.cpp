@@ -0,0 +1,182 @@
+#include "../include/message.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#define FUZZ_ITERATIONS 200000      /** Entradas geradas pelo executor sem libFuzzer (padrão) */
+
+/**
+ * Alvo de fuzzing do caminho de recepção: tudo que um datagrama recebido
+ *     atravessa antes de virar uma `Message` (`Message::decode`,
+ *     `Reassembler::add` e `Compression::decompress`).
+ *
+ * Com libFuzzer (`make fuzz`), o próprio libFuzzer gera as entradas. Sem ele
+ *     (`-DFUZZ_STANDALONE`, usado por `make test`), o `main` abaixo repete os
+ *     arquivos passados na linha de comando ou muta sementes válidas.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *input, size_t size)
+{
+    // Persistente entre entradas, como no servidor: fragmentos de entradas
+    //     anteriores podem completar mensagens
+    static Reassembler reassembler;
+
+    const char *data = reinterpret_cast<const char*>(input);
+    Message message;
+
+    if (Message::decode(data, size, message))
+    {
+        // Uma mensagem aceita precisa sobreviver a uma nova ida e volta
+        std::string encoded(message.encodedSize(), '\0');
+        message.encode(&encoded[0]);
+
+        Message again;
+        if (!Message::decode(encoded.data(), encoded.size(), again) ||
+            again.getTextView() != message.getTextView() || again.getUsernameView() != message.getUsernameView())
+            abort();
+    }
+
+    // O primeiro byte escolhe o remetente, para exercitar várias entradas da tabela
+    sockaddr_in from = {};
+    from.sin_port = size ? input[0] % 4 : 0;
+
+    const char *whole;
+    size_t wholeSize;
+    if (reassembler.add(data, size, from, &whole, &wholeSize))
+    {
+        if (wholeSize > MAX_MESSAGE_SIZE)
+            abort();
+        Message::decode(whole, wholeSize, message);
+    }
+
+    std::string text;
+    if (Compression::decompress(data, size, text) && text.size() > COMPRESSION_MAX_SIZE)
+        abort();
+
+    return 0;
+}
+
+#ifdef FUZZ_STANDALONE
+
+// Sementes válidas: mensagem curta, mensagem comprimida e um fragmento
+static std::vector<std::string> seeds()
+{
+    std::vector<std::string> seeds;
+    std::string text;
+    for (int i = 0; i < 40; i++)
+        text += std::to_string(i) + ":usuario\n";
+
+    Message tweet(Message::MSG, 1, 0, "ana", "bom dia, pessoal");
+    std::string plain(tweet.encodedSize(), '\0');
+    tweet.encode(&plain[0]);
+    seeds.push_back(plain);
+
+    Message list(Message::LIST, 0, 1, "servidor", text);
+    seeds.push_back(std::string(EncodedMessage(list, true).bytes(true)));
+
+    std::string compressed;
+    Compression::compress(text.data(), text.size(), compressed);
+    seeds.push_back(compressed);
+
+    // Fragmento capturado do envio de uma mensagem grande pelo loopback
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(addr);
+    bind(sockfd, (sockaddr*)&addr, sizeof(addr));
+    getsockname(sockfd, (sockaddr*)&addr, &length);
+
+    Message(Message::HISTORY, 0, 1, "servidor", std::string(3000, 'x')).send(sockfd, addr);
+
+    char datagram[MAX_DATAGRAM_SIZE];
+    ssize_t n;
+    while ((n = recv(sockfd, datagram, sizeof(datagram), MSG_DONTWAIT)) > 0)
+        seeds.emplace_back(datagram, n);
+
+    close(sockfd);
+    return seeds;
+}
+
+// Troca bits, corta, insere bytes ou sobrescreve inteiros do cabeçalho
+static std::string mutate(std::mt19937_64 &rng, std::string input)
+{
+    for (int round = rng() % 4 + 1; round > 0; round--)
+    {
+        size_t position = input.empty() ? 0 : rng() % input.size();
+
+        switch (rng() % 5)
+        {
+        case 0:
+            if (!input.empty())
+                input[position] ^= static_cast<char>(1 << (rng() % 8));
+            break;
+        case 1:
+            input.resize(position);
+            break;
+        case 2:
+            input.insert(position, 1 + rng() % 8, static_cast<char>(rng()));
+            break;
+        case 3:
+            if (input.size() >= 4)
+            {
+                uint32_t value = htonl(static_cast<uint32_t>(rng() % 2 ? rng() : rng() % 70000));
+                memcpy(&input[(rng() % (input.size() / 4)) * 4], &value, 4);
+            }
+            break;
+        default:
+            input.append(1 + rng() % 64, static_cast<char>(rng()));
+            break;
+        }
+    }
+
+    return input;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long iterations = FUZZ_ITERATIONS;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+
+        if (option == "--iterations" && i + 1 < argc)
+            iterations = std::stoul(argv[++i]);
+        else
+            files.push_back(option);
+    }
+
+    // Repete entradas salvas (por exemplo, `crash-*` encontrados pelo libFuzzer)
+    if (!files.empty())
+    {
+        for (const std::string &file : files)
+        {
+            std::ifstream in(file, std::ios::binary);
+            std::string input((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+        }
+
+        std::cout << files.size() << " entrada(s) repetidas" << std::endl;
+        return 0;
+    }
+
+    std::vector<std::string> corpus = seeds();
+    std::mt19937_64 rng(std::random_device{}());
+
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        std::string input = mutate(rng, corpus[rng() % corpus.size()]);
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+    }
+
+    std::cout << "fuzz: " << iterations << " entradas mutadas sem falhas" << std::endl;
+    return 0;
+}
+
+#endif